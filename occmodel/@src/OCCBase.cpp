@@ -285,4 +285,161 @@ int OCCBase::fromString(std::string input) {
             this->setShape(shape);
     }
     return ret;
-}
\ No newline at end of file
+}
+
+// Drop triangulations and edge polygons stored in the shape
+void OCCBase::clearMesh() {
+    const TopoDS_Shape& shape = this->getShape();
+    if (!shape.IsNull())
+        BRepTools::Clean(shape);
+}
+
+// Size of the transient object itself, shared objects are only
+// counted the first time they are seen.
+static size_t transientSize(const Handle(Standard_Transient)& obj,
+                            std::set<const Standard_Transient *>& seen)
+{
+    if (obj.IsNull() || !seen.insert(obj.operator->()).second)
+        return 0;
+    return obj->DynamicType()->Size();
+}
+
+static size_t bsplineSize(int npoles, size_t poleSize, bool rational,
+                          int nknots, int nflat)
+{
+    return npoles*(poleSize + (rational ? sizeof(double) : 0)) +
+           nknots*(sizeof(double) + sizeof(int)) + nflat*sizeof(double);
+}
+
+static size_t curveSize(const Handle(Geom_Curve)& curve,
+                        std::set<const Standard_Transient *>& seen)
+{
+    size_t size = transientSize(curve, seen);
+    if (size == 0)
+        return 0;
+    
+    if (curve->IsKind(STANDARD_TYPE(Geom_BSplineCurve))) {
+        Handle(Geom_BSplineCurve) bs = Handle(Geom_BSplineCurve)::DownCast(curve);
+        size += bsplineSize(bs->NbPoles(), sizeof(gp_Pnt), bs->IsRational(), bs->NbKnots(),
+                            bs->NbPoles() + bs->Degree() + 1);
+    } else if (curve->IsKind(STANDARD_TYPE(Geom_BezierCurve))) {
+        Handle(Geom_BezierCurve) bz = Handle(Geom_BezierCurve)::DownCast(curve);
+        size += bsplineSize(bz->NbPoles(), sizeof(gp_Pnt), bz->IsRational(), 0, 0);
+    } else if (curve->IsKind(STANDARD_TYPE(Geom_TrimmedCurve))) {
+        Handle(Geom_TrimmedCurve) tc = Handle(Geom_TrimmedCurve)::DownCast(curve);
+        size += curveSize(tc->BasisCurve(), seen);
+    }
+    return size;
+}
+
+static size_t curve2dSize(const Handle(Geom2d_Curve)& curve,
+                          std::set<const Standard_Transient *>& seen)
+{
+    size_t size = transientSize(curve, seen);
+    if (size == 0)
+        return 0;
+    
+    if (curve->IsKind(STANDARD_TYPE(Geom2d_BSplineCurve))) {
+        Handle(Geom2d_BSplineCurve) bs = Handle(Geom2d_BSplineCurve)::DownCast(curve);
+        size += bsplineSize(bs->NbPoles(), sizeof(gp_Pnt2d), bs->IsRational(), bs->NbKnots(),
+                            bs->NbPoles() + bs->Degree() + 1);
+    } else if (curve->IsKind(STANDARD_TYPE(Geom2d_BezierCurve))) {
+        Handle(Geom2d_BezierCurve) bz = Handle(Geom2d_BezierCurve)::DownCast(curve);
+        size += bsplineSize(bz->NbPoles(), sizeof(gp_Pnt2d), bz->IsRational(), 0, 0);
+    } else if (curve->IsKind(STANDARD_TYPE(Geom2d_TrimmedCurve))) {
+        Handle(Geom2d_TrimmedCurve) tc = Handle(Geom2d_TrimmedCurve)::DownCast(curve);
+        size += curve2dSize(tc->BasisCurve(), seen);
+    }
+    return size;
+}
+
+static size_t surfaceSize(const Handle(Geom_Surface)& surface,
+                          std::set<const Standard_Transient *>& seen)
+{
+    size_t size = transientSize(surface, seen);
+    if (size == 0)
+        return 0;
+    
+    if (surface->IsKind(STANDARD_TYPE(Geom_BSplineSurface))) {
+        Handle(Geom_BSplineSurface) bs = Handle(Geom_BSplineSurface)::DownCast(surface);
+        const bool rational = bs->IsURational() || bs->IsVRational();
+        size += bsplineSize(bs->NbUPoles()*bs->NbVPoles(), sizeof(gp_Pnt), rational,
+                            bs->NbUKnots() + bs->NbVKnots(),
+                            bs->NbUPoles() + bs->UDegree() + bs->NbVPoles() + bs->VDegree() + 2);
+    } else if (surface->IsKind(STANDARD_TYPE(Geom_BezierSurface))) {
+        Handle(Geom_BezierSurface) bz = Handle(Geom_BezierSurface)::DownCast(surface);
+        const bool rational = bz->IsURational() || bz->IsVRational();
+        size += bsplineSize(bz->NbUPoles()*bz->NbVPoles(), sizeof(gp_Pnt), rational, 0, 0);
+    } else if (surface->IsKind(STANDARD_TYPE(Geom_RectangularTrimmedSurface))) {
+        Handle(Geom_RectangularTrimmedSurface) ts =
+            Handle(Geom_RectangularTrimmedSurface)::DownCast(surface);
+        size += surfaceSize(ts->BasisSurface(), seen);
+    }
+    return size;
+}
+
+OCCShapeMemory OCCBase::memoryUsage() {
+    OCCShapeMemory ret;
+    ret.triangulation = ret.polygons = ret.pcurves = ret.geometry = 0;
+    
+    const TopoDS_Shape& shape = this->getShape();
+    if (shape.IsNull())
+        return ret;
+    
+    std::set<const Standard_Transient *> seen;
+    TopLoc_Location loc;
+    Standard_Real first, last;
+    
+    TopTools_IndexedMapOfShape faces;
+    TopExp::MapShapes(shape, TopAbs_FACE, faces);
+    for (int i = 1; i <= faces.Extent(); i++) {
+        const TopoDS_Face& face = TopoDS::Face(faces(i));
+        ret.geometry += surfaceSize(BRep_Tool::Surface(face, loc), seen);
+        
+        Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, loc);
+        size_t size = transientSize(triangulation, seen);
+        if (size > 0) {
+            ret.triangulation += size;
+            ret.triangulation += triangulation->NbNodes()*sizeof(gp_Pnt);
+            ret.triangulation += triangulation->NbTriangles()*sizeof(Poly_Triangle);
+            if (triangulation->HasUVNodes())
+                ret.triangulation += triangulation->NbNodes()*sizeof(gp_Pnt2d);
+        }
+        
+        // pcurves and polygons are stored per edge and face
+        TopExp_Explorer ex;
+        for (ex.Init(face, TopAbs_EDGE); ex.More(); ex.Next()) {
+            const TopoDS_Edge& edge = TopoDS::Edge(ex.Current());
+            ret.pcurves += curve2dSize(BRep_Tool::CurveOnSurface(edge, face, first, last), seen);
+            if (triangulation.IsNull())
+                continue;
+            
+            Handle(Poly_PolygonOnTriangulation) poly =
+                BRep_Tool::PolygonOnTriangulation(edge, triangulation, loc);
+            size = transientSize(poly, seen);
+            if (size > 0) {
+                ret.polygons += size;
+                ret.polygons += poly->NbNodes()*sizeof(int);
+                if (poly->HasParameters())
+                    ret.polygons += poly->NbNodes()*sizeof(double);
+            }
+        }
+    }
+    
+    TopTools_IndexedMapOfShape edges;
+    TopExp::MapShapes(shape, TopAbs_EDGE, edges);
+    for (int i = 1; i <= edges.Extent(); i++) {
+        const TopoDS_Edge& edge = TopoDS::Edge(edges(i));
+        ret.geometry += curveSize(BRep_Tool::Curve(edge, loc, first, last), seen);
+        
+        Handle(Poly_Polygon3D) poly = BRep_Tool::Polygon3D(edge, loc);
+        const size_t size = transientSize(poly, seen);
+        if (size > 0) {
+            ret.polygons += size;
+            ret.polygons += poly->NbNodes()*sizeof(gp_Pnt);
+            if (poly->HasParameters())
+                ret.polygons += poly->NbNodes()*sizeof(double);
+        }
+    }
+    return ret;
+}
@@ -107,6 +107,33 @@ cdef class Base:
         cdef c_OCCBase *occ = <c_OCCBase *>self.thisptr
         return occ.isValid()
     
+    cpdef clearMesh(self):
+        '''
+        Remove triangulations and edge polygons stored in the shape
+        by previous mesh operations.
+        '''
+        self.CheckPtr()
+        cdef c_OCCBase *occ = <c_OCCBase *>self.thisptr
+        occ.clearMesh()
+        return self
+    
+    cpdef dict memoryUsage(self):
+        '''
+        Return dictionary with approximate bytes held by the shape
+        for triangulations, edge polygons, pcurves and curve and
+        surface geometry. Shared data is counted once.
+        '''
+        self.CheckPtr()
+        cdef c_OCCBase *occ = <c_OCCBase *>self.thisptr
+        cdef c_OCCShapeMemory mem = occ.memoryUsage()
+        return {
+            'triangulation': mem.triangulation,
+            'polygons': mem.polygons,
+            'pcurves': mem.pcurves,
+            'geometry': mem.geometry,
+            'total': mem.triangulation + mem.polygons + mem.pcurves + mem.geometry,
+        }
+    
     cpdef bint hasPlane(self, Point origin = None, Vector normal = None, double tolerance = 1e-12):
         '''
         Check if object has plane defined. Optional pass origin and normal
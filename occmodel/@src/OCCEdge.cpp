@@ -56,35 +56,195 @@ int OCCEdge::numVertices()
 
 OCCTesselation *OCCEdge::tesselate(double angular, double curvature)
 {
-    OCCTesselation *ret = new OCCTesselation();
+    std::vector<OCCBase *> shapes(1, this);
+    return tesselateShapes(shapes, angular, curvature, 1);
+}
+
+DVec OCCEdge::parameterRange()
+{
+    DVec ret;
+    Standard_Real first, last;
+    BRep_Tool::Range(this->getEdge(), first, last);
+    ret.push_back(first);
+    ret.push_back(last);
+    return ret;
+}
+
+// Parameters per chunk of the parallel evaluation
+static const int EVALUATE_CHUNK = 4096;
+
+struct ParameterLess {
+    const double *params;
+    ParameterLess(const double *params) : params(params) { ; }
+    bool operator()(int a, int b) const { return params[a] < params[b]; }
+};
+
+static bool isBSpline(const Handle(Geom_Curve)& curve)
+{
+    if (curve->IsKind(STANDARD_TYPE(Geom_BSplineCurve)))
+        return true;
+    if (curve->IsKind(STANDARD_TYPE(Geom_TrimmedCurve))) {
+        Handle(Geom_TrimmedCurve) trimmed = Handle(Geom_TrimmedCurve)::DownCast(curve);
+        return trimmed->BasisCurve()->IsKind(STANDARD_TYPE(Geom_BSplineCurve));
+    }
+    return false;
+}
+
+// Evaluate the 3d curve of edge at n parameters in chunks spread over
+// the threads. Each thread reuse one GeomAdaptor_Curve. B-spline curves
+// keep the coefficients of the last evaluated span, so chunks of such
+// curves are evaluated in increasing parameter order to build each
+// span once, on a copy of the curve as the span cache is not shared
+// safely between threads.
+static int evaluateEdge(const TopoDS_Edge& edge, const double *params, int n,
+                        int derivatives, int threads, double *points, double *d1,
+                        double *d2)
+{
+    Standard_Real first, last;
+    TopLoc_Location loc;
+    Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, loc, first, last);
+    if (curve.IsNull()) {
+        setErrorMessage("Edge has no 3d curve");
+        return 0;
+    }
+    
+    const int nchunks = (n + EVALUATE_CHUNK - 1)/EVALUATE_CHUNK;
+    threads = std::max(1, std::min(meshThreads(threads), nchunks));
+    const bool bspline = isBSpline(curve);
+    const bool located = !loc.IsIdentity();
+    const gp_Trsf trsf = loc.Transformation();
+    int failed = 0;
+    
+    #pragma omp parallel num_threads(threads)
+    {
+        Handle(Geom_Curve) local = curve;
+        if (threads > 1)
+            local = Handle(Geom_Curve)::DownCast(curve->Copy());
+        GeomAdaptor_Curve adaptor(local);
+        std::vector<int> order;
+        gp_Pnt pnt;
+        gp_Vec v1, v2;
+        
+        #pragma omp for schedule(dynamic, 1)
+        for (int c = 0; c < nchunks; c++) {
+            const int start = c*EVALUATE_CHUNK;
+            const int count = std::min(EVALUATE_CHUNK, n - start);
+            bool sorted = true;
+            order.resize(count);
+            for (int k = 0; k < count; k++) {
+                order[k] = start + k;
+                if (k > 0 && params[start + k] < params[start + k - 1])
+                    sorted = false;
+            }
+            if (bspline && !sorted)
+                std::sort(order.begin(), order.end(), ParameterLess(params));
+            
+            try {
+                for (int k = 0; k < count; k++) {
+                    const int i = order[k];
+                    if (derivatives == 0)
+                        adaptor.D0(params[i], pnt);
+                    else if (derivatives == 1)
+                        adaptor.D1(params[i], pnt, v1);
+                    else
+                        adaptor.D2(params[i], pnt, v1, v2);
+                    
+                    if (located) {
+                        pnt.Transform(trsf);
+                        v1.Transform(trsf);
+                        v2.Transform(trsf);
+                    }
+                    points[3*i] = pnt.X();
+                    points[3*i + 1] = pnt.Y();
+                    points[3*i + 2] = pnt.Z();
+                    if (derivatives > 0) {
+                        d1[3*i] = v1.X();
+                        d1[3*i + 1] = v1.Y();
+                        d1[3*i + 2] = v1.Z();
+                    }
+                    if (derivatives > 1) {
+                        d2[3*i] = v2.X();
+                        d2[3*i + 1] = v2.Y();
+                        d2[3*i + 2] = v2.Z();
+                    }
+                }
+            } catch(Standard_Failure &err) {
+                #pragma omp atomic
+                failed++;
+            }
+        }
+    }
+    
+    if (failed) {
+        setErrorMessage("Failed to evaluate edge");
+        return 0;
+    }
+    return 1;
+}
+
+int OCCEdge::evaluate(const double *params, int n, int derivatives, int threads,
+                      double *points, double *d1, double *d2)
+{
+    if (derivatives < 0 || derivatives > 2) {
+        setErrorMessage("Derivatives must be 0, 1 or 2");
+        return 0;
+    }
     try {
-        Standard_Real start, end;
-        OCCStruct3f vert;
-        
-        TopLoc_Location loc = this->getEdge().Location();
-        gp_Trsf location = loc.Transformation();
-        
-        const Handle(Geom_Curve)& curve = BRep_Tool::Curve(this->getEdge(), start, end);
-        const GeomAdaptor_Curve& aCurve(curve);
-		
-        GCPnts_TangentialDeflection TD(aCurve, start, end, angular, curvature);
-        
-        for (Standard_Integer i = 1; i <= TD.NbPoints(); i++)
-        {
-            gp_Pnt pnt = TD.Value(i).Transformed(location);
-            vert.x = (float)pnt.X();
-            vert.y = (float)pnt.Y();
-            vert.z = (float)pnt.Z();
-            ret->vertices.push_back(vert);
+        return evaluateEdge(this->getEdge(), params, n, derivatives, threads,
+                            points, d1, d2);
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to evaluate edge");
+        }
+        return 0;
+    }
+}
+
+// Parameters at n points spaced by equal arc length from start to
+// end of edge, then evaluated like evaluate.
+int OCCEdge::sampleUniform(int n, int derivatives, int threads, double *params,
+                           double *points, double *d1, double *d2)
+{
+    if (n < 2) {
+        setErrorMessage("Expected at least 2 points");
+        return 0;
+    }
+    if (derivatives < 0 || derivatives > 2) {
+        setErrorMessage("Derivatives must be 0, 1 or 2");
+        return 0;
+    }
+    try {
+        Standard_Real first, last;
+        const Handle(Geom_Curve)& curve = BRep_Tool::Curve(this->getEdge(), first, last);
+        if (curve.IsNull()) {
+            setErrorMessage("Edge has no 3d curve");
+            return 0;
         }
         
-        ret->ranges.push_back(0);
-        ret->ranges.push_back(ret->vertices.size());
+        GeomAdaptor_Curve adaptor(curve);
+        GCPnts_UniformAbscissa UA(adaptor, n, first, last);
+        if (!UA.IsDone() || UA.NbPoints() != n) {
+            StdFail_NotDone::Raise("Failed to sample edge");
+        }
+        for (int i = 0; i < n; i++)
+            params[i] = UA.Parameter(i + 1);
         
+        return evaluateEdge(this->getEdge(), params, n, derivatives, threads,
+                            points, d1, d2);
     } catch(Standard_Failure &err) {
-        return NULL;
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to sample edge");
+        }
+        return 0;
     }
-    return ret;
 }
 
 int OCCEdge::createLine(OCCVertex *start, OCCVertex *end) {
@@ -114,6 +114,93 @@ cdef class Edge(Base):
         ret.setArrays()
         return ret
         
+    cpdef parameterRange(self):
+        '''
+        Return first and last parameter of edge curve
+        '''
+        cdef c_OCCEdge *occ = <c_OCCEdge *>self.thisptr
+        cdef vector[double] res = occ.parameterRange()
+        return res[0], res[1]
+    
+    cpdef evaluate(self, double[::1] params, int derivatives = 0, int threads = 1,
+                   double[:, ::1] points = None, double[:, ::1] d1 = None,
+                   double[:, ::1] d2 = None):
+        '''
+        Evaluate edge curve at parameters. Return points for zero
+        derivatives, else tuple of points, first derivatives and
+        second derivatives up to derivatives. All arrays have shape
+        (n, 3).
+        
+        Preallocated C-contiguous (n, 3) double buffers, like numpy
+        arrays, can be given for the results. Parameters are split in
+        chunks evaluated in parallel.
+        
+        :param params: curve parameters, see parameterRange
+        :param derivatives: number of derivatives, 0, 1 or 2
+        :param threads: number of threads, zero use all cores
+        :param points: optional buffer for points
+        :param d1: optional buffer for first derivatives
+        :param d2: optional buffer for second derivatives
+        '''
+        cdef c_OCCEdge *occ = <c_OCCEdge *>self.thisptr
+        cdef int n = params.shape[0]
+        
+        if derivatives < 0 or derivatives > 2:
+            raise OCCError('Expected derivatives 0, 1 or 2')
+        
+        points = pointBuffer(points, n)
+        d1 = pointBuffer(d1, n) if derivatives > 0 else None
+        d2 = pointBuffer(d2, n) if derivatives > 1 else None
+        
+        if n > 0 and not occ.evaluate(&params[0], n, derivatives, threads,
+                                      &points[0, 0],
+                                      &d1[0, 0] if derivatives > 0 else NULL,
+                                      &d2[0, 0] if derivatives > 1 else NULL):
+            raise OCCError(errorMessage)
+        
+        if derivatives == 0:
+            return points[:n]
+        elif derivatives == 1:
+            return points[:n], d1[:n]
+        return points[:n], d1[:n], d2[:n]
+    
+    cpdef sampleUniform(self, int n, int derivatives = 0, int threads = 1):
+        '''
+        Evaluate edge at n points spaced by equal arc length from
+        start to end. Return tuple of parameters and the arrays
+        returned by evaluate.
+        
+        :param n: number of points, at least 2
+        :param derivatives: number of derivatives, 0, 1 or 2
+        :param threads: number of threads, zero use all cores
+        '''
+        cdef c_OCCEdge *occ = <c_OCCEdge *>self.thisptr
+        cdef double[:, ::1] points, d1 = None, d2 = None
+        
+        if derivatives < 0 or derivatives > 2:
+            raise OCCError('Expected derivatives 0, 1 or 2')
+        if n < 2:
+            raise OCCError('Expected at least 2 points')
+        
+        cdef view.array params = view.array(shape=(n,), itemsize=sizeof(double), format="d")
+        points = pointBuffer(None, n)
+        if derivatives > 0:
+            d1 = pointBuffer(None, n)
+        if derivatives > 1:
+            d2 = pointBuffer(None, n)
+        
+        if not occ.sampleUniform(n, derivatives, threads, <double *>params.data,
+                                 &points[0, 0],
+                                 &d1[0, 0] if derivatives > 0 else NULL,
+                                 &d2[0, 0] if derivatives > 1 else NULL):
+            raise OCCError(errorMessage)
+        
+        if derivatives == 0:
+            return params, points
+        elif derivatives == 1:
+            return params, points, d1
+        return params, points, d1, d2
+        
     cpdef createLine(self, start, end):
         '''
         Create straight line from given start and end
@@ -523,6 +610,14 @@ cdef class Edge(Base):
             
         return occ.length()
 
+cdef double[:, ::1] pointBuffer(double[:, ::1] buf, int n):
+    # Check or allocate (n, 3) result buffer of point evaluation
+    if buf is None:
+        return view.array(shape=(max(n, 1), 3), itemsize=sizeof(double), format="d")
+    if buf.shape[0] < n or buf.shape[1] != 3:
+        raise OCCError('Expected buffer of shape (n, 3)')
+    return buf
+    
 cdef class EdgeIterator:
     '''
     Iterator of edges
@@ -432,47 +432,201 @@ int OCCFace::boolean(OCCSolid *tool, BoolOpType op) {
     return 1;
 }
 
-OCCMesh *OCCFace::createMesh(double factor, double angle, bool qualityNormals = true)
+static void shapeFaces(const TopoDS_Shape& shape, std::vector<TopoDS_Face>& faces)
 {
-    OCCMesh *mesh = new OCCMesh();
+    TopExp_Explorer exFace;
+    for (exFace.Init(shape, TopAbs_FACE); exFace.More(); exFace.Next()) {
+        const TopoDS_Face& faceref = static_cast<const TopoDS_Face &>(exFace.Current());
+        faces.push_back(faceref);
+    }
+}
+
+OCCMesh *OCCFace::createMesh(OCCMeshParams& params)
+{
+    std::vector<TopoDS_Face> faces;
+    shapeFaces(this->getShape(), faces);
+    return createShapeMesh("face", this->getShape(), faces, params, false);
+}
+
+OCCTesselation *OCCFace::tesselateEdges(double angular, double curvature, int threads)
+{
+    return tesselateShapeEdges(this->getShape(), angular, curvature, threads);
+}
+
+int OCCFace::createMeshLOD(const std::vector<double>& factors, OCCMeshParams& params,
+                           std::vector<OCCMesh *>& meshes)
+{
+    std::vector<TopoDS_Face> faces;
+    shapeFaces(this->getShape(), faces);
+    return createShapeMeshLOD("face", this->getShape(), faces, factors, params, false, meshes);
+}
+
+int OCCFace::createMeshStream(OCCMeshSink *sink, OCCMeshParams& params,
+                              unsigned int chunkSize = 0)
+{
+    std::vector<TopoDS_Face> faces;
+    shapeFaces(this->getShape(), faces);
+    return streamShapeMesh(this->getShape(), faces, sink, params, false, chunkSize);
+}
+
+DVec OCCFace::parameterRange()
+{
+    DVec ret;
+    Standard_Real umin, umax, vmin, vmax;
+    BRepTools::UVBounds(this->getFace(), umin, umax, vmin, vmax);
+    ret.push_back(umin);
+    ret.push_back(umax);
+    ret.push_back(vmin);
+    ret.push_back(vmax);
+    return ret;
+}
+
+// Evaluate face at n (u,v) pairs. Each thread works on its own copy of
+// the face, with a BRepAdaptor_Surface and a 2d classifier reused for
+// all its samples, as the span cache of B-spline surfaces is not
+// shared safely between threads. Normals and curvatures follow the
+// face orientation, zero where not defined (sphere pole, cone apex).
+static int evaluateFace(const TopoDS_Face& face, const double *uv, int n, int threads,
+                        double *points, double *normals, double *curvatures,
+                        unsigned char *inside)
+{
+    const bool reversed = face.Orientation() == TopAbs_REVERSED;
+    const double tolerance = BRep_Tool::Tolerance(face);
+    threads = std::max(1, std::min(meshThreads(threads), (n + 255)/256));
+    int failed = 0;
     
-    try {
-        Bnd_Box aBox;
-        BRepBndLib::Add(this->getShape(), aBox);
-        
-        Standard_Real aXmin, aYmin, aZmin;
-        Standard_Real aXmax, aYmax, aZmax;
-        aBox.Get(aXmin, aYmin, aZmin, aXmax, aYmax, aZmax);
-        
-        Standard_Real maxd = fabs(aXmax - aXmin);
-        maxd = std::max(maxd, fabs(aYmax - aYmin));
-        maxd = std::max(maxd, fabs(aZmax - aZmin));
-        
-        BRepMesh_FastDiscret MSH(factor*maxd, angle, aBox, Standard_False, Standard_False, 
-                                 Standard_True, Standard_True);
-        
-        MSH.Perform(this->getShape());
-        
-        BRepMesh_IncrementalMesh(this->getShape(),factor*maxd);
+    #pragma omp parallel num_threads(threads)
+    {
+        BRepLProp_SLProps *prop = NULL;
+        BRepTopAdaptor_FClass2d *classifier = NULL;
+        try {
+            TopoDS_Face local = face;
+            if (threads > 1) {
+                BRepBuilderAPI_Copy A;
+                A.Perform(face);
+                local = TopoDS::Face(A.Shape());
+            }
+            BRepAdaptor_Surface adaptor(local, Standard_False);
+            prop = new BRepLProp_SLProps(adaptor, curvatures ? 2 : 1, gp::Resolution());
+            if (inside != NULL)
+                classifier = new BRepTopAdaptor_FClass2d(local, tolerance);
+        } catch(Standard_Failure &err) {
+            #pragma omp atomic
+            failed++;
+        }
         
-        if (this->getShape().ShapeType() != TopAbs_FACE) {
-            TopExp_Explorer exFace;
-            for (exFace.Init(this->getShape(), TopAbs_FACE); exFace.More(); exFace.Next()) {
-                const TopoDS_Face& faceref = static_cast<const TopoDS_Face &>(exFace.Current());
-                mesh->extractFaceMesh(faceref, qualityNormals);
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < n; i++) {
+            if (prop == NULL || (inside != NULL && classifier == NULL))
+                continue;
+            try {
+                prop->SetParameters(uv[2*i], uv[2*i + 1]);
+                const gp_Pnt& pnt = prop->Value();
+                points[3*i] = pnt.X();
+                points[3*i + 1] = pnt.Y();
+                points[3*i + 2] = pnt.Z();
+                
+                gp_Vec normal(0., 0., 0.);
+                if (prop->IsNormalDefined()) {
+                    normal = prop->Normal();
+                    if (reversed)
+                        normal.Reverse();
+                }
+                normals[3*i] = normal.X();
+                normals[3*i + 1] = normal.Y();
+                normals[3*i + 2] = normal.Z();
+                
+                if (curvatures != NULL) {
+                    double kmax = 0., kmin = 0.;
+                    if (prop->IsCurvatureDefined()) {
+                        kmax = prop->MaxCurvature();
+                        kmin = prop->MinCurvature();
+                        if (reversed) {
+                            const double tmp = kmax;
+                            kmax = -kmin;
+                            kmin = -tmp;
+                        }
+                    }
+                    curvatures[2*i] = kmax;
+                    curvatures[2*i + 1] = kmin;
+                }
+                
+                if (classifier != NULL) {
+                    const TopAbs_State state = classifier->Perform(gp_Pnt2d(uv[2*i], uv[2*i + 1]));
+                    inside[i] = state == TopAbs_IN || state == TopAbs_ON;
+                }
+            } catch(Standard_Failure &err) {
+                #pragma omp atomic
+                failed++;
             }
+        }
+        delete classifier;
+        delete prop;
+    }
+    
+    if (failed) {
+        setErrorMessage("Failed to evaluate face");
+        return 0;
+    }
+    return 1;
+}
+
+int OCCFace::evaluateUV(const double *uv, int n, int threads, double *points,
+                        double *normals, double *curvatures, unsigned char *inside)
+{
+    if (this->getShape().ShapeType() != TopAbs_FACE) {
+        setErrorMessage("Expected single face");
+        return 0;
+    }
+    try {
+        return evaluateFace(this->getFace(), uv, n, threads, points, normals,
+                            curvatures, inside);
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
         } else {
-            mesh->extractFaceMesh(this->getFace(), qualityNormals);
+            setErrorMessage("Failed to evaluate face");
+        }
+        return 0;
+    }
+}
+
+// Evaluate face on a regular nu x nv grid over the (u,v) bounds of
+// the face. Sample j*nu + i is at (u_i, v_j), stored in uv.
+int OCCFace::evaluateGrid(int nu, int nv, int threads, double *uv, double *points,
+                          double *normals, double *curvatures, unsigned char *inside)
+{
+    if (nu < 2 || nv < 2) {
+        setErrorMessage("Expected grid of at least 2 x 2");
+        return 0;
+    }
+    if (this->getShape().ShapeType() != TopAbs_FACE) {
+        setErrorMessage("Expected single face");
+        return 0;
+    }
+    try {
+        Standard_Real umin, umax, vmin, vmax;
+        BRepTools::UVBounds(this->getFace(), umin, umax, vmin, vmax);
+        const double du = (umax - umin)/(nu - 1);
+        const double dv = (vmax - vmin)/(nv - 1);
+        for (int j = 0; j < nv; j++) {
+            for (int i = 0; i < nu; i++) {
+                uv[2*(j*nu + i)] = i == nu - 1 ? umax : umin + i*du;
+                uv[2*(j*nu + i) + 1] = j == nv - 1 ? vmax : vmin + j*dv;
+            }
         }
+        return evaluateFace(this->getFace(), uv, nu*nv, threads, points, normals,
+                            curvatures, inside);
     } catch(Standard_Failure &err) {
         Handle_Standard_Failure e = Standard_Failure::Caught();
         const Standard_CString msg = e->GetMessageString();
         if (msg != NULL && strlen(msg) > 1) {
             setErrorMessage(msg);
         } else {
-            setErrorMessage("Failed to create mesh");
+            setErrorMessage("Failed to evaluate face");
         }
-        return NULL;
+        return 0;
     }
-    return mesh;
-}
\ No newline at end of file
+}
@@ -67,18 +67,40 @@ cdef class Face(Base):
         return occ.numFaces()
         
     cpdef Mesh createMesh(self, double factor = .01, double angle = .25,
-                          bint qualityNormals = False):
+                          int qualityNormals = NORMALS_SMOOTH, int threads = 1,
+                          bint weld = False, double creaseAngle = M_PI/6.,
+                          Mesher mesher = None):
         '''
         Create triangle mesh of face.
         
         :param factor: deflection from true position
         :param angle: max angle
-        :param qualityNormals: create normals by evaluating surface parameters
+        :param qualityNormals: create normals by evaluating surface parameters.
+                               True or NORMALS_SURFACE evaluates the surface at
+                               the (u,v) nodes of the triangulation.
+                               NORMALS_PROJECTED recover (u,v) by projecting
+                               each node onto the surface (slow).
+        :param threads: number of threads used to triangulate and extract
+                        faces. Zero use all available cores. The result is
+                        identical to the single threaded mesh.
+        :param weld: merge coincident vertices along shared edges into a
+                     single indexed vertex.
+        :param creaseAngle: vertices are only merged where the normals
+                            differ less than this angle, which keeps
+                            sharp edges sharp.
+        :param mesher: Mesher object replacing all other arguments.
+                       Stage timings are stored in the mesher.
         '''
         cdef c_OCCFace *occ = <c_OCCFace *>self.thisptr
-        cdef c_OCCMesh *mesh = occ.createMesh(factor, angle, qualityNormals)
+        cdef c_OCCMesh *mesh
         cdef Mesh ret = Mesh.__new__(Mesh, None)
         
+        if mesher is None:
+            mesher = Mesher(factor, True, angle, True, qualityNormals, threads,
+                            weld, creaseAngle)
+        
+        mesh = occ.createMesh(mesher.params)
+        
         if mesh == NULL:
             raise OCCError(errorMessage)
         
@@ -86,6 +108,231 @@ cdef class Face(Base):
         ret.setArrays()
         return ret
     
+    cpdef dict samplePoints(self, int n, unsigned int seed = 0, double factor = .01,
+                            double angle = .25, int threads = 1, Mesher mesher = None):
+        '''
+        Sample n points uniformly by area over the surface of the
+        face, see Mesh.samplePoints. The face is meshed first and
+        the samples lie on the triangulation, within the mesh
+        deflection from the true surface.
+        
+        :param n: number of samples
+        :param seed: random seed
+        :param factor: deflection from true position
+        :param angle: max angle
+        :param threads: number of threads, zero use all cores
+        :param mesher: Mesher object replacing factor and angle
+        '''
+        cdef Mesh mesh = self.createMesh(factor, angle, NORMALS_SMOOTH, threads,
+                                         mesher = mesher)
+        return mesh.samplePoints(n, seed, threads)
+    
+    cpdef Tesselation tesselateEdges(self, double angular = .1, double curvature = .1,
+                                     int threads = 1):
+        '''
+        Tesselate the edges of the face as wireframe.
+        
+        Each edge is discretized once, also when shared between
+        faces. Seam and degenerated edges are skipped. ranges hold a
+        (start, count) pair for each edge and ids the index of the
+        edge among the unique edges of the face.
+        
+        :param angular: max angular deflection
+        :param curvature: max curvature deflection
+        :param threads: number of threads, zero use all cores
+        '''
+        cdef c_OCCFace *occ = <c_OCCFace *>self.thisptr
+        cdef c_OCCTesselation *tess = occ.tesselateEdges(angular, curvature, threads)
+        cdef Tesselation ret = Tesselation.__new__(Tesselation, None)
+        
+        if tess == NULL:
+            raise OCCError(errorMessage)
+        
+        ret.thisptr = tess
+        ret.setArrays()
+        return ret
+    
+    cpdef parameterRange(self):
+        '''
+        Return (u,v) bounds of face as umin, umax, vmin, vmax
+        '''
+        cdef c_OCCFace *occ = <c_OCCFace *>self.thisptr
+        cdef vector[double] res = occ.parameterRange()
+        return res[0], res[1], res[2], res[3]
+    
+    cpdef dict evaluateUV(self, double[:, ::1] uv, bint curvatures = False,
+                          bint classify = False, int threads = 1,
+                          double[:, ::1] points = None, double[:, ::1] normals = None):
+        '''
+        Evaluate face surface at (u,v) parameters. Return dict with
+        'points' and 'normals' of shape (n, 3), 'curvatures' with the
+        max and min principal curvature of shape (n, 2) and 'inside'
+        of shape (n,) set to 1 for samples inside the trimmed face.
+        
+        Normals and curvatures follow the face orientation and are
+        zero where not defined. Preallocated C-contiguous (n, 3)
+        double buffers, like numpy arrays, can be given for points
+        and normals.
+        
+        :param uv: parameters, shape (n, 2), see parameterRange
+        :param curvatures: evaluate principal curvatures
+        :param classify: classify samples against face boundary
+        :param threads: number of threads, zero use all cores
+        :param points: optional buffer for points
+        :param normals: optional buffer for normals
+        '''
+        cdef c_OCCFace *occ = <c_OCCFace *>self.thisptr
+        cdef int n = uv.shape[0]
+        
+        if uv.shape[1] != 2:
+            raise OCCError('Expected uv of shape (n, 2)')
+        
+        points = pointBuffer(points, n)
+        normals = pointBuffer(normals, n)
+        cdef view.array curv = surfaceCurvatures(n, curvatures)
+        cdef view.array inside = surfaceInside(n, classify)
+        
+        if n > 0 and not occ.evaluateUV(&uv[0, 0], n, threads, &points[0, 0],
+                                        &normals[0, 0],
+                                        <double *>curv.data if curvatures else NULL,
+                                        <unsigned char *>inside.data if classify else NULL):
+            raise OCCError(errorMessage)
+        
+        ret = {'points': points[:n], 'normals': normals[:n]}
+        if curvatures:
+            ret['curvatures'] = curv[:n]
+        if classify:
+            ret['inside'] = inside[:n]
+        return ret
+    
+    cpdef dict evaluateGrid(self, int nu, int nv, bint curvatures = False,
+                            bint classify = True, int threads = 1):
+        '''
+        Evaluate face surface on a regular nu x nv grid over the (u,v)
+        bounds of the face. Return dict like evaluateUV with the
+        parameters in 'uv'. Sample j*nu + i is at (u_i, v_j).
+        
+        :param nu: samples in u, at least 2
+        :param nv: samples in v, at least 2
+        :param curvatures: evaluate principal curvatures
+        :param classify: classify samples against face boundary
+        :param threads: number of threads, zero use all cores
+        '''
+        cdef c_OCCFace *occ = <c_OCCFace *>self.thisptr
+        
+        if nu < 2 or nv < 2:
+            raise OCCError('Expected grid of at least 2 x 2')
+        
+        cdef int n = nu*nv
+        cdef view.array uv = view.array(shape=(n, 2), itemsize=sizeof(double), format="d")
+        cdef view.array points = view.array(shape=(n, 3), itemsize=sizeof(double), format="d")
+        cdef view.array normals = view.array(shape=(n, 3), itemsize=sizeof(double), format="d")
+        cdef view.array curv = surfaceCurvatures(n, curvatures)
+        cdef view.array inside = surfaceInside(n, classify)
+        
+        if not occ.evaluateGrid(nu, nv, threads, <double *>uv.data, <double *>points.data,
+                                <double *>normals.data,
+                                <double *>curv.data if curvatures else NULL,
+                                <unsigned char *>inside.data if classify else NULL):
+            raise OCCError(errorMessage)
+        
+        ret = {'uv': uv, 'points': points, 'normals': normals}
+        if curvatures:
+            ret['curvatures'] = curv
+        if classify:
+            ret['inside'] = inside
+        return ret
+    
+    cpdef list createMeshLOD(self, factors, double angle = .25,
+                             int qualityNormals = NORMALS_SMOOTH, int threads = 1,
+                             bint weld = False, double creaseAngle = M_PI/6.,
+                             Mesher mesher = None):
+        '''
+        Create triangle meshes of face at several levels of detail.
+        
+        Return a list with one mesh for each deflection factor, in the
+        given order. Each level is equal to a createMesh call with that
+        factor, the bounding box, face indices and cache digest are
+        computed once for all levels. Several levels are meshed on
+        copies of the face, one thread per level up to threads, and
+        the triangulation of the face is left untouched.
+        
+        :param factors: sequence of deflection factors
+        
+        Other arguments as for createMesh. The deflection of the
+        mesher is replaced by each factor.
+        '''
+        cdef c_OCCFace *occ = <c_OCCFace *>self.thisptr
+        cdef vector[double] cfactors
+        cdef vector[c_OCCMesh *] meshes
+        cdef Mesh mesh
+        cdef list ret = []
+        cdef size_t i
+        
+        for factor in factors:
+            cfactors.push_back(factor)
+        
+        if mesher is None:
+            mesher = Mesher(.01, True, angle, True, qualityNormals, threads,
+                            weld, creaseAngle)
+        
+        if not occ.createMeshLOD(cfactors, mesher.params, meshes):
+            raise OCCError(errorMessage)
+        
+        for i in range(meshes.size()):
+            mesh = Mesh.__new__(Mesh, None)
+            mesh.thisptr = meshes[i]
+            mesh.setArrays()
+            ret.append(mesh)
+        
+        return ret
+    
+    cpdef createMeshStream(self, callback, double factor = .01, double angle = .25,
+                           int qualityNormals = NORMALS_SMOOTH, unsigned int chunkSize = 0,
+                           Mesher mesher = None):
+        '''
+        Stream triangle mesh of face in chunks to a callable.
+        
+        The callable is called as callback(firstFace, numFaces, mesh)
+        for each chunk. Chunks contains whole faces and are emitted
+        when they hold at least chunkSize triangles, or for every face
+        when chunkSize is zero. Each call gets a new mesh, which may be
+        kept after the call.
+        Return False or raise an exception to stop the stream.
+        
+        Edges shared with previous chunks are not repeated. Peak memory
+        is bounded by the chunk size as face triangulations are released
+        after extraction, unless a mesher without releaseTriangulation
+        is given. With several threads faces are triangulated in
+        batches of four per thread.
+        
+        :param callback: callable receiving mesh chunks
+        :param factor: deflection from true position
+        :param angle: max angle
+        :param qualityNormals: normal mode, see createMesh
+        :param chunkSize: minimum number of triangles in each chunk
+        :param mesher: Mesher object replacing factor, angle and
+                       qualityNormals. Weld is not supported.
+        '''
+        cdef c_OCCFace *occ = <c_OCCFace *>self.thisptr
+        cdef MeshStream stream = MeshStream(callback)
+        cdef c_OCCMeshCallbackSink *sink
+        cdef int ret
+        
+        if mesher is None:
+            mesher = Mesher(factor, True, angle, True, qualityNormals,
+                            releaseTriangulation = True)
+        
+        sink = new c_OCCMeshCallbackSink(<c_OCCMeshCallback>meshStreamCallback,
+                                         <void *>stream)
+        try:
+            ret = occ.createMeshStream(sink, mesher.params, chunkSize)
+        finally:
+            del sink
+        
+        stream.check(ret)
+        return self
+    
     cpdef createFace(self, arg):
         '''
         Create planar face from one or more wires or
@@ -509,4 +756,16 @@ cdef class FaceIterator:
 
     cpdef reset(self):
         '''Restart iteration'''
-        self.thisptr.reset()
\ No newline at end of file
+        self.thisptr.reset()
+
+cdef view.array surfaceCurvatures(int n, bint curvatures):
+    # (n, 2) principal curvature result, placeholder when not used
+    if not curvatures:
+        n = 1
+    return view.array(shape=(max(n, 1), 2), itemsize=sizeof(double), format="d")
+
+cdef view.array surfaceInside(int n, bint classify):
+    # (n,) inside flags result, placeholder when not used
+    if not classify:
+        n = 1
+    return view.array(shape=(max(n, 1),), itemsize=sizeof(unsigned char), format="B")
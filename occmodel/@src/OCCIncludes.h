@@ -22,12 +22,18 @@ using std::iostream;
 #include <gce_MakeElips.hxx>
 #include <gce_MakePln.hxx>
 #include <GCPnts_TangentialDeflection.hxx>
+#include <GCPnts_UniformAbscissa.hxx>
 #include <ElCLib.hxx>
 #include <GeomLProp_SLProps.hxx>
 #include <Geom_Circle.hxx>
 #include <Geom_TrimmedCurve.hxx>
 #include <Geom_BezierCurve.hxx>
 #include <Geom_BSplineCurve.hxx>
+#include <Geom_BezierSurface.hxx>
+#include <Geom_BSplineSurface.hxx>
+#include <Geom_RectangularTrimmedSurface.hxx>
+#include <Geom2d_BezierCurve.hxx>
+#include <Geom2d_BSplineCurve.hxx>
 #include <GeomAPI_Interpolate.hxx>
 #include <BRepMesh_Triangle.hxx>
 #include <BRepMesh_FastDiscret.hxx>
@@ -45,6 +51,7 @@ using std::iostream;
 #include <BRepBuilderAPI_MakeShell.hxx>
 #include <BRepBuilderAPI_MakeSolid.hxx>
 #include <BRepBuilderAPI_FindPlane.hxx>
+#include <BRepBuilderAPI_MakeShape.hxx>
 #include <BRepOffsetAPI_Sewing.hxx>
 #include <BRepLProp_SLProps.hxx>
 #include <BRepAdaptor_Surface.hxx>
@@ -74,6 +81,8 @@ using std::iostream;
 #include <BRepTools_WireExplorer.hxx>
 #include <BRepTools.hxx>
 #include <TopTools_IndexedMapOfShape.hxx>
+#include <NCollection_Map.hxx>
+#include <NCollection_DataMap.hxx>
 #include <TopExp.hxx>
 #include <BRepBuilderAPI_MakeVertex.hxx>
 #include <BRepBuilderAPI_MakeShell.hxx>
@@ -83,6 +92,7 @@ using std::iostream;
 #include <BRepLProp_SLProps.hxx>
 #include <BRepAdaptor_Surface.hxx>
 #include <BRepAdaptor_Curve.hxx>
+#include <BRepTopAdaptor_FClass2d.hxx>
 #include <Poly_Triangulation.hxx>
 #include <Poly_Array1OfTriangle.hxx>
 #include <Poly_Triangle.hxx>
@@ -91,10 +101,12 @@ using std::iostream;
 #include <IGESControl_Reader.hxx>
 #include <STEPControl_Reader.hxx>
 #include <TopoDS_Shape.hxx>
+#include <TopoDS_TShape.hxx>
 #include <TopoDS_Face.hxx>
 #include <IGESToBRep_Reader.hxx>
 #include <Interface_Static.hxx>
 #include <GeomAPI_ExtremaCurveCurve.hxx>
+#include <Standard.hxx>
 #include <Standard_ErrorHandler.hxx>
 #include <Standard_Failure.hxx>
 #include <ShapeUpgrade_ShellSewing.hxx>
@@ -104,6 +116,7 @@ using std::iostream;
 #include <BRepMesh.hxx>
 #include <BRepMesh_IncrementalMesh.hxx>
 #include <Poly_PolygonOnTriangulation.hxx>
+#include <Poly_Polygon3D.hxx>
 #include <BRepBndLib.hxx>
 #include <Bnd_Box.hxx>
 #include <ShapeAnalysis.hxx>
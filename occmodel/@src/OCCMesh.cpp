@@ -0,0 +1,1778 @@
+// Copyright 2012 by Runar Tenfjord, Tenko as.
+// See LICENSE.txt for details on conditions.
+#include "OCCModel.h"
+
+// Size work arrays for a face. Accumulators are cleared, the
+// remaining arrays are overwritten by the kernels.
+void OCCMeshScratch::resize(int nnodes, int ntriangles)
+{
+    const size_t n = std::max(nnodes, 1);
+    const size_t t = std::max(ntriangles, 1);
+    x.resize(n); y.resize(n); z.resize(n);
+    nx.assign(n, 0.0); ny.assign(n, 0.0); nz.assign(n, 0.0);
+    tx.resize(t); ty.resize(t); tz.resize(t);
+    tris.resize(3*t);
+    valid.resize(t);
+}
+
+void OCCMeshScratch::swap(OCCMeshScratch& other)
+{
+    x.swap(other.x); y.swap(other.y); z.swap(other.z);
+    nx.swap(other.nx); ny.swap(other.ny); nz.swap(other.nz);
+    tx.swap(other.tx); ty.swap(other.ty); tz.swap(other.tz);
+    tris.swap(other.tris);
+    valid.swap(other.valid);
+}
+
+void OCCMeshScratch::release()
+{
+    OCCMeshScratch empty;
+    this->swap(empty);
+}
+
+size_t OCCMesh::memoryUsage()
+{
+    return this->vertices.size()*sizeof(OCCStruct3f) +
+           this->normals.size()*sizeof(OCCStruct3f) +
+           this->triangles.size()*sizeof(OCCStruct3I) +
+           this->edgeindices.size()*sizeof(unsigned int) +
+           this->faceranges.size()*sizeof(int) +
+           this->edgeranges.size()*sizeof(int) +
+           this->edgekeys.size()*sizeof(OCCEdgeKey) +
+           this->interleaved.size()*sizeof(OCCVertexNormal) +
+           this->precisevertices.size()*sizeof(OCCStruct3d) +
+           // approximate size of map nodes and buckets
+           this->edgeseen.Extent()*(sizeof(OCCEdgeKey) + 3*sizeof(void *));
+}
+
+// Apply output settings of params. With originRelative the float
+// vertices are stored relative to the center of box, which keeps
+// precision for shapes placed far from the global origin.
+void OCCMesh::configure(const OCCMeshParams& params, const Bnd_Box& box)
+{
+    this->interleave = params.interleaved;
+    this->precise = params.preciseVertices;
+    this->deflection = box.IsVoid() ? 0. : params.chordalDeflection(box);
+    this->angle = params.angle;
+    this->origin.x = this->origin.y = this->origin.z = 0.;
+    if (params.originRelative && !box.IsVoid()) {
+        Standard_Real aXmin, aYmin, aZmin;
+        Standard_Real aXmax, aYmax, aZmax;
+        box.Get(aXmin, aYmin, aZmin, aXmax, aYmax, aZmax);
+        this->origin.x = .5*(aXmin + aXmax);
+        this->origin.y = .5*(aYmin + aYmax);
+        this->origin.z = .5*(aZmin + aZmax);
+    }
+}
+
+void OCCMesh::reserve(size_t nvertices, size_t ntriangles)
+{
+    this->vertices.reserve(nvertices);
+    this->normals.reserve(nvertices);
+    this->triangles.reserve(ntriangles);
+    if (this->interleave)
+        this->interleaved.reserve(nvertices);
+    if (this->precise)
+        this->precisevertices.reserve(nvertices);
+}
+
+// Count nodes and triangles of the face triangulations and reserve
+// the arrays once before extraction. Triangles skipped as degenerated
+// leave a little unused capacity.
+void OCCMesh::reserveFaces(const std::vector<TopoDS_Face>& faces)
+{
+    size_t nnodes = 0, ntriangles = 0;
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        if (faces[i].IsNull())
+            continue;
+        TopLoc_Location loc;
+        Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(faces[i], loc);
+        if (triangulation.IsNull())
+            continue;
+        nnodes += triangulation->NbNodes();
+        ntriangles += triangulation->NbTriangles();
+    }
+    this->reserve(this->vertices.size() + nnodes, this->triangles.size() + ntriangles);
+    this->faceranges.reserve(this->faceranges.size() + 5*faces.size());
+}
+
+// Append interleaved records of vertices [first, first + count)
+void OCCMesh::appendInterleaved(unsigned int first, unsigned int count)
+{
+    for (unsigned int i = first; i < first + count; i++) {
+        const OCCStruct3f& v = this->vertices[i];
+        const OCCStruct3f& n = this->normals[i];
+        OCCVertexNormal rec = {{v.x, v.y, v.z, 1.f}, {n.x, n.y, n.z, 0.f}};
+        this->interleaved.push_back(rec);
+    }
+}
+
+// Append absolute double precision positions of the triangulation nodes
+void OCCMesh::appendPrecise(const Handle(Poly_Triangulation)& triangulation,
+                            const TopLoc_Location& loc)
+{
+    gp_Trsf tr = loc;
+    const TColgp_Array1OfPnt& narr = triangulation->Nodes();
+    for (int i = 1; i <= triangulation->NbNodes(); i++) {
+        OCCStruct3d pnt;
+        narr(i).Coord(pnt.x, pnt.y, pnt.z);
+        tr.Transforms(pnt.x, pnt.y, pnt.z);
+        this->precisevertices.push_back(pnt);
+    }
+}
+
+// Rebuild interleaved buffer after the vertices are reordered
+void OCCMesh::updateInterleaved()
+{
+    if (!this->interleave)
+        return;
+    this->interleaved.clear();
+    this->appendInterleaved(0, this->vertices.size());
+}
+
+static double boxSize(const Bnd_Box& box)
+{
+    Standard_Real aXmin, aYmin, aZmin;
+    Standard_Real aXmax, aYmax, aZmax;
+    box.Get(aXmin, aYmin, aZmin, aXmax, aYmax, aZmax);
+    
+    Standard_Real maxd = fabs(aXmax - aXmin);
+    maxd = std::max(maxd, fabs(aYmax - aYmin));
+    maxd = std::max(maxd, fabs(aZmax - aZmin));
+    return maxd;
+}
+
+double OCCMeshParams::absoluteDeflection(const Bnd_Box& box) const
+{
+    if (!relative)
+        return deflection;
+    return deflection*boxSize(box);
+}
+
+// Bound of the chordal deflection BRepMesh meshes with. Relative to
+// edge, each edge uses the deflection times its size times a factor
+// clamped to [0.5, 2] against half the box size. The product is at
+// most half the box size, faces use the mean of their edges.
+double OCCMeshParams::chordalDeflection(const Bnd_Box& box) const
+{
+    const double defle = absoluteDeflection(box);
+    if (!relativeToEdge)
+        return defle;
+    return .5*defle*boxSize(box);
+}
+
+OCCMesh *createShapeMesh(const char *tag, const TopoDS_Shape& shape,
+                         const std::vector<TopoDS_Face>& faces, OCCMeshParams& params,
+                         bool inshape)
+{
+    std::vector<double> deflections(1, params.deflection);
+    std::vector<OCCMesh *> meshes;
+    if (!createShapeMeshLOD(tag, shape, faces, deflections, params, inshape, meshes))
+        return NULL;
+    return meshes[0];
+}
+
+// Mesh one level of detail of shape, the stage timings and faces
+// meshed are added to stats. Raises on failure.
+static OCCMesh *meshLevel(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces,
+                          const std::vector<int>& faceIds, const Bnd_Box& aBox,
+                          const OCCMeshParams& level, bool inshape, int threads,
+                          OCCMeshParams& stats)
+{
+    double start = meshTimer();
+    BRepMesh_FastDiscret MSH(level.absoluteDeflection(aBox), level.angle, aBox, inshape,
+                             inshape, level.relativeToEdge, Standard_True);
+    if (triangulateShape(MSH, shape, threads) > 0)
+        StdFail_NotDone::Raise("Failed to triangulate face");
+    stats.facesMeshed += faces.size();
+    stats.timeDiscretize += meshTimer() - start;
+    
+    start = meshTimer();
+    OCCMesh *mesh = new OCCMesh();
+    mesh->configure(level, aBox);
+    // faces BRepMesh left without triangulation are skipped
+    mesh->extractFaceMeshes(faces, faceIds, level.qualityNormals, threads,
+                            &stats.timeNormals);
+    stats.timeExtract += meshTimer() - start;
+    stats.timeEdges += mesh->edgeTime;
+    return mesh;
+}
+
+// Key the edge polylines of a mesh of copy on the matching edges of
+// shape. Both maps are in TopExp::MapShapes order.
+static void remapEdgeKeys(OCCMesh *mesh, const TopTools_IndexedMapOfShape& edges,
+                          const TopTools_IndexedMapOfShape& copyEdges)
+{
+    mesh->edgeseen.Clear();
+    for (unsigned int i = 0; i < mesh->edgekeys.size(); i++) {
+        const int idx = copyEdges.FindIndex(mesh->edgekeys[i].edge);
+        if (idx > 0)
+            mesh->edgekeys[i] = OCCEdgeKey(edges(idx));
+        mesh->edgeseen.Add(mesh->edgekeys[i]);
+    }
+}
+
+// Mesh shape at each deflection. The shape digest, bounding box and
+// face indices are computed once and shared by all levels. BRepMesh
+// keeps the polygons stored in a shape while they satisfy the
+// deflection, so levels can not share a discretization. A single
+// level is meshed in place as createShapeMesh does. Several levels are
+// meshed concurrently, one thread per level, each on its own copy of
+// the shape, which leaves the triangulation of shape untouched.
+int createShapeMeshLOD(const char *tag, const TopoDS_Shape& shape,
+                       const std::vector<TopoDS_Face>& faces,
+                       const std::vector<double>& deflections, OCCMeshParams& params,
+                       bool inshape, std::vector<OCCMesh *>& meshes)
+{
+    const int nlevels = deflections.size();
+    params.resetTimings();
+    meshes.assign(nlevels, (OCCMesh *)NULL);
+    
+    try {
+        OCCMeshCache& cache = OCCMeshCache::instance();
+        std::string digest;
+        if (cache.isEnabled())
+            digest = cache.shapeDigest(shape);
+        
+        std::vector<OCCMeshParams> levels;
+        std::vector<std::string> keys;
+        std::vector<int> pending;
+        for (int i = 0; i < nlevels; i++) {
+            OCCMeshParams level = params;
+            level.deflection = deflections[i];
+            
+            std::string key;
+            if (cache.isEnabled()) {
+                key = cache.makeKey(tag, digest, level);
+                meshes[i] = cache.lookup(key);
+                if (meshes[i] != NULL)
+                    continue;
+            }
+            levels.push_back(level);
+            keys.push_back(key);
+            pending.push_back(i);
+        }
+        const int npending = pending.size();
+        if (npending == 0)
+            return 1;
+        
+        double start = meshTimer();
+        Bnd_Box aBox;
+        std::vector<int> faceIds;
+        BRepBndLib::Add(shape, aBox);
+        faceIndices(shape, faces, faceIds);
+        params.timeBBox += meshTimer() - start;
+        
+        std::vector<TopoDS_Shape> copies;
+        std::vector<std::vector<TopoDS_Face> > copyFaces;
+        if (npending == 1) {
+            meshes[pending[0]] = meshLevel(shape, faces, faceIds, aBox, levels[0], inshape,
+                                           params.threads, params);
+        } else {
+            // copies share no geometry with shape and each other,
+            // the copy itself reads shape and is done serially
+            start = meshTimer();
+            copies.resize(npending);
+            copyFaces.resize(npending);
+            for (int i = 0; i < npending; i++) {
+                BRepBuilderAPI_Copy A;
+                A.Perform(shape);
+                copies[i] = A.Shape();
+                
+                TopTools_IndexedMapOfShape facemap;
+                TopExp::MapShapes(copies[i], TopAbs_FACE, facemap);
+                for (unsigned int j = 0; j < faces.size(); j++) {
+                    const TopoDS_Face& face = TopoDS::Face(facemap(faceIds[j] + 1));
+                    copyFaces[i].push_back(TopoDS::Face(face.Oriented(faces[j].Orientation())));
+                }
+            }
+            params.timeDiscretize += meshTimer() - start;
+            
+            // the error message is global, set it once after the loop
+            std::vector<OCCMeshParams> stats(npending, params);
+            std::vector<std::string> errors(npending);
+            int failed = 0;
+            {
+                MeshReentrant reentrant;
+                const int threads = std::min(meshThreads(params.threads), npending);
+                #pragma omp parallel for num_threads(threads) schedule(dynamic)
+                for (int i = 0; i < npending; i++) {
+                    stats[i].resetTimings();
+                    try {
+                        meshes[pending[i]] = meshLevel(copies[i], copyFaces[i], faceIds, aBox,
+                                                       levels[i], inshape, 1, stats[i]);
+                    } catch(Standard_Failure &err) {
+                        Handle_Standard_Failure e = Standard_Failure::Caught();
+                        const Standard_CString msg = e->GetMessageString();
+                        if (msg != NULL && strlen(msg) > 1)
+                            errors[i] = msg;
+                        #pragma omp atomic
+                        failed++;
+                    }
+                }
+            }
+            
+            // stage timings are summed over levels
+            for (int i = 0; i < npending; i++) {
+                params.timeDiscretize += stats[i].timeDiscretize;
+                params.timeExtract += stats[i].timeExtract;
+                params.timeNormals += stats[i].timeNormals;
+                params.timeEdges += stats[i].timeEdges;
+                params.facesMeshed += stats[i].facesMeshed;
+            }
+            
+            if (failed) {
+                const char *msg = "Failed to mesh object";
+                for (int i = 0; i < npending; i++) {
+                    if (!errors[i].empty()) {
+                        msg = errors[i].c_str();
+                        break;
+                    }
+                }
+                setErrorMessage(msg);
+                for (int i = 0; i < nlevels; i++)
+                    delete meshes[i];
+                meshes.clear();
+                return 0;
+            }
+            
+            // edge polylines are keyed on the edges of shape, as
+            // updateShapeMesh looks them up there
+            TopTools_IndexedMapOfShape edges;
+            TopExp::MapShapes(shape, TopAbs_EDGE, edges);
+            for (int i = 0; i < npending; i++) {
+                TopTools_IndexedMapOfShape copyEdges;
+                TopExp::MapShapes(copies[i], TopAbs_EDGE, copyEdges);
+                remapEdgeKeys(meshes[pending[i]], edges, copyEdges);
+            }
+        }
+        
+        for (int i = 0; i < npending; i++) {
+            OCCMesh *mesh = meshes[pending[i]];
+            
+            start = meshTimer();
+            const std::vector<TopoDS_Face>& meshFaces = npending == 1 ? faces : copyFaces[i];
+            if (params.weld && !mesh->weld(meshFaces, params.creaseAngle)) {
+                for (int j = 0; j < nlevels; j++)
+                    delete meshes[j];
+                meshes.clear();
+                return 0;
+            }
+            params.timeExtract += meshTimer() - start;
+            
+            if (cache.isEnabled())
+                cache.insert(keys[i], mesh);
+        }
+        
+        // the mesh holds a copy, free the triangulations of the shape
+        if (npending == 1 && params.releaseTriangulation)
+            BRepTools::Clean(shape);
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to mesh object");
+        }
+        for (unsigned int j = 0; j < meshes.size(); j++)
+            delete meshes[j];
+        meshes.clear();
+        return 0;
+    }
+    return 1;
+}
+
+int streamShapeMesh(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces,
+                    OCCMeshSink *sink, OCCMeshParams& params, bool inshape,
+                    unsigned int chunkSize)
+{
+    params.resetTimings();
+    if (params.weld) {
+        setErrorMessage("Weld not supported by mesh stream");
+        return 0;
+    }
+    
+    try {
+        const double start = meshTimer();
+        Bnd_Box aBox;
+        BRepBndLib::Add(shape, aBox);
+        const double defle = params.absoluteDeflection(aBox);
+        params.timeBBox = meshTimer() - start;
+        
+        BRepMesh_FastDiscret MSH(defle, params.angle, aBox, inshape, inshape, 
+                                 params.relativeToEdge, Standard_True);
+        
+        std::vector<int> faceIds;
+        faceIndices(shape, faces, faceIds);
+        
+        OCCMesh staging;
+        staging.configure(params, aBox);
+        return staging.streamFaceMeshes(MSH, faces, faceIds, sink, params, chunkSize);
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to mesh object");
+        }
+        return 0;
+    }
+}
+
+OCCMeshCache& OCCMeshCache::instance()
+{
+    static OCCMeshCache cache;
+    return cache;
+}
+
+OCCMeshCache::OCCMeshCache()
+{
+    budget = 0;
+    used = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+#ifdef _OPENMP
+    omp_init_lock(&mutex);
+#endif
+}
+
+OCCMeshCache::~OCCMeshCache()
+{
+    clear();
+#ifdef _OPENMP
+    omp_destroy_lock(&mutex);
+#endif
+}
+
+// The cache is shared by all callers, entries and counters are only
+// touched with the lock held. Without OpenMP the cache is single
+// threaded and the lock does nothing.
+void OCCMeshCache::lock()
+{
+#ifdef _OPENMP
+    omp_set_lock(&mutex);
+#endif
+}
+
+void OCCMeshCache::unlock()
+{
+#ifdef _OPENMP
+    omp_unset_lock(&mutex);
+#endif
+}
+
+std::string OCCMeshCache::shapeDigest(const TopoDS_Shape& shape)
+{
+    // Triangulations are part of the BREP output and the key must
+    // only depend on the geometry. Serialize a copy without them,
+    // the shape of the caller is left untouched.
+    BRepBuilderAPI_Copy A;
+    A.Perform(shape);
+    const TopoDS_Shape& copy = A.Shape();
+    BRepTools::Clean(copy);
+    
+    std::stringstream brep;
+    OCCTools::writeBREP(brep, copy);
+    const std::string data = brep.str();
+    
+    // 64 bit FNV-1a combined with a second multiplicative hash
+    uint64_t h1 = 14695981039346656037ULL;
+    uint64_t h2 = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < data.size(); i++) {
+        const uint64_t c = (unsigned char)data[i];
+        h1 = (h1 ^ c) * 1099511628211ULL;
+        h2 = ((h2 << 5) | (h2 >> 59)) ^ c;
+        h2 *= 0xC2B2AE3D27D4EB4FULL;
+    }
+    
+    std::stringstream ret;
+    ret << std::hex << std::setfill('0') << std::setw(16) << h1
+        << std::setw(16) << h2 << std::dec << ':' << data.size();
+    return ret.str();
+}
+
+std::string OCCMeshCache::makeKey(const char *tag, const std::string& digest,
+                                  const OCCMeshParams& params)
+{
+    std::stringstream key;
+    key.precision(17);
+    key << tag << ':' << digest << ':';
+    key << params.deflection << ':' << params.relative << ':';
+    key << params.angle << ':' << params.relativeToEdge << ':';
+    key << params.qualityNormals << ':' << params.interleaved << ':';
+    key << params.originRelative << ':' << params.preciseVertices;
+    if (params.weld)
+        key << ':' << params.creaseAngle;
+    return key.str();
+}
+
+OCCMesh *OCCMeshCache::lookup(const std::string& key)
+{
+    OCCMesh *ret = NULL;
+    lock();
+    std::map<std::string, EntryList::iterator>::iterator itr = index.find(key);
+    if (itr == index.end()) {
+        misses++;
+    } else {
+        hits++;
+        // move to front of LRU list
+        entries.splice(entries.begin(), entries, itr->second);
+        ret = new OCCMesh(*entries.front().second);
+    }
+    unlock();
+    return ret;
+}
+
+void OCCMeshCache::insert(const std::string& key, OCCMesh *mesh)
+{
+    const size_t size = mesh->memoryUsage();
+    lock();
+    if (size <= budget && index.count(key) == 0) {
+        entries.push_front(Entry(key, new OCCMesh(*mesh)));
+        index[key] = entries.begin();
+        used += size;
+        evict(budget);
+    }
+    unlock();
+}
+
+void OCCMeshCache::evict(size_t limit)
+{
+    while (used > limit && !entries.empty()) {
+        Entry& last = entries.back();
+        used -= last.second->memoryUsage();
+        index.erase(last.first);
+        delete last.second;
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+void OCCMeshCache::setBudget(size_t bytes)
+{
+    lock();
+    budget = bytes;
+    evict(budget);
+    unlock();
+}
+
+void OCCMeshCache::clear()
+{
+    lock();
+    for (EntryList::iterator itr = entries.begin(); itr != entries.end(); ++itr)
+        delete itr->second;
+    entries.clear();
+    index.clear();
+    used = 0;
+    unlock();
+}
+
+struct WeldCell {
+    int x, y, z;
+    bool operator<(const WeldCell& other) const {
+        if (x != other.x) return x < other.x;
+        if (y != other.y) return y < other.y;
+        return z < other.z;
+    }
+};
+
+struct WeldCluster {
+    unsigned int index;
+    OCCStruct3f normal;
+    int next;
+};
+
+static unsigned int weldFind(std::vector<unsigned int>& parent, unsigned int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void weldUnion(std::vector<unsigned int>& parent, unsigned int a, unsigned int b)
+{
+    a = weldFind(parent, a);
+    b = weldFind(parent, b);
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+static double weldDistance(const OCCStruct3f& a, const OCCStruct3f& b)
+{
+    const double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return dx*dx + dy*dy + dz*dz;
+}
+
+int OCCMesh::weld(const std::vector<TopoDS_Face>& faces, double creaseAngle)
+{
+    const unsigned int nvertices = this->vertices.size();
+    const size_t oldSize = this->memoryUsage();
+    
+    std::vector<unsigned int> parent(nvertices);
+    for (unsigned int i = 0; i < nvertices; i++)
+        parent[i] = i;
+    std::vector<unsigned int> boundary;
+    
+    try {
+        // Pair up the nodes of edges shared between faces (and seam
+        // edges used twice by the same face) from their polygons on
+        // the face triangulations.
+        TopTools_IndexedMapOfShape edgemap;
+        std::vector<std::vector<unsigned int> > edgenodes;
+        unsigned int vsize = 0;
+        
+        for (unsigned int i = 0; i < faces.size(); i++) {
+            const TopoDS_Face& face = faces[i];
+            if (face.IsNull())
+                continue;
+            
+            TopLoc_Location loc;
+            Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, loc);
+            if (triangulation.IsNull())
+                continue;
+            
+            if (vsize + triangulation->NbNodes() > nvertices)
+                StdFail_NotDone::Raise("Mesh does not match faces");
+            
+            TopExp_Explorer ex;
+            for (ex.Init(face, TopAbs_EDGE); ex.More(); ex.Next()) {
+                const TopoDS_Edge& edge = TopoDS::Edge(ex.Current());
+                Handle(Poly_PolygonOnTriangulation) edgepoly = BRep_Tool::PolygonOnTriangulation(edge, triangulation, loc);
+                if (edgepoly.IsNull())
+                    continue;
+                
+                std::vector<unsigned int> nodes;
+                const TColStd_Array1OfInteger& edgeind = edgepoly->Nodes();
+                for (int j = edgeind.Lower(); j <= edgeind.Upper(); j++) {
+                    nodes.push_back(vsize + edgeind(j) - 1);
+                    boundary.push_back(vsize + edgeind(j) - 1);
+                }
+                
+                const int index = edgemap.FindIndex(edge);
+                if (index == 0) {
+                    edgemap.Add(edge);
+                    edgenodes.push_back(nodes);
+                    continue;
+                }
+                
+                const std::vector<unsigned int>& other = edgenodes[index - 1];
+                const unsigned int n = nodes.size();
+                if (n == 0 || other.size() != n)
+                    continue;
+                
+                const bool reverse = weldDistance(vertices[nodes[0]], vertices[other[0]]) >
+                                     weldDistance(vertices[nodes[0]], vertices[other[n - 1]]);
+                for (unsigned int j = 0; j < n; j++)
+                    weldUnion(parent, nodes[j], other[reverse ? n - 1 - j : j]);
+            }
+            vsize += triangulation->NbNodes();
+        }
+        
+        if (vsize != nvertices)
+            StdFail_NotDone::Raise("Mesh does not match faces");
+        
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to weld mesh");
+        }
+        return 0;
+    }
+    
+    // Spatial hash fallback for boundary nodes not matched by edge
+    // polygons (degenerated edges, polygons with different node count).
+    if (!boundary.empty()) {
+        float lo[3], hi[3];
+        lo[0] = hi[0] = vertices[boundary[0]].x;
+        lo[1] = hi[1] = vertices[boundary[0]].y;
+        lo[2] = hi[2] = vertices[boundary[0]].z;
+        for (unsigned int i = 1; i < boundary.size(); i++) {
+            const OCCStruct3f& v = vertices[boundary[i]];
+            lo[0] = std::min(lo[0], v.x); hi[0] = std::max(hi[0], v.x);
+            lo[1] = std::min(lo[1], v.y); hi[1] = std::max(hi[1], v.y);
+            lo[2] = std::min(lo[2], v.z); hi[2] = std::max(hi[2], v.z);
+        }
+        double size = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+        const double tol = std::max(1.0e-6*size, 1.0e-9);
+        
+        std::map<WeldCell, std::vector<unsigned int> > grid;
+        for (unsigned int i = 0; i < boundary.size(); i++) {
+            const unsigned int idx = boundary[i];
+            const OCCStruct3f& v = vertices[idx];
+            WeldCell cell;
+            cell.x = (int)floor((v.x - lo[0]) / tol);
+            cell.y = (int)floor((v.y - lo[1]) / tol);
+            cell.z = (int)floor((v.z - lo[2]) / tol);
+            
+            for (int dx = -1; dx <= 1; dx++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dz = -1; dz <= 1; dz++) {
+                        WeldCell other = {cell.x + dx, cell.y + dy, cell.z + dz};
+                        std::map<WeldCell, std::vector<unsigned int> >::iterator itr = grid.find(other);
+                        if (itr == grid.end())
+                            continue;
+                        const std::vector<unsigned int>& cand = itr->second;
+                        for (unsigned int j = 0; j < cand.size(); j++) {
+                            if (weldDistance(v, vertices[cand[j]]) <= tol*tol)
+                                weldUnion(parent, idx, cand[j]);
+                        }
+                    }
+                }
+            }
+            grid[cell].push_back(idx);
+        }
+    }
+    
+    // Merge each group of coincident nodes, splitting it in clusters
+    // where normals differ more than the crease angle.
+    const double cosCrease = cos(creaseAngle);
+    std::vector<unsigned int> mapping(nvertices);
+    std::vector<unsigned int> created(nvertices + 1);
+    std::vector<int> head(nvertices, -1);
+    std::vector<WeldCluster> clusters;
+    std::vector<OCCStruct3f> newVertices;
+    std::vector<OCCStruct3d> newPrecise;
+    std::vector<gp_Vec> sums;
+    
+    for (unsigned int i = 0; i < nvertices; i++) {
+        created[i] = newVertices.size();
+        const unsigned int root = weldFind(parent, i);
+        const OCCStruct3f& nor = normals[i];
+        
+        int c = head[root];
+        for (; c >= 0; c = clusters[c].next) {
+            const OCCStruct3f& cn = clusters[c].normal;
+            if (cn.x*nor.x + cn.y*nor.y + cn.z*nor.z >= cosCrease)
+                break;
+        }
+        
+        if (c < 0) {
+            WeldCluster cluster;
+            cluster.index = newVertices.size();
+            cluster.normal = nor;
+            cluster.next = head[root];
+            head[root] = clusters.size();
+            clusters.push_back(cluster);
+            
+            newVertices.push_back(vertices[i]);
+            if (precise)
+                newPrecise.push_back(precisevertices[i]);
+            sums.push_back(gp_Vec(0.0, 0.0, 0.0));
+            c = head[root];
+        }
+        
+        const unsigned int index = clusters[c].index;
+        mapping[i] = index;
+        sums[index] = sums[index] + gp_Vec(nor.x, nor.y, nor.z);
+    }
+    created[nvertices] = newVertices.size();
+    
+    std::vector<OCCStruct3f> newNormals(newVertices.size());
+    for (unsigned int i = 0; i < newVertices.size(); i++) {
+        gp_Vec normal = sums[i];
+        if (normal.SquareMagnitude() > 1.0e-10)
+            normal.Normalize();
+        newNormals[i].x = (float)normal.X();
+        newNormals[i].y = (float)normal.Y();
+        newNormals[i].z = (float)normal.Z();
+    }
+    
+    // remap triangles and drop triangles collapsed by the weld
+    std::vector<unsigned int> kept(this->triangles.size() + 1);
+    unsigned int ntriangles = 0;
+    for (unsigned int i = 0; i < this->triangles.size(); i++) {
+        kept[i] = ntriangles;
+        OCCStruct3I tri = this->triangles[i];
+        tri.i = mapping[tri.i];
+        tri.j = mapping[tri.j];
+        tri.k = mapping[tri.k];
+        if (tri.i == tri.j || tri.j == tri.k || tri.k == tri.i)
+            continue;
+        this->triangles[ntriangles++] = tri;
+    }
+    kept[this->triangles.size()] = ntriangles;
+    this->triangles.resize(ntriangles);
+    
+    // vertex range of a face now holds the vertices first used by it
+    for (unsigned int i = 0; i < this->faceranges.size(); i += 5) {
+        int *range = &this->faceranges[i];
+        const int tlast = range[0] + range[1], vlast = range[2] + range[3];
+        range[0] = kept[range[0]];
+        range[1] = kept[tlast] - range[0];
+        range[2] = created[range[2]];
+        range[3] = created[vlast] - range[2];
+    }
+    
+    for (unsigned int i = 0; i < this->edgeindices.size(); i++)
+        this->edgeindices[i] = mapping[this->edgeindices[i]];
+    
+    this->vertices.swap(newVertices);
+    this->normals.swap(newNormals);
+    this->precisevertices.swap(newPrecise);
+    this->updateInterleaved();
+    
+    this->weldsaved = oldSize - this->memoryUsage();
+    return 1;
+}
+
+// Quadric of squared distances to a set of planes, stored as the
+// upper triangle of the symmetric 4x4 matrix.
+static void quadricAddPlane(double *q, double a, double b, double c, double d)
+{
+    q[0] += a*a; q[1] += a*b; q[2] += a*c; q[3] += a*d;
+    q[4] += b*b; q[5] += b*c; q[6] += b*d;
+    q[7] += c*c; q[8] += c*d;
+    q[9] += d*d;
+}
+
+static double quadricError(const double *q, const OCCStruct3f& p)
+{
+    const double x = p.x, y = p.y, z = p.z;
+    return q[0]*x*x + 2.0*q[1]*x*y + 2.0*q[2]*x*z + 2.0*q[3]*x +
+           q[4]*y*y + 2.0*q[5]*y*z + 2.0*q[6]*y +
+           q[7]*z*z + 2.0*q[8]*z +
+           q[9];
+}
+
+static gp_Vec triangleNormal(const OCCStruct3f& a, const OCCStruct3f& b, const OCCStruct3f& c)
+{
+    const gp_Vec e1(b.x - a.x, b.y - a.y, b.z - a.z);
+    const gp_Vec e2(c.x - a.x, c.y - a.y, c.z - a.z);
+    return e1.Crossed(e2);
+}
+
+// Collapse of vertex 'from' into vertex 'to'. Stale entries are
+// detected by the vertex stamps when popped from the heap.
+struct DecimateCollapse {
+    double cost;
+    unsigned int from;
+    unsigned int to;
+    unsigned int fromStamp;
+    unsigned int toStamp;
+    bool operator<(const DecimateCollapse& other) const {
+        // std::priority_queue returns the largest, reverse for min-heap
+        return cost > other.cost;
+    }
+};
+
+class MeshDecimator {
+    public:
+        MeshDecimator(OCCMesh *mesh);
+        void lockBoundary();
+        double run(unsigned int target, double maxError);
+        void compact();
+    private:
+        OCCMesh *mesh;
+        unsigned int ntriangles;
+        std::vector<double> quadrics;
+        std::vector<std::vector<unsigned int> > vtris;
+        std::vector<unsigned int> stamp;
+        std::vector<bool> locked;
+        std::vector<bool> removed;
+        std::vector<bool> alive;
+        std::priority_queue<DecimateCollapse> heap;
+        void neighbours(unsigned int v, std::vector<unsigned int>& ret);
+        void push(unsigned int from, unsigned int to);
+        bool isValid(unsigned int from, unsigned int to);
+        void collapse(unsigned int from, unsigned int to);
+};
+
+MeshDecimator::MeshDecimator(OCCMesh *mesh)
+{
+    const unsigned int nvertices = mesh->vertices.size();
+    this->mesh = mesh;
+    this->ntriangles = mesh->triangles.size();
+    quadrics.assign(10*nvertices, 0.0);
+    vtris.resize(nvertices);
+    stamp.assign(nvertices, 0);
+    locked.assign(nvertices, false);
+    removed.assign(nvertices, false);
+    alive.assign(ntriangles, true);
+    
+    for (unsigned int t = 0; t < ntriangles; t++) {
+        const OCCStruct3I& tri = mesh->triangles[t];
+        const OCCStruct3f& a = mesh->vertices[tri.i];
+        gp_Vec n = triangleNormal(a, mesh->vertices[tri.j], mesh->vertices[tri.k]);
+        if (n.SquareMagnitude() > 0.0) {
+            n.Normalize();
+            const double d = -(n.X()*a.x + n.Y()*a.y + n.Z()*a.z);
+            quadricAddPlane(&quadrics[10*tri.i], n.X(), n.Y(), n.Z(), d);
+            quadricAddPlane(&quadrics[10*tri.j], n.X(), n.Y(), n.Z(), d);
+            quadricAddPlane(&quadrics[10*tri.k], n.X(), n.Y(), n.Z(), d);
+        }
+        vtris[tri.i].push_back(t);
+        vtris[tri.j].push_back(t);
+        vtris[tri.k].push_back(t);
+    }
+}
+
+// Lock vertices of edge polylines and of mesh edges which are not
+// shared by exactly two triangles of the same face.
+void MeshDecimator::lockBoundary()
+{
+    for (unsigned int i = 0; i < mesh->edgeindices.size(); i++)
+        locked[mesh->edgeindices[i]] = true;
+    
+    std::vector<int> faceOf(ntriangles, -1);
+    for (unsigned int i = 0; i < mesh->faceranges.size(); i += 5) {
+        const int *range = &mesh->faceranges[i];
+        for (int t = range[0]; t < range[0] + range[1]; t++)
+            faceOf[t] = i / 5;
+    }
+    
+    // sort (min, max, triangle) of all edges to find neighbours
+    std::vector<std::pair<std::pair<unsigned int, unsigned int>, unsigned int> > edges;
+    edges.reserve(3*ntriangles);
+    for (unsigned int t = 0; t < ntriangles; t++) {
+        const OCCStruct3I& tri = mesh->triangles[t];
+        const unsigned int v[3] = {tri.i, tri.j, tri.k};
+        for (int e = 0; e < 3; e++) {
+            const unsigned int a = v[e], b = v[(e + 1) % 3];
+            edges.push_back(std::make_pair(std::make_pair(std::min(a, b), std::max(a, b)), t));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    
+    for (unsigned int i = 0; i < edges.size();) {
+        unsigned int j = i + 1;
+        while (j < edges.size() && edges[j].first == edges[i].first)
+            j++;
+        
+        if (j - i != 2 || faceOf[edges[i].second] != faceOf[edges[i + 1].second]) {
+            locked[edges[i].first.first] = true;
+            locked[edges[i].first.second] = true;
+        }
+        i = j;
+    }
+}
+
+void MeshDecimator::neighbours(unsigned int v, std::vector<unsigned int>& ret)
+{
+    ret.clear();
+    std::vector<unsigned int>& tris = vtris[v];
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < tris.size(); i++) {
+        const unsigned int t = tris[i];
+        if (!alive[t])
+            continue;
+        tris[n++] = t;
+        
+        const OCCStruct3I& tri = mesh->triangles[t];
+        if (tri.i != v) ret.push_back(tri.i);
+        if (tri.j != v) ret.push_back(tri.j);
+        if (tri.k != v) ret.push_back(tri.k);
+    }
+    tris.resize(n);
+    
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+}
+
+void MeshDecimator::push(unsigned int from, unsigned int to)
+{
+    double q[10];
+    for (int i = 0; i < 10; i++)
+        q[i] = quadrics[10*from + i] + quadrics[10*to + i];
+    
+    DecimateCollapse collapse;
+    collapse.cost = std::max(0.0, quadricError(q, mesh->vertices[to]));
+    collapse.from = from;
+    collapse.to = to;
+    collapse.fromStamp = stamp[from];
+    collapse.toStamp = stamp[to];
+    heap.push(collapse);
+}
+
+bool MeshDecimator::isValid(unsigned int from, unsigned int to)
+{
+    std::vector<unsigned int> nfrom, nto, common;
+    neighbours(from, nfrom);
+    if (!std::binary_search(nfrom.begin(), nfrom.end(), to))
+        return false;
+    
+    // link condition, only the two triangles of the edge may collapse
+    neighbours(to, nto);
+    std::set_intersection(nfrom.begin(), nfrom.end(), nto.begin(), nto.end(),
+                          std::back_inserter(common));
+    if (common.size() != 2)
+        return false;
+    
+    // the remaining triangles of 'from' must not flip or degenerate
+    const OCCStruct3f& p = mesh->vertices[to];
+    const std::vector<unsigned int>& tris = vtris[from];
+    for (unsigned int i = 0; i < tris.size(); i++) {
+        const OCCStruct3I& tri = mesh->triangles[tris[i]];
+        if (tri.i == to || tri.j == to || tri.k == to)
+            continue;
+        
+        const OCCStruct3f& a = mesh->vertices[tri.i];
+        const OCCStruct3f& b = mesh->vertices[tri.j];
+        const OCCStruct3f& c = mesh->vertices[tri.k];
+        const gp_Vec before = triangleNormal(a, b, c);
+        if (before.SquareMagnitude() == 0.0)
+            continue;
+        
+        const gp_Vec after = triangleNormal(tri.i == from ? p : a,
+                                            tri.j == from ? p : b,
+                                            tri.k == from ? p : c);
+        if (after.SquareMagnitude() == 0.0 || before.Dot(after) <= 0.0)
+            return false;
+    }
+    return true;
+}
+
+void MeshDecimator::collapse(unsigned int from, unsigned int to)
+{
+    const std::vector<unsigned int>& tris = vtris[from];
+    for (unsigned int i = 0; i < tris.size(); i++) {
+        const unsigned int t = tris[i];
+        OCCStruct3I& tri = mesh->triangles[t];
+        if (tri.i == to || tri.j == to || tri.k == to) {
+            alive[t] = false;
+            ntriangles--;
+            continue;
+        }
+        if (tri.i == from) tri.i = to;
+        if (tri.j == from) tri.j = to;
+        if (tri.k == from) tri.k = to;
+        vtris[to].push_back(t);
+    }
+    vtris[from].clear();
+    removed[from] = true;
+    
+    for (int i = 0; i < 10; i++)
+        quadrics[10*to + i] += quadrics[10*from + i];
+    stamp[to]++;
+    
+    std::vector<unsigned int> nto;
+    neighbours(to, nto);
+    for (unsigned int i = 0; i < nto.size(); i++) {
+        if (!locked[to])
+            push(to, nto[i]);
+        if (!locked[nto[i]])
+            push(nto[i], to);
+    }
+}
+
+// Collapse edges in order of cost. Return the largest cost accepted,
+// the squared distance bound of the moved vertices.
+double MeshDecimator::run(unsigned int target, double maxError)
+{
+    std::vector<unsigned int> nv;
+    for (unsigned int v = 0; v < vtris.size(); v++) {
+        if (locked[v])
+            continue;
+        neighbours(v, nv);
+        for (unsigned int i = 0; i < nv.size(); i++)
+            push(v, nv[i]);
+    }
+    
+    const double maxCost = maxError*maxError;
+    double worst = 0.0;
+    while (!heap.empty() && (target == 0 || ntriangles > target)) {
+        const DecimateCollapse top = heap.top();
+        heap.pop();
+        
+        if (maxError > 0.0 && top.cost > maxCost)
+            break;
+        if (removed[top.from] || removed[top.to])
+            continue;
+        if (stamp[top.from] != top.fromStamp || stamp[top.to] != top.toStamp)
+            continue;
+        if (!isValid(top.from, top.to))
+            continue;
+        
+        collapse(top.from, top.to);
+        worst = std::max(worst, top.cost);
+    }
+    return worst;
+}
+
+// Drop collapsed triangles and vertices keeping the order of the rest
+void MeshDecimator::compact()
+{
+    const unsigned int nvertices = mesh->vertices.size();
+    const unsigned int oldTriangles = mesh->triangles.size();
+    
+    std::vector<unsigned int> created(nvertices + 1);
+    unsigned int nkept = 0;
+    for (unsigned int i = 0; i < nvertices; i++) {
+        created[i] = nkept;
+        if (removed[i])
+            continue;
+        mesh->vertices[nkept] = mesh->vertices[i];
+        mesh->normals[nkept] = mesh->normals[i];
+        if (mesh->precise)
+            mesh->precisevertices[nkept] = mesh->precisevertices[i];
+        nkept++;
+    }
+    created[nvertices] = nkept;
+    mesh->vertices.resize(nkept);
+    mesh->normals.resize(nkept);
+    if (mesh->precise)
+        mesh->precisevertices.resize(nkept);
+    
+    std::vector<unsigned int> kept(oldTriangles + 1);
+    nkept = 0;
+    for (unsigned int i = 0; i < oldTriangles; i++) {
+        kept[i] = nkept;
+        if (!alive[i])
+            continue;
+        OCCStruct3I tri = mesh->triangles[i];
+        tri.i = created[tri.i];
+        tri.j = created[tri.j];
+        tri.k = created[tri.k];
+        mesh->triangles[nkept++] = tri;
+    }
+    kept[oldTriangles] = nkept;
+    mesh->triangles.resize(nkept);
+    
+    for (unsigned int i = 0; i < mesh->faceranges.size(); i += 5) {
+        int *range = &mesh->faceranges[i];
+        const int tlast = range[0] + range[1], vlast = range[2] + range[3];
+        range[0] = kept[range[0]];
+        range[1] = kept[tlast] - range[0];
+        range[2] = created[range[2]];
+        range[3] = created[vlast] - range[2];
+    }
+    
+    for (unsigned int i = 0; i < mesh->edgeindices.size(); i++)
+        mesh->edgeindices[i] = created[mesh->edgeindices[i]];
+    
+    mesh->updateInterleaved();
+}
+
+int OCCMesh::decimate(unsigned int target, double maxError)
+{
+    const unsigned int nvertices = this->vertices.size();
+    if (this->normals.size() != nvertices) {
+        setErrorMessage("Mesh normals does not match vertices");
+        return 0;
+    }
+    for (unsigned int i = 0; i < this->triangles.size(); i++) {
+        const OCCStruct3I& tri = this->triangles[i];
+        if (tri.i >= nvertices || tri.j >= nvertices || tri.k >= nvertices) {
+            setErrorMessage("Triangle index out of range");
+            return 0;
+        }
+    }
+    
+    if (target == 0 && maxError <= 0.0)
+        return 1;
+    
+    MeshDecimator decimator(this);
+    decimator.lockBoundary();
+    const double worst = decimator.run(target, maxError);
+    decimator.compact();
+    if (this->deflection > 0.0)
+        this->deflection += sqrt(worst);
+    return 1;
+}
+
+// Mass properties by the divergence theorem. Each triangle spans a
+// tetrahedron with the mesh origin and the signed moments of the
+// tetrahedra sum to the moments of the enclosed solid, accumulated
+// in one pass over the triangles.
+//
+// The surface is within deflection of the mesh, so the enclosed
+// volume differs at most by area*deflection. The moments of that
+// shell about the centre are bounded by its radius. The area error is
+// only an estimate, it assumes the triangle normals are within angle
+// of the surface normals, which BRepMesh does not guarantee.
+int OCCMesh::massProperties(OCCMassProperties& props, int threads)
+{
+    const unsigned int nvertices = this->vertices.size();
+    const int ntriangles = (int)this->triangles.size();
+    if (ntriangles == 0) {
+        setErrorMessage("Mesh has no triangles");
+        return 0;
+    }
+    for (int i = 0; i < ntriangles; i++) {
+        const OCCStruct3I& tri = this->triangles[i];
+        if (tri.i >= nvertices || tri.j >= nvertices || tri.k >= nvertices) {
+            setErrorMessage("Triangle index out of range");
+            return 0;
+        }
+    }
+    
+    threads = meshThreads(threads);
+    const OCCStruct3f *vert = &this->vertices[0];
+    const OCCStruct3I *tris = &this->triangles[0];
+    
+    double area = 0.0, vol = 0.0;
+    double mx = 0.0, my = 0.0, mz = 0.0;
+    double xx = 0.0, yy = 0.0, zz = 0.0, xy = 0.0, xz = 0.0, yz = 0.0;
+    
+    #pragma omp parallel for num_threads(threads) reduction(+:area,vol,mx,my,mz,xx,yy,zz,xy,xz,yz)
+    for (int t = 0; t < ntriangles; t++) {
+        const OCCStruct3f& a = vert[tris[t].i];
+        const OCCStruct3f& b = vert[tris[t].j];
+        const OCCStruct3f& c = vert[tris[t].k];
+        const double ex = (double)b.x - a.x, ey = (double)b.y - a.y, ez = (double)b.z - a.z;
+        const double fx = (double)c.x - a.x, fy = (double)c.y - a.y, fz = (double)c.z - a.z;
+        const double nx = ey*fz - ez*fy;
+        const double ny = ez*fx - ex*fz;
+        const double nz = ex*fy - ey*fx;
+        area += .5*sqrt(nx*nx + ny*ny + nz*nz);
+        
+        // a.(b x c) == a.((b - a) x (c - a))
+        const double v = (a.x*nx + a.y*ny + a.z*nz)/6.0;
+        const double sx = (double)a.x + b.x + c.x;
+        const double sy = (double)a.y + b.y + c.y;
+        const double sz = (double)a.z + b.z + c.z;
+        vol += v;
+        mx += v*sx/4.0;
+        my += v*sy/4.0;
+        mz += v*sz/4.0;
+        
+        // second moments of the tetrahedron (0, a, b, c)
+        const double pxx = (double)a.x*a.x + (double)b.x*b.x + (double)c.x*c.x;
+        const double pyy = (double)a.y*a.y + (double)b.y*b.y + (double)c.y*c.y;
+        const double pzz = (double)a.z*a.z + (double)b.z*b.z + (double)c.z*c.z;
+        const double pxy = (double)a.x*a.y + (double)b.x*b.y + (double)c.x*c.y;
+        const double pxz = (double)a.x*a.z + (double)b.x*b.z + (double)c.x*c.z;
+        const double pyz = (double)a.y*a.z + (double)b.y*b.z + (double)c.y*c.z;
+        xx += v*(sx*sx + pxx)/20.0;
+        yy += v*(sy*sy + pyy)/20.0;
+        zz += v*(sz*sz + pzz)/20.0;
+        xy += v*(sx*sy + pxy)/20.0;
+        xz += v*(sx*sz + pxz)/20.0;
+        yz += v*(sy*sz + pyz)/20.0;
+    }
+    
+    if (vol == 0.0) {
+        setErrorMessage("Mesh does not enclose a volume");
+        return 0;
+    }
+    // inward oriented mesh
+    if (vol < 0.0) {
+        vol = -vol;
+        mx = -mx; my = -my; mz = -mz;
+        xx = -xx; yy = -yy; zz = -zz;
+        xy = -xy; xz = -xz; yz = -yz;
+    }
+    
+    const double cx = mx/vol, cy = my/vol, cz = mz/vol;
+    xx -= vol*cx*cx; yy -= vol*cy*cy; zz -= vol*cz*cz;
+    xy -= vol*cx*cy; xz -= vol*cx*cz; yz -= vol*cy*cz;
+    
+    props.volume = vol;
+    props.area = area;
+    props.centre.x = this->origin.x + cx;
+    props.centre.y = this->origin.y + cy;
+    props.centre.z = this->origin.z + cz;
+    props.inertia[0] = yy + zz;
+    props.inertia[1] = xx + zz;
+    props.inertia[2] = xx + yy;
+    props.inertia[3] = -xy;
+    props.inertia[4] = -xz;
+    props.inertia[5] = -yz;
+    
+    // serial, reduction(max) needs OpenMP 3.1
+    double radius = 0.0;
+    for (unsigned int i = 0; i < nvertices; i++) {
+        const double dx = vert[i].x - cx, dy = vert[i].y - cy, dz = vert[i].z - cz;
+        radius = std::max(radius, dx*dx + dy*dy + dz*dz);
+    }
+    radius = sqrt(radius) + this->deflection;
+    
+    props.volumeError = area*this->deflection;
+    props.areaError = 0.0;
+    if (this->angle > 0.0)
+        props.areaError = this->angle < M_PI/2. ? area*(1.0/cos(this->angle) - 1.0) : HUGE_VAL;
+    props.centreError = radius*props.volumeError/vol;
+    props.inertiaError = radius*radius*props.volumeError;
+    return 1;
+}
+
+// Counter based random stream. Sample i of a given seed always draws
+// the same numbers, independent of the number of threads.
+static inline uint64_t splitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline double uniform01(uint64_t& state)
+{
+    return (splitMix64(state) >> 11)*(1.0/9007199254740992.0);
+}
+
+int OCCMesh::samplePoints(int n, unsigned int seed, int threads, double *points,
+                          double *normals, int *faces)
+{
+    const unsigned int nvertices = this->vertices.size();
+    const int ntriangles = (int)this->triangles.size();
+    if (n < 0) {
+        setErrorMessage("Expected positive number of samples");
+        return 0;
+    }
+    for (int i = 0; i < ntriangles; i++) {
+        const OCCStruct3I& tri = this->triangles[i];
+        if (tri.i >= nvertices || tri.j >= nvertices || tri.k >= nvertices) {
+            setErrorMessage("Triangle index out of range");
+            return 0;
+        }
+    }
+    
+    threads = meshThreads(threads);
+    
+    // cumulative triangle area, zero area triangles are never selected
+    std::vector<double> cdf(ntriangles);
+    #pragma omp parallel for num_threads(threads)
+    for (int t = 0; t < ntriangles; t++) {
+        const OCCStruct3I& tri = this->triangles[t];
+        const OCCStruct3f& a = this->vertices[tri.i];
+        const OCCStruct3f& b = this->vertices[tri.j];
+        const OCCStruct3f& c = this->vertices[tri.k];
+        const double ex = (double)b.x - a.x, ey = (double)b.y - a.y, ez = (double)b.z - a.z;
+        const double fx = (double)c.x - a.x, fy = (double)c.y - a.y, fz = (double)c.z - a.z;
+        const double nx = ey*fz - ez*fy, ny = ez*fx - ex*fz, nz = ex*fy - ey*fx;
+        cdf[t] = .5*sqrt(nx*nx + ny*ny + nz*nz);
+    }
+    for (int t = 1; t < ntriangles; t++)
+        cdf[t] += cdf[t - 1];
+    
+    const double total = ntriangles > 0 ? cdf[ntriangles - 1] : 0.0;
+    if (total <= 0.0) {
+        setErrorMessage("Mesh has no area");
+        return 0;
+    }
+    
+    // face index of each triangle from the face ranges
+    std::vector<int> triface(ntriangles, -1);
+    for (unsigned int i = 0; i + 4 < this->faceranges.size(); i += 5) {
+        const int *range = &this->faceranges[i];
+        for (int j = range[0]; j < range[0] + range[1] && j < ntriangles; j++)
+            triface[j] = range[4];
+    }
+    
+    const bool precise = this->precisevertices.size() == nvertices;
+    const bool smooth = this->normals.size() == nvertices;
+    
+    #pragma omp parallel for num_threads(threads) schedule(static)
+    for (int i = 0; i < n; i++) {
+        uint64_t state = ((uint64_t)seed << 32) ^ (uint64_t)i;
+        const double r = uniform01(state)*total;
+        const double s = sqrt(uniform01(state));
+        const double w = uniform01(state);
+        
+        int t = (int)(std::upper_bound(cdf.begin(), cdf.end(), r) - cdf.begin());
+        t = std::min(t, ntriangles - 1);
+        
+        // uniform barycentric coordinates over the triangle
+        const double b0 = 1.0 - s, b1 = s*(1.0 - w), b2 = s*w;
+        const OCCStruct3I& tri = this->triangles[t];
+        if (precise) {
+            const OCCStruct3d& a = this->precisevertices[tri.i];
+            const OCCStruct3d& b = this->precisevertices[tri.j];
+            const OCCStruct3d& c = this->precisevertices[tri.k];
+            points[3*i] = b0*a.x + b1*b.x + b2*c.x;
+            points[3*i + 1] = b0*a.y + b1*b.y + b2*c.y;
+            points[3*i + 2] = b0*a.z + b1*b.z + b2*c.z;
+        } else {
+            const OCCStruct3f& a = this->vertices[tri.i];
+            const OCCStruct3f& b = this->vertices[tri.j];
+            const OCCStruct3f& c = this->vertices[tri.k];
+            points[3*i] = this->origin.x + b0*a.x + b1*b.x + b2*c.x;
+            points[3*i + 1] = this->origin.y + b0*a.y + b1*b.y + b2*c.y;
+            points[3*i + 2] = this->origin.z + b0*a.z + b1*b.z + b2*c.z;
+        }
+        
+        // interpolated vertex normal, triangle normal as fallback
+        double nx = 0.0, ny = 0.0, nz = 0.0;
+        if (smooth) {
+            const OCCStruct3f& na = this->normals[tri.i];
+            const OCCStruct3f& nb = this->normals[tri.j];
+            const OCCStruct3f& nc = this->normals[tri.k];
+            nx = b0*na.x + b1*nb.x + b2*nc.x;
+            ny = b0*na.y + b1*nb.y + b2*nc.y;
+            nz = b0*na.z + b1*nb.z + b2*nc.z;
+        }
+        double len = sqrt(nx*nx + ny*ny + nz*nz);
+        if (len == 0.0) {
+            const OCCStruct3f& a = this->vertices[tri.i];
+            const OCCStruct3f& b = this->vertices[tri.j];
+            const OCCStruct3f& c = this->vertices[tri.k];
+            const double ex = (double)b.x - a.x, ey = (double)b.y - a.y, ez = (double)b.z - a.z;
+            const double fx = (double)c.x - a.x, fy = (double)c.y - a.y, fz = (double)c.z - a.z;
+            nx = ey*fz - ez*fy; ny = ez*fx - ex*fz; nz = ex*fy - ey*fx;
+            len = sqrt(nx*nx + ny*ny + nz*nz);
+        }
+        const double inv = len > 0.0 ? 1.0/len : 0.0;
+        normals[3*i] = nx*inv;
+        normals[3*i + 1] = ny*inv;
+        normals[3*i + 2] = nz*inv;
+        
+        if (faces != NULL)
+            faces[i] = triface[t];
+    }
+    return 1;
+}
+
+// Remove triangulation of face and the edge polygons referring to it.
+static void releaseTriangulation(const TopoDS_Face& face)
+{
+    TopLoc_Location loc;
+    Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, loc);
+    if (triangulation.IsNull())
+        return;
+    
+    BRep_Builder B;
+    Handle(Poly_PolygonOnTriangulation) nullpoly;
+    TopExp_Explorer ex;
+    for (ex.Init(face, TopAbs_EDGE); ex.More(); ex.Next()) {
+        const TopoDS_Edge& edge = TopoDS::Edge(ex.Current());
+        B.UpdateEdge(edge, nullpoly, triangulation, loc);
+    }
+    
+    Handle(Poly_Triangulation) nulltri;
+    B.UpdateFace(face, nulltri);
+}
+
+int OCCMesh::streamFaceMeshes(BRepMesh_FastDiscret& MSH, const std::vector<TopoDS_Face>& faces,
+                              const std::vector<int>& faceIds, OCCMeshSink *sink,
+                              OCCMeshParams& params, unsigned int chunkSize)
+{
+    const int nfaces = faces.size();
+    const int threads = meshThreads(params.threads);
+    // faces triangulated together, bounds the triangulations held
+    // when they are released after extraction
+    const int batch = threads == 1 ? 1 : 4*threads;
+    int first = 0;
+    double start;
+    
+    try {
+        params.facesMeshed = nfaces;
+        // edges are shared between faces and must be discretized first
+        start = meshTimer();
+        for (int i = 0; i < nfaces; i++)
+            MSH.Add(faces[i]);
+        params.timeDiscretize += meshTimer() - start;
+        
+        for (int b = 0; b < nfaces; b += batch) {
+            const int e = std::min(nfaces, b + batch);
+            start = meshTimer();
+            std::vector<TopoDS_Face> part(faces.begin() + b, faces.begin() + e);
+            if (processFaces(MSH, part, threads) > 0)
+                StdFail_NotDone::Raise("Failed to triangulate face");
+            params.timeDiscretize += meshTimer() - start;
+            
+            for (int i = b; i < e; i++) {
+                start = meshTimer();
+                this->extractFaceMesh(faces[i], faceIds[i], params.qualityNormals,
+                                      &params.timeNormals);
+                if (params.releaseTriangulation)
+                    releaseTriangulation(faces[i]);
+                params.timeExtract += meshTimer() - start;
+                
+                if (this->triangles.size() < chunkSize && i < nfaces - 1)
+                    continue;
+                
+                if (this->triangles.size() > 0 && !sink->emit(first, i - first + 1, this)) {
+                    setErrorMessage("Mesh stream stopped by sink");
+                    return 0;
+                }
+                
+                // keep buffers and seen edges for the next chunk
+                this->vertices.clear();
+                this->normals.clear();
+                this->interleaved.clear();
+                this->precisevertices.clear();
+                this->triangles.clear();
+                this->edgeindices.clear();
+                this->edgeranges.clear();
+                this->faceranges.clear();
+                this->edgekeys.clear();
+                first = i + 1;
+            }
+        }
+        params.timeEdges = this->edgeTime;
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to stream mesh");
+        }
+        return 0;
+    }
+    return 1;
+}
+
+// Check that the triangles of the face range of mesh only refer to
+// the vertices of the range, so the range can be copied on its own.
+static bool localRange(const OCCMesh *mesh, const int *range)
+{
+    const int vfirst = range[2], vcount = range[3];
+    if (range[0] + range[1] > (int)mesh->triangles.size() ||
+        vfirst + vcount > (int)mesh->vertices.size() ||
+        mesh->normals.size() != mesh->vertices.size())
+        return false;
+    
+    for (int i = range[0]; i < range[0] + range[1]; i++) {
+        const OCCStruct3I& tri = mesh->triangles[i];
+        if ((int)tri.i < vfirst || (int)tri.i >= vfirst + vcount ||
+            (int)tri.j < vfirst || (int)tri.j >= vfirst + vcount ||
+            (int)tri.k < vfirst || (int)tri.k >= vfirst + vcount)
+            return false;
+    }
+    return true;
+}
+
+// Check that the face range of mesh still holds the nodes of the
+// face triangulation in extraction order.
+static bool matchTriangulation(const OCCMesh *mesh, const int *range,
+                               const Handle(Poly_Triangulation)& triangulation,
+                               const TopLoc_Location& loc)
+{
+    const int vfirst = range[2], vcount = range[3];
+    if (vcount != triangulation->NbNodes())
+        return false;
+    
+    gp_Trsf tr = loc;
+    const TColgp_Array1OfPnt& narr = triangulation->Nodes();
+    for (int i = 0; i < vcount; i++) {
+        Standard_Real x, y, z;
+        narr(i + 1).Coord(x, y, z);
+        tr.Transforms(x, y, z);
+        x -= mesh->origin.x;
+        y -= mesh->origin.y;
+        z -= mesh->origin.z;
+        
+        const OCCStruct3f& v = mesh->vertices[vfirst + i];
+        if (v.x != (float)x || v.y != (float)y || v.z != (float)z)
+            return false;
+    }
+    return true;
+}
+
+// Append absolute positions of the face range of previous to mesh,
+// from the previous mesh when it has them.
+static void copyPrecise(const OCCMesh *previous, const int *range,
+                        const Handle(Poly_Triangulation)& triangulation,
+                        const TopLoc_Location& loc, OCCMesh *mesh)
+{
+    if (previous->precisevertices.size() == previous->vertices.size()) {
+        mesh->precisevertices.insert(mesh->precisevertices.end(),
+                                     previous->precisevertices.begin() + range[2],
+                                     previous->precisevertices.begin() + range[2] + range[3]);
+    } else if (!triangulation.IsNull()) {
+        mesh->appendPrecise(triangulation, loc);
+    } else {
+        for (int i = range[2]; i < range[2] + range[3]; i++) {
+            const OCCStruct3f& v = previous->vertices[i];
+            OCCStruct3d pnt;
+            pnt.x = previous->origin.x + v.x;
+            pnt.y = previous->origin.y + v.y;
+            pnt.z = previous->origin.z + v.z;
+            mesh->precisevertices.push_back(pnt);
+        }
+    }
+}
+
+// Copy the edge polylines of a face without triangulation from the
+// previous mesh. Polylines emitted by a neighbour face refer to its
+// vertices and are left to the neighbour, which emits them when it
+// is copied or meshed again.
+static void copyFaceEdges(const OCCMesh *previous, const int *range,
+                          const NCollection_DataMap<OCCEdgeKey, int>& edges,
+                          const TopoDS_Face& face, int vsize, OCCMesh *mesh)
+{
+    const int vfirst = range[2], vcount = range[3];
+    TopExp_Explorer ex;
+    for (ex.Init(face, TopAbs_EDGE); ex.More(); ex.Next()) {
+        const TopoDS_Edge& edge = TopoDS::Edge(ex.Current());
+        if (BRep_Tool::Degenerated(edge) || BRep_Tool::IsClosed(edge, face))
+            continue;
+        
+        const OCCEdgeKey key(edge);
+        if (mesh->edgeseen.Contains(key) || !edges.IsBound(key))
+            continue;
+        
+        const int index = edges.Find(key);
+        const int start = previous->edgeranges[2*index];
+        const int count = previous->edgeranges[2*index + 1];
+        bool local = true;
+        for (int k = start; k < start + count && local; k++) {
+            const int idx = previous->edgeindices[k];
+            local = idx >= vfirst && idx < vfirst + vcount;
+        }
+        if (!local)
+            continue;
+        
+        mesh->edgeseen.Add(key);
+        mesh->edgekeys.push_back(key);
+        mesh->edgeranges.push_back(mesh->edgeindices.size());
+        for (int k = start; k < start + count; k++)
+            mesh->edgeindices.push_back(vsize + previous->edgeindices[k] - vfirst);
+        mesh->edgeranges.push_back(count);
+    }
+}
+
+OCCMesh *updateShapeMesh(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces,
+                         const std::vector<int>& history, OCCMesh *previous,
+                         OCCMeshParams& params)
+{
+    OCCMesh *mesh = NULL;
+    params.resetTimings();
+    
+    try {
+        const int nfaces = faces.size();
+        std::vector<int> faceIds;
+        faceIndices(shape, faces, faceIds);
+        
+        // face ranges of previous mesh by face index
+        std::map<int, int> ranges;
+        for (unsigned int i = 0; i + 4 < previous->faceranges.size(); i += 5)
+            ranges[previous->faceranges[i + 4]] = i;
+        
+        // float vertices can only be copied relative to the same origin
+        const bool sameOrigin = params.originRelative || (previous->origin.x == 0. &&
+                                previous->origin.y == 0. && previous->origin.z == 0.);
+        
+        // Faces left untouched by the operation are copied from the
+        // face range of the previous mesh. When the face still holds
+        // its triangulation it must match the range, faces with a
+        // different triangulation are extracted from it. The mesh of
+        // faces with a released triangulation is copied as is, except
+        // when welding which needs the triangulation. Other faces are
+        // triangulated again.
+        std::vector<int> source(nfaces, -1);
+        std::vector<TopoDS_Face> remesh;
+        for (int i = 0; i < nfaces; i++) {
+            const int id = faceIds[i];
+            const int old = id >= 0 && id < (int)history.size() ? history[id] : -1;
+            std::map<int, int>::iterator itr = ranges.find(old);
+            
+            TopLoc_Location loc;
+            Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(faces[i], loc);
+            if (old >= 0 && itr != ranges.end() && sameOrigin &&
+                localRange(previous, &previous->faceranges[itr->second])) {
+                const int *range = &previous->faceranges[itr->second];
+                if (triangulation.IsNull() ? !params.weld :
+                    matchTriangulation(previous, range, triangulation, loc)) {
+                    source[i] = itr->second;
+                    continue;
+                }
+            }
+            
+            if (old < 0 || triangulation.IsNull()) {
+                releaseTriangulation(faces[i]);
+                remesh.push_back(faces[i]);
+            }
+        }
+        params.facesMeshed = remesh.size();
+        
+        // edge polylines of previous mesh by edge
+        NCollection_DataMap<OCCEdgeKey, int> edges;
+        for (unsigned int i = 0; i < previous->edgekeys.size(); i++)
+            edges.Bind(previous->edgekeys[i], i);
+        
+        double start = meshTimer();
+        Bnd_Box aBox;
+        BRepBndLib::Add(shape, aBox);
+        const double defle = params.absoluteDeflection(aBox);
+        params.timeBBox = meshTimer() - start;
+        
+        start = meshTimer();
+        if (!remesh.empty()) {
+            BRepMesh_FastDiscret MSH(defle, params.angle, aBox, Standard_True, Standard_True, 
+                                     params.relativeToEdge, Standard_True);
+            if (triangulateFaces(MSH, remesh, params.threads) > 0)
+                StdFail_NotDone::Raise("Failed to triangulate face");
+        }
+        params.timeDiscretize = meshTimer() - start;
+        
+        start = meshTimer();
+        mesh = new OCCMesh();
+        mesh->configure(params, aBox);
+        // keep the origin so unchanged faces can be copied
+        if (params.originRelative)
+            mesh->origin = previous->origin;
+        mesh->deflection = std::max(mesh->deflection, previous->deflection);
+        mesh->angle = std::max(mesh->angle, previous->angle);
+        mesh->reserveFaces(faces);
+        for (int i = 0; i < nfaces; i++) {
+            if (source[i] < 0) {
+                mesh->extractFaceMesh(faces[i], faceIds[i], params.qualityNormals,
+                                      &params.timeNormals);
+                continue;
+            }
+            
+            const int *range = &previous->faceranges[source[i]];
+            const int tsize = mesh->triangles.size();
+            const int vsize = mesh->vertices.size();
+            const int offset = vsize - range[2];
+            
+            mesh->vertices.insert(mesh->vertices.end(),
+                                  previous->vertices.begin() + range[2],
+                                  previous->vertices.begin() + range[2] + range[3]);
+            mesh->normals.insert(mesh->normals.end(),
+                                 previous->normals.begin() + range[2],
+                                 previous->normals.begin() + range[2] + range[3]);
+            if (mesh->interleave)
+                mesh->appendInterleaved(vsize, range[3]);
+            
+            TopLoc_Location loc;
+            Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(faces[i], loc);
+            if (mesh->precise)
+                copyPrecise(previous, range, triangulation, loc, mesh);
+            
+            for (int j = range[0]; j < range[0] + range[1]; j++) {
+                OCCStruct3I tri = previous->triangles[j];
+                tri.i += offset;
+                tri.j += offset;
+                tri.k += offset;
+                mesh->triangles.push_back(tri);
+            }
+            
+            if (triangulation.IsNull())
+                copyFaceEdges(previous, range, edges, faces[i], vsize, mesh);
+            else
+                mesh->extractFaceEdges(faces[i], triangulation, loc, vsize);
+            
+            mesh->faceranges.push_back(tsize);
+            mesh->faceranges.push_back(range[1]);
+            mesh->faceranges.push_back(vsize);
+            mesh->faceranges.push_back(range[3]);
+            mesh->faceranges.push_back(faceIds[i]);
+        }
+        mesh->scratch.release();
+        
+        if (params.weld && !mesh->weld(faces, params.creaseAngle)) {
+            delete mesh;
+            return NULL;
+        }
+        
+        if (params.releaseTriangulation)
+            BRepTools::Clean(shape);
+        params.timeExtract = meshTimer() - start;
+        params.timeEdges = mesh->edgeTime;
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to update mesh");
+        }
+        if (mesh != NULL)
+            delete mesh;
+        return NULL;
+    }
+    return mesh;
+}
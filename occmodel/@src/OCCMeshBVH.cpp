@@ -0,0 +1,525 @@
+// Copyright 2012 by Runar Tenfjord, Tenko as.
+// See LICENSE.txt for details on conditions.
+#include "OCCModel.h"
+
+static const int SAH_BINS = 16;
+static const int MAX_LEAF = 16;
+
+// Axis aligned bounds used while building
+struct BVHBounds {
+    double lo[3], hi[3];
+    BVHBounds() { reset(); }
+    void reset() {
+        lo[0] = lo[1] = lo[2] = std::numeric_limits<double>::max();
+        hi[0] = hi[1] = hi[2] = -std::numeric_limits<double>::max();
+    }
+    void add(const double *p) {
+        for (int i = 0; i < 3; i++) {
+            lo[i] = std::min(lo[i], p[i]);
+            hi[i] = std::max(hi[i], p[i]);
+        }
+    }
+    void add(const BVHBounds& b) {
+        for (int i = 0; i < 3; i++) {
+            lo[i] = std::min(lo[i], b.lo[i]);
+            hi[i] = std::max(hi[i], b.hi[i]);
+        }
+    }
+    double area() const {
+        if (lo[0] > hi[0])
+            return 0.0;
+        const double dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+        return 2.0*(dx*dy + dy*dz + dz*dx);
+    }
+};
+
+struct BVHBin {
+    BVHBounds bounds;
+    int count;
+    BVHBin() : count(0) { ; }
+};
+
+// Partition predicate, triangles with centroid in bins [0, bin]
+struct BVHSplit {
+    const std::vector<double>& centroids;
+    int axis;
+    double lo, scale;
+    int bin;
+    BVHSplit(const std::vector<double>& centroids, int axis, double lo, double scale, int bin) :
+        centroids(centroids), axis(axis), lo(lo), scale(scale), bin(bin) { ; }
+    bool operator()(int tri) const {
+        const int b = (int)((centroids[3*tri + axis] - lo)*scale);
+        return std::min(b, SAH_BINS - 1) <= bin;
+    }
+};
+
+// Work arrays of the build, triangle bounds and centroids
+class BVHBuilder {
+    public:
+        OCCMeshBVH *bvh;
+        int leafSize;
+        std::vector<BVHBounds> bounds;
+        std::vector<double> centroids;
+        BVHBuilder(OCCMeshBVH *bvh, int leafSize) : bvh(bvh), leafSize(leafSize) { ; }
+        int build(int first, int count, int depth);
+        int makeNode(const BVHBounds& box, int first, int count);
+};
+
+int BVHBuilder::makeNode(const BVHBounds& box, int first, int count)
+{
+    OCCBVHNode node;
+    for (int i = 0; i < 3; i++) {
+        node.lo[i] = (float)box.lo[i];
+        node.hi[i] = (float)box.hi[i];
+    }
+    node.first = first;
+    node.count = count;
+    bvh->nodes.push_back(node);
+    return bvh->nodes.size() - 1;
+}
+
+// Build subtree of order[first, first + count) with binned SAH.
+// Nodes are stored depth first, the left child follows its parent
+// and first holds the index of the right child.
+int BVHBuilder::build(int first, int count, int depth)
+{
+    bvh->depth = std::max(bvh->depth, depth);
+    std::vector<int>& order = bvh->order;
+    BVHBounds box, cbox;
+    for (int i = first; i < first + count; i++) {
+        box.add(bounds[order[i]]);
+        cbox.add(&centroids[3*order[i]]);
+    }
+    
+    if (count <= leafSize)
+        return makeNode(box, first, count);
+    
+    // best split over all axes
+    int bestAxis = -1, bestBin = 0;
+    double bestCost = std::numeric_limits<double>::max();
+    for (int axis = 0; axis < 3; axis++) {
+        const double extent = cbox.hi[axis] - cbox.lo[axis];
+        if (extent <= 0.0)
+            continue;
+        
+        BVHBin bins[SAH_BINS];
+        const double scale = SAH_BINS/extent;
+        for (int i = first; i < first + count; i++) {
+            const int tri = order[i];
+            int b = (int)((centroids[3*tri + axis] - cbox.lo[axis])*scale);
+            b = std::min(b, SAH_BINS - 1);
+            bins[b].count++;
+            bins[b].bounds.add(bounds[tri]);
+        }
+        
+        double rightArea[SAH_BINS];
+        int rightCount[SAH_BINS];
+        BVHBounds acc;
+        int n = 0;
+        for (int b = SAH_BINS - 1; b > 0; b--) {
+            acc.add(bins[b].bounds);
+            n += bins[b].count;
+            rightArea[b] = acc.area();
+            rightCount[b] = n;
+        }
+        
+        acc.reset();
+        n = 0;
+        for (int b = 0; b < SAH_BINS - 1; b++) {
+            acc.add(bins[b].bounds);
+            n += bins[b].count;
+            if (n == 0 || rightCount[b + 1] == 0)
+                continue;
+            const double cost = acc.area()*n + rightArea[b + 1]*rightCount[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+    
+    int mid;
+    if (bestAxis < 0) {
+        // coincident centroids
+        if (count <= MAX_LEAF)
+            return makeNode(box, first, count);
+        mid = first + count/2;
+    } else {
+        // leaf when splitting does not pay off
+        if (bestCost >= box.area()*count && count <= MAX_LEAF)
+            return makeNode(box, first, count);
+        
+        const double lo = cbox.lo[bestAxis];
+        const double scale = SAH_BINS/(cbox.hi[bestAxis] - lo);
+        int *itr = std::partition(&order[first], &order[first] + count,
+                                  BVHSplit(centroids, bestAxis, lo, scale, bestBin));
+        mid = itr - &order[0];
+        if (mid == first || mid == first + count)
+            mid = first + count/2;
+    }
+    
+    const int index = makeNode(box, first, 0);
+    build(first, mid - first, depth + 1);
+    const int right = build(mid, first + count - mid, depth + 1);
+    bvh->nodes[index].first = right;
+    return index;
+}
+
+int OCCMeshBVH::build(const OCCMesh *mesh, int leafSize)
+{
+    const int ntriangles = mesh->triangles.size();
+    this->nodes.clear();
+    this->depth = 0;
+    this->vertices = mesh->vertices;
+    this->triangles = mesh->triangles;
+    this->origin = mesh->origin;
+    
+    // face index of each triangle from the face ranges
+    this->faces.assign(ntriangles, -1);
+    for (unsigned int i = 0; i + 4 < mesh->faceranges.size(); i += 5) {
+        const int *range = &mesh->faceranges[i];
+        for (int j = range[0]; j < range[0] + range[1] && j < ntriangles; j++)
+            this->faces[j] = range[4];
+    }
+    
+    this->order.resize(ntriangles);
+    if (ntriangles == 0)
+        return 1;
+    
+    BVHBuilder builder(this, std::max(1, std::min(leafSize, MAX_LEAF)));
+    builder.bounds.resize(ntriangles);
+    builder.centroids.resize(3*ntriangles);
+    for (int i = 0; i < ntriangles; i++) {
+        const OCCStruct3I& tri = this->triangles[i];
+        const unsigned int idx[3] = {tri.i, tri.j, tri.k};
+        for (int j = 0; j < 3; j++) {
+            const OCCStruct3f& v = this->vertices[idx[j]];
+            const double p[3] = {v.x, v.y, v.z};
+            builder.bounds[i].add(p);
+        }
+        for (int j = 0; j < 3; j++)
+            builder.centroids[3*i + j] = .5*(builder.bounds[i].lo[j] + builder.bounds[i].hi[j]);
+        this->order[i] = i;
+    }
+    
+    this->nodes.reserve(2*ntriangles);
+    builder.build(0, ntriangles, 0);
+    return 1;
+}
+
+size_t OCCMeshBVH::memoryUsage()
+{
+    return this->nodes.size()*sizeof(OCCBVHNode) +
+           this->order.size()*sizeof(int) +
+           this->faces.size()*sizeof(int) +
+           this->vertices.size()*sizeof(OCCStruct3f) +
+           this->triangles.size()*sizeof(OCCStruct3I);
+}
+
+// Entry distance of ray into node bounds, negative on miss
+static inline double rayBox(const OCCBVHNode& node, const double *org, const double *inv,
+                            double tmax)
+{
+    double t0 = 0.0, t1 = tmax;
+    for (int i = 0; i < 3; i++) {
+        double tn = (node.lo[i] - org[i])*inv[i];
+        double tf = (node.hi[i] - org[i])*inv[i];
+        if (tn > tf)
+            std::swap(tn, tf);
+        // NaN from 0*inf fails the compares and is ignored
+        if (tn > t0) t0 = tn;
+        if (tf < t1) t1 = tf;
+        if (t0 > t1)
+            return -1.0;
+    }
+    return t0;
+}
+
+// Moller-Trumbore intersection, returns distance or -1
+static inline double rayTriangle(const OCCStruct3f& a, const OCCStruct3f& b,
+                                 const OCCStruct3f& c, const double *org,
+                                 const double *dir)
+{
+    const double e1[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+    const double e2[3] = {c.x - a.x, c.y - a.y, c.z - a.z};
+    const double p[3] = {dir[1]*e2[2] - dir[2]*e2[1],
+                         dir[2]*e2[0] - dir[0]*e2[2],
+                         dir[0]*e2[1] - dir[1]*e2[0]};
+    const double det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+    if (fabs(det) < 1.0e-300)
+        return -1.0;
+    
+    const double inv = 1.0/det;
+    const double s[3] = {org[0] - a.x, org[1] - a.y, org[2] - a.z};
+    const double u = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2])*inv;
+    if (u < 0.0 || u > 1.0)
+        return -1.0;
+    
+    const double q[3] = {s[1]*e1[2] - s[2]*e1[1],
+                         s[2]*e1[0] - s[0]*e1[2],
+                         s[0]*e1[1] - s[1]*e1[0]};
+    const double v = (dir[0]*q[0] + dir[1]*q[1] + dir[2]*q[2])*inv;
+    if (v < 0.0 || u + v > 1.0)
+        return -1.0;
+    
+    return (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2])*inv;
+}
+
+// First hit of each ray within [0, tmax]. Directions are not required
+// to be normalized, distances are in units of the direction length.
+// Rays without hit get triangle and face -1 and distance tmax.
+int OCCMeshBVH::intersect(const double *origins, const double *directions, int nrays,
+                          double tmax, int threads, int *tris, int *faceIds,
+                          double *distances)
+{
+    threads = meshThreads(threads);
+    
+    #pragma omp parallel num_threads(threads)
+    {
+        // pending nodes never exceed the tree depth
+        std::vector<int> stack(depth + 2);
+        #pragma omp for schedule(dynamic, 64)
+        for (int r = 0; r < nrays; r++) {
+            const double org[3] = {origins[3*r] - origin.x,
+                                   origins[3*r + 1] - origin.y,
+                                   origins[3*r + 2] - origin.z};
+            const double *dir = &directions[3*r];
+            const double inv[3] = {1.0/dir[0], 1.0/dir[1], 1.0/dir[2]};
+            double best = tmax;
+            int hit = -1;
+            
+            int top = 0;
+            if (!nodes.empty() && rayBox(nodes[0], org, inv, best) >= 0.0)
+                stack[top++] = 0;
+            
+            while (top > 0) {
+                const int index = stack[--top];
+                const OCCBVHNode& node = nodes[index];
+                if (node.count > 0) {
+                    for (int i = node.first; i < node.first + node.count; i++) {
+                        const OCCStruct3I& tri = triangles[order[i]];
+                        const double t = rayTriangle(vertices[tri.i], vertices[tri.j],
+                                                     vertices[tri.k], org, dir);
+                        if (t >= 0.0 && t < best) {
+                            best = t;
+                            hit = order[i];
+                        }
+                    }
+                    continue;
+                }
+                
+                // visit nearest child first
+                int near = index + 1, far = node.first;
+                double tn = rayBox(nodes[near], org, inv, best);
+                double tf = rayBox(nodes[far], org, inv, best);
+                if (tf >= 0.0 && tn >= 0.0 && tf < tn) {
+                    std::swap(near, far);
+                    std::swap(tn, tf);
+                }
+                if (tf >= 0.0)
+                    stack[top++] = far;
+                if (tn >= 0.0)
+                    stack[top++] = near;
+            }
+            
+            tris[r] = hit;
+            faceIds[r] = hit >= 0 ? faces[hit] : -1;
+            distances[r] = best;
+        }
+    }
+    return 1;
+}
+
+// Closest point on triangle abc to p (Ericson, Real-Time Collision
+// Detection 5.1.5)
+static void closestOnTriangle(const double *p, const OCCStruct3f& ta, const OCCStruct3f& tb,
+                              const OCCStruct3f& tc, double *res)
+{
+    const double a[3] = {ta.x, ta.y, ta.z};
+    const double b[3] = {tb.x, tb.y, tb.z};
+    const double c[3] = {tc.x, tc.y, tc.z};
+    double ab[3], ac[3], ap[3], bp[3], cp[3];
+    for (int i = 0; i < 3; i++) {
+        ab[i] = b[i] - a[i];
+        ac[i] = c[i] - a[i];
+        ap[i] = p[i] - a[i];
+        bp[i] = p[i] - b[i];
+        cp[i] = p[i] - c[i];
+    }
+    
+    const double d1 = ab[0]*ap[0] + ab[1]*ap[1] + ab[2]*ap[2];
+    const double d2 = ac[0]*ap[0] + ac[1]*ap[1] + ac[2]*ap[2];
+    if (d1 <= 0.0 && d2 <= 0.0) {
+        memcpy(res, a, sizeof(a));
+        return;
+    }
+    
+    const double d3 = ab[0]*bp[0] + ab[1]*bp[1] + ab[2]*bp[2];
+    const double d4 = ac[0]*bp[0] + ac[1]*bp[1] + ac[2]*bp[2];
+    if (d3 >= 0.0 && d4 <= d3) {
+        memcpy(res, b, sizeof(b));
+        return;
+    }
+    
+    const double vc = d1*d4 - d3*d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+        const double v = d1/(d1 - d3);
+        for (int i = 0; i < 3; i++)
+            res[i] = a[i] + v*ab[i];
+        return;
+    }
+    
+    const double d5 = ab[0]*cp[0] + ab[1]*cp[1] + ab[2]*cp[2];
+    const double d6 = ac[0]*cp[0] + ac[1]*cp[1] + ac[2]*cp[2];
+    if (d6 >= 0.0 && d5 <= d6) {
+        memcpy(res, c, sizeof(c));
+        return;
+    }
+    
+    const double vb = d5*d2 - d1*d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+        const double w = d2/(d2 - d6);
+        for (int i = 0; i < 3; i++)
+            res[i] = a[i] + w*ac[i];
+        return;
+    }
+    
+    const double va = d3*d6 - d5*d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+        const double w = (d4 - d3)/((d4 - d3) + (d5 - d6));
+        for (int i = 0; i < 3; i++)
+            res[i] = b[i] + w*(c[i] - b[i]);
+        return;
+    }
+    
+    const double denom = 1.0/(va + vb + vc);
+    const double v = vb*denom, w = vc*denom;
+    for (int i = 0; i < 3; i++)
+        res[i] = a[i] + ab[i]*v + ac[i]*w;
+}
+
+// Squared distance from point to node bounds
+static inline double boxDistance(const OCCBVHNode& node, const double *p)
+{
+    double d2 = 0.0;
+    for (int i = 0; i < 3; i++) {
+        const double d = std::max(0.0, std::max(node.lo[i] - p[i], p[i] - node.hi[i]));
+        d2 += d*d;
+    }
+    return d2;
+}
+
+// Closest point on the mesh within maxDistance of each query point.
+// Points without result get triangle and face -1 and distance
+// maxDistance.
+int OCCMeshBVH::closestPoint(const double *points, int npoints, double maxDistance,
+                             int threads, int *tris, int *faceIds, double *closest,
+                             double *distances)
+{
+    threads = meshThreads(threads);
+    
+    #pragma omp parallel num_threads(threads)
+    {
+        std::vector<int> stack(depth + 2);
+        #pragma omp for schedule(dynamic, 64)
+        for (int q = 0; q < npoints; q++) {
+            const double p[3] = {points[3*q] - origin.x,
+                                 points[3*q + 1] - origin.y,
+                                 points[3*q + 2] - origin.z};
+            double best = maxDistance*maxDistance;
+            double res[3] = {p[0], p[1], p[2]};
+            int hit = -1;
+            
+            int top = 0;
+            if (!nodes.empty() && boxDistance(nodes[0], p) <= best)
+                stack[top++] = 0;
+            
+            while (top > 0) {
+                const int index = stack[--top];
+                const OCCBVHNode& node = nodes[index];
+                if (boxDistance(node, p) > best)
+                    continue;
+                
+                if (node.count > 0) {
+                    for (int i = node.first; i < node.first + node.count; i++) {
+                        const OCCStruct3I& tri = triangles[order[i]];
+                        double cp[3];
+                        closestOnTriangle(p, vertices[tri.i], vertices[tri.j], vertices[tri.k], cp);
+                        const double dx = cp[0] - p[0], dy = cp[1] - p[1], dz = cp[2] - p[2];
+                        const double d2 = dx*dx + dy*dy + dz*dz;
+                        if (d2 <= best) {
+                            best = d2;
+                            hit = order[i];
+                            memcpy(res, cp, sizeof(cp));
+                        }
+                    }
+                    continue;
+                }
+                
+                int near = index + 1, far = node.first;
+                double dn = boxDistance(nodes[near], p);
+                double df = boxDistance(nodes[far], p);
+                if (df < dn) {
+                    std::swap(near, far);
+                    std::swap(dn, df);
+                }
+                if (df <= best)
+                    stack[top++] = far;
+                if (dn <= best)
+                    stack[top++] = near;
+            }
+            
+            tris[q] = hit;
+            faceIds[q] = hit >= 0 ? faces[hit] : -1;
+            closest[3*q] = res[0] + origin.x;
+            closest[3*q + 1] = res[1] + origin.y;
+            closest[3*q + 2] = res[2] + origin.z;
+            distances[q] = hit >= 0 ? sqrt(best) : maxDistance;
+        }
+    }
+    return 1;
+}
+
+// Triangles with bounds overlapping the box [lo, hi]
+int OCCMeshBVH::overlap(const double *lo, const double *hi, std::vector<int>& tris)
+{
+    tris.clear();
+    if (nodes.empty())
+        return 1;
+    
+    const double qlo[3] = {lo[0] - origin.x, lo[1] - origin.y, lo[2] - origin.z};
+    const double qhi[3] = {hi[0] - origin.x, hi[1] - origin.y, hi[2] - origin.z};
+    
+    std::vector<int> stack(1, 0);
+    while (!stack.empty()) {
+        const int index = stack.back();
+        stack.pop_back();
+        const OCCBVHNode& node = nodes[index];
+        if (node.lo[0] > qhi[0] || node.hi[0] < qlo[0] ||
+            node.lo[1] > qhi[1] || node.hi[1] < qlo[1] ||
+            node.lo[2] > qhi[2] || node.hi[2] < qlo[2])
+            continue;
+        
+        if (node.count == 0) {
+            stack.push_back(node.first);
+            stack.push_back(index + 1);
+            continue;
+        }
+        
+        for (int i = node.first; i < node.first + node.count; i++) {
+            const OCCStruct3I& tri = triangles[order[i]];
+            const OCCStruct3f *v[3] = {&vertices[tri.i], &vertices[tri.j], &vertices[tri.k]};
+            if (std::min(v[0]->x, std::min(v[1]->x, v[2]->x)) > qhi[0] ||
+                std::max(v[0]->x, std::max(v[1]->x, v[2]->x)) < qlo[0] ||
+                std::min(v[0]->y, std::min(v[1]->y, v[2]->y)) > qhi[1] ||
+                std::max(v[0]->y, std::max(v[1]->y, v[2]->y)) < qlo[1] ||
+                std::min(v[0]->z, std::min(v[1]->z, v[2]->z)) > qhi[2] ||
+                std::max(v[0]->z, std::max(v[1]->z, v[2]->z)) < qlo[2])
+                continue;
+            tris.push_back(order[i]);
+        }
+    }
+    std::sort(tris.begin(), tris.end());
+    return 1;
+}
@@ -0,0 +1,286 @@
+// Copyright 2012 by Runar Tenfjord, Tenko as.
+// See LICENSE.txt for details on conditions.
+#include "OCCModel.h"
+
+static const double POSITION_RANGE = 65535.0;
+
+// Vertices are processed in chunks converted to SoA for the kernels.
+static const int ENCODE_CHUNK = 256;
+
+static void loadSoA(const OCCStruct3f *src, int n, double *x, double *y, double *z)
+{
+    for (int i = 0; i < n; i++) {
+        x[i] = src[i].x;
+        y[i] = src[i].y;
+        z[i] = src[i].z;
+    }
+}
+
+static void storeNormals(const unsigned int *qu, const unsigned int *qv, int n,
+                         int nsize, unsigned char *dst)
+{
+    if (nsize == 1) {
+        for (int i = 0; i < n; i++) {
+            dst[2*i] = (unsigned char)qu[i];
+            dst[2*i + 1] = (unsigned char)qv[i];
+        }
+    } else {
+        uint16_t *out = (uint16_t *)dst;
+        for (int i = 0; i < n; i++) {
+            out[2*i] = (uint16_t)qu[i];
+            out[2*i + 1] = (uint16_t)qv[i];
+        }
+    }
+}
+
+static void loadNormals(const unsigned char *src, int n, int nsize,
+                        unsigned int *qu, unsigned int *qv)
+{
+    if (nsize == 1) {
+        for (int i = 0; i < n; i++) {
+            qu[i] = src[2*i];
+            qv[i] = src[2*i + 1];
+        }
+    } else {
+        const uint16_t *in = (const uint16_t *)src;
+        for (int i = 0; i < n; i++) {
+            qu[i] = in[2*i];
+            qv[i] = in[2*i + 1];
+        }
+    }
+}
+
+static void encodeIndices(const unsigned int *src, size_t count, int indexSize,
+                          std::vector<unsigned char>& dst)
+{
+    dst.resize(count*indexSize);
+    if (count == 0)
+        return;
+    
+    if (indexSize == 2) {
+        uint16_t *out = (uint16_t *)&dst[0];
+        for (size_t i = 0; i < count; i++)
+            out[i] = (uint16_t)src[i];
+    } else {
+        memcpy(&dst[0], src, count*sizeof(uint32_t));
+    }
+}
+
+static void decodeIndices(const std::vector<unsigned char>& src, int indexSize,
+                          unsigned int *dst)
+{
+    const size_t count = src.size()/indexSize;
+    if (count == 0)
+        return;
+    
+    if (indexSize == 2) {
+        const uint16_t *in = (const uint16_t *)&src[0];
+        for (size_t i = 0; i < count; i++)
+            dst[i] = in[i];
+    } else {
+        memcpy(dst, &src[0], count*sizeof(uint32_t));
+    }
+}
+
+OCCMeshEncoding::OCCMeshEncoding()
+{
+    for (int i = 0; i < 3; i++) {
+        origin[i] = 0.0;
+        scale[i] = 0.0;
+    }
+    meshorigin.x = meshorigin.y = meshorigin.z = 0.0;
+    meshdeflection = meshangle = 0.0;
+    normalBits = 16;
+    indexSize = 4;
+    maxPositionError = meanPositionError = 0.0;
+    maxNormalError = meanNormalError = 0.0;
+}
+
+size_t OCCMeshEncoding::memoryUsage()
+{
+    return this->positions.size()*sizeof(uint16_t) +
+           this->normals.size() +
+           this->triangles.size() +
+           this->edgeindices.size() +
+           this->edgeranges.size()*sizeof(int) +
+           this->faceranges.size()*sizeof(int);
+}
+
+int OCCMeshEncoding::encode(const OCCMesh *mesh, int normalBits, int threads)
+{
+    const int nvertices = (int)mesh->vertices.size();
+    if (nvertices == 0 || mesh->normals.size() != mesh->vertices.size()) {
+        setErrorMessage("Mesh not valid for encoding");
+        return 0;
+    }
+    if (normalBits != 8 && normalBits != 16) {
+        setErrorMessage("Normal bits must be 8 or 16");
+        return 0;
+    }
+    
+    threads = meshThreads(threads);
+    this->normalBits = normalBits;
+    this->indexSize = nvertices <= 65536 ? 2 : 4;
+    
+    float lo[3], hi[3];
+    lo[0] = hi[0] = mesh->vertices[0].x;
+    lo[1] = hi[1] = mesh->vertices[0].y;
+    lo[2] = hi[2] = mesh->vertices[0].z;
+    for (int i = 1; i < nvertices; i++) {
+        const OCCStruct3f& v = mesh->vertices[i];
+        lo[0] = std::min(lo[0], v.x); hi[0] = std::max(hi[0], v.x);
+        lo[1] = std::min(lo[1], v.y); hi[1] = std::max(hi[1], v.y);
+        lo[2] = std::min(lo[2], v.z); hi[2] = std::max(hi[2], v.z);
+    }
+    
+    double inv[3];
+    for (int i = 0; i < 3; i++) {
+        origin[i] = lo[i];
+        scale[i] = ((double)hi[i] - lo[i])/POSITION_RANGE;
+        inv[i] = scale[i] > 0.0 ? 1.0/scale[i] : 0.0;
+    }
+    
+    const double range = normalBits == 8 ? 255.0 : 65535.0;
+    const int nsize = normalBits/8;
+    this->positions.resize(3*nvertices);
+    this->normals.resize(2*nsize*nvertices);
+    
+    uint16_t *pos = &this->positions[0];
+    unsigned char *nor = &this->normals[0];
+    const OCCStruct3f *verts = &mesh->vertices[0];
+    const OCCStruct3f *norms = &mesh->normals[0];
+    const int nchunks = (nvertices + ENCODE_CHUNK - 1)/ENCODE_CHUNK;
+    
+    #pragma omp parallel for num_threads(threads)
+    for (int c = 0; c < nchunks; c++) {
+        const int first = c*ENCODE_CHUNK;
+        const int n = std::min(ENCODE_CHUNK, nvertices - first);
+        double x[ENCODE_CHUNK], y[ENCODE_CHUNK], z[ENCODE_CHUNK];
+        unsigned int qx[ENCODE_CHUNK], qy[ENCODE_CHUNK], qz[ENCODE_CHUNK];
+        
+        loadSoA(verts + first, n, x, y, z);
+        meshQuantize(x, y, z, n, origin, inv, POSITION_RANGE, qx, qy, qz);
+        for (int i = 0; i < n; i++) {
+            pos[3*(first + i)] = (uint16_t)qx[i];
+            pos[3*(first + i) + 1] = (uint16_t)qy[i];
+            pos[3*(first + i) + 2] = (uint16_t)qz[i];
+        }
+        
+        loadSoA(norms + first, n, x, y, z);
+        meshOctEncode(x, y, z, n, range, qx, qy);
+        storeNormals(qx, qy, n, nsize, nor + 2*nsize*first);
+    }
+    
+    // Error of the decoded values in a separate pass. Each thread keeps
+    // its own maxima, reduction(max) needs OpenMP 3.1.
+    double maxPos = 0.0, sumPos = 0.0, maxNor = 0.0, sumNor = 0.0;
+    #pragma omp parallel num_threads(threads)
+    {
+        double tmaxPos = 0.0, tsumPos = 0.0, tmaxNor = 0.0, tsumNor = 0.0;
+        unsigned int qu[ENCODE_CHUNK], qv[ENCODE_CHUNK];
+        OCCStruct3f dn[ENCODE_CHUNK];
+        
+        #pragma omp for
+        for (int c = 0; c < nchunks; c++) {
+            const int first = c*ENCODE_CHUNK;
+            const int n = std::min(ENCODE_CHUNK, nvertices - first);
+            for (int i = 0; i < n; i++) {
+                const OCCStruct3f& v = verts[first + i];
+                const uint16_t *q = pos + 3*(first + i);
+                const double dx = origin[0] + q[0]*scale[0] - v.x;
+                const double dy = origin[1] + q[1]*scale[1] - v.y;
+                const double dz = origin[2] + q[2]*scale[2] - v.z;
+                const double err = sqrt(dx*dx + dy*dy + dz*dz);
+                tsumPos += err;
+                tmaxPos = std::max(tmaxPos, err);
+            }
+            
+            loadNormals(nor + 2*nsize*first, n, nsize, qu, qv);
+            meshOctDecode(qu, qv, n, range, dn);
+            for (int i = 0; i < n; i++) {
+                const OCCStruct3f& nv = norms[first + i];
+                const double cx = nv.y*dn[i].z - nv.z*dn[i].y;
+                const double cy = nv.z*dn[i].x - nv.x*dn[i].z;
+                const double cz = nv.x*dn[i].y - nv.y*dn[i].x;
+                const double dot = nv.x*dn[i].x + nv.y*dn[i].y + nv.z*dn[i].z;
+                const double angle = atan2(sqrt(cx*cx + cy*cy + cz*cz), dot);
+                tsumNor += angle;
+                tmaxNor = std::max(tmaxNor, angle);
+            }
+        }
+        
+        #pragma omp critical
+        {
+            sumPos += tsumPos;
+            maxPos = std::max(maxPos, tmaxPos);
+            sumNor += tsumNor;
+            maxNor = std::max(maxNor, tmaxNor);
+        }
+    }
+    
+    maxPositionError = maxPos;
+    meanPositionError = sumPos/nvertices;
+    maxNormalError = maxNor;
+    meanNormalError = sumNor/nvertices;
+    
+    const unsigned int *tri = mesh->triangles.empty() ? NULL : &mesh->triangles[0].i;
+    encodeIndices(tri, 3*mesh->triangles.size(), indexSize, this->triangles);
+    const unsigned int *edge = mesh->edgeindices.empty() ? NULL : &mesh->edgeindices[0];
+    encodeIndices(edge, mesh->edgeindices.size(), indexSize, this->edgeindices);
+    
+    this->edgeranges = mesh->edgeranges;
+    this->faceranges = mesh->faceranges;
+    this->meshorigin = mesh->origin;
+    this->meshdeflection = mesh->deflection;
+    this->meshangle = mesh->angle;
+    return 1;
+}
+
+OCCMesh *OCCMeshEncoding::decode(int threads)
+{
+    const int nvertices = (int)this->numVertices();
+    const double range = normalBits == 8 ? 255.0 : 65535.0;
+    const int nsize = normalBits/8;
+    threads = meshThreads(threads);
+    
+    OCCMesh *mesh = new OCCMesh();
+    mesh->vertices.resize(nvertices);
+    mesh->normals.resize(nvertices);
+    
+    const uint16_t *pos = nvertices > 0 ? &this->positions[0] : NULL;
+    const unsigned char *nor = nvertices > 0 ? &this->normals[0] : NULL;
+    const int nchunks = (nvertices + ENCODE_CHUNK - 1)/ENCODE_CHUNK;
+    
+    #pragma omp parallel for num_threads(threads)
+    for (int c = 0; c < nchunks; c++) {
+        const int first = c*ENCODE_CHUNK;
+        const int n = std::min(ENCODE_CHUNK, nvertices - first);
+        unsigned int qx[ENCODE_CHUNK], qy[ENCODE_CHUNK], qz[ENCODE_CHUNK];
+        
+        for (int i = 0; i < n; i++) {
+            qx[i] = pos[3*(first + i)];
+            qy[i] = pos[3*(first + i) + 1];
+            qz[i] = pos[3*(first + i) + 2];
+        }
+        meshDequantize(qx, qy, qz, n, origin, scale, &mesh->vertices[first]);
+        
+        loadNormals(nor + 2*nsize*first, n, nsize, qx, qy);
+        meshOctDecode(qx, qy, n, range, &mesh->normals[first]);
+    }
+    
+    mesh->triangles.resize(this->triangles.size()/(3*indexSize));
+    if (!mesh->triangles.empty())
+        decodeIndices(this->triangles, indexSize, &mesh->triangles[0].i);
+    mesh->edgeindices.resize(this->edgeindices.size()/indexSize);
+    if (!mesh->edgeindices.empty())
+        decodeIndices(this->edgeindices, indexSize, &mesh->edgeindices[0]);
+    
+    mesh->edgeranges = this->edgeranges;
+    mesh->faceranges = this->faceranges;
+    mesh->origin = this->meshorigin;
+    // quantization moves vertices up to maxPositionError
+    if (this->meshdeflection > 0.0)
+        mesh->deflection = this->meshdeflection + maxPositionError;
+    mesh->angle = this->meshangle;
+    return mesh;
+}
@@ -0,0 +1,757 @@
+// Copyright 2012 by Runar Tenfjord, Tenko as.
+// See LICENSE.txt for details on conditions.
+//
+// Batched kernels for node transform, face normals and normalization
+// used by OCCMesh::extractFaceMesh, and for quantization and octahedral
+// normals used by OCCMeshEncoding. Input is in SoA layout. Each kernel
+// has a scalar version and SSE2/AVX2 versions selected at runtime. The
+// vector versions use the same IEEE operations in the same order as
+// the scalar version, results only differ in the last bits if the
+// compiler contracts the scalar code into fused multiply-add.
+#include "OCCModel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OCC_MESH_X86
+#include <immintrin.h>
+#define OCC_TARGET_SSE2 __attribute__((target("sse2")))
+#define OCC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+static const double DEGENERATED = 1.0e-10;
+
+// scalar kernels
+
+static void transformScalar(const double *x, const double *y, const double *z,
+                            int n, const double *m, OCCStruct3f *out)
+{
+    for (int i = 0; i < n; i++) {
+        out[i].x = (float)(m[0]*x[i] + m[1]*y[i] + m[2]*z[i] + m[3]);
+        out[i].y = (float)(m[4]*x[i] + m[5]*y[i] + m[6]*z[i] + m[7]);
+        out[i].z = (float)(m[8]*x[i] + m[9]*y[i] + m[10]*z[i] + m[11]);
+    }
+}
+
+static void faceNormalsScalar(const double *x, const double *y, const double *z,
+                              const int *tris, int ntris, double *nx, double *ny,
+                              double *nz, unsigned char *valid)
+{
+    for (int t = 0; t < ntris; t++) {
+        const int i1 = tris[3*t], i2 = tris[3*t + 1], i3 = tris[3*t + 2];
+        const double v1x = x[i3] - x[i1], v1y = y[i3] - y[i1], v1z = z[i3] - z[i1];
+        const double v2x = x[i2] - x[i1], v2y = y[i2] - y[i1], v2z = z[i2] - z[i1];
+        nx[t] = v1y*v2z - v1z*v2y;
+        ny[t] = v1z*v2x - v1x*v2z;
+        nz[t] = v1x*v2y - v1y*v2x;
+        
+        valid[t] = i1 != i2 && i2 != i3 && i3 != i1 &&
+                   v1x*v1x + v1y*v1y + v1z*v1z >= DEGENERATED &&
+                   v2x*v2x + v2y*v2y + v2z*v2z >= DEGENERATED &&
+                   nx[t]*nx[t] + ny[t]*ny[t] + nz[t]*nz[t] >= DEGENERATED;
+    }
+}
+
+static void normalizeScalar(const double *x, const double *y, const double *z,
+                            int n, OCCStruct3f *out)
+{
+    for (int i = 0; i < n; i++) {
+        double vx = x[i], vy = y[i], vz = z[i];
+        const double d2 = vx*vx + vy*vy + vz*vz;
+        if (d2 > DEGENERATED) {
+            const double d = sqrt(d2);
+            vx /= d; vy /= d; vz /= d;
+        }
+        out[i].x = (float)vx;
+        out[i].y = (float)vy;
+        out[i].z = (float)vz;
+    }
+}
+
+// Clamp to [0, range] before truncation, equal to floor(t + 0.5)
+// clamped to the same range. NaN gives 0 like the vector max.
+static inline unsigned int quantizeValue(double t, double range)
+{
+    t = t + 0.5;
+    t = t > 0.0 ? t : 0.0;
+    t = t < range ? t : range;
+    return (unsigned int)t;
+}
+
+static void quantizeScalar(const double *x, const double *y, const double *z,
+                           int n, const double *origin, const double *inv,
+                           double range, unsigned int *qx, unsigned int *qy,
+                           unsigned int *qz)
+{
+    for (int i = 0; i < n; i++) {
+        qx[i] = quantizeValue((x[i] - origin[0])*inv[0], range);
+        qy[i] = quantizeValue((y[i] - origin[1])*inv[1], range);
+        qz[i] = quantizeValue((z[i] - origin[2])*inv[2], range);
+    }
+}
+
+static void dequantizeScalar(const unsigned int *qx, const unsigned int *qy,
+                             const unsigned int *qz, int n, const double *origin,
+                             const double *scale, OCCStruct3f *out)
+{
+    for (int i = 0; i < n; i++) {
+        out[i].x = (float)(origin[0] + qx[i]*scale[0]);
+        out[i].y = (float)(origin[1] + qy[i]*scale[1]);
+        out[i].z = (float)(origin[2] + qz[i]*scale[2]);
+    }
+}
+
+static inline double signNotZero(double v)
+{
+    return v >= 0.0 ? 1.0 : -1.0;
+}
+
+// Octahedral normal encoding. The unit sphere is projected on the
+// octahedron |x| + |y| + |z| = 1 and the lower half folded over the
+// upper half, giving two components in [0, range].
+static void octEncodeScalar(const double *x, const double *y, const double *z,
+                            int n, double range, unsigned int *qu, unsigned int *qv)
+{
+    for (int i = 0; i < n; i++) {
+        const double l1 = fabs(x[i]) + fabs(y[i]) + fabs(z[i]);
+        const double inv = l1 > 0.0 ? 1.0/l1 : 0.0;
+        double u = x[i]*inv, v = y[i]*inv;
+        if (z[i] < 0.0) {
+            const double tu = u;
+            u = (1.0 - fabs(v))*signNotZero(tu);
+            v = (1.0 - fabs(tu))*signNotZero(v);
+        }
+        qu[i] = quantizeValue((u*0.5 + 0.5)*range, range);
+        qv[i] = quantizeValue((v*0.5 + 0.5)*range, range);
+    }
+}
+
+static void octDecodeScalar(const unsigned int *qu, const unsigned int *qv, int n,
+                            double range, OCCStruct3f *out)
+{
+    for (int i = 0; i < n; i++) {
+        double u = qu[i]/range*2.0 - 1.0, v = qv[i]/range*2.0 - 1.0;
+        const double w = 1.0 - fabs(u) - fabs(v);
+        if (w < 0.0) {
+            const double tu = u;
+            u = (1.0 - fabs(v))*signNotZero(tu);
+            v = (1.0 - fabs(tu))*signNotZero(v);
+        }
+        const double len = sqrt(u*u + v*v + w*w);
+        out[i].x = (float)(u/len);
+        out[i].y = (float)(v/len);
+        out[i].z = (float)(w/len);
+    }
+}
+
+#ifdef OCC_MESH_X86
+
+// SSE2 kernels, two doubles per lane
+
+OCC_TARGET_SSE2
+static void transformSSE2(const double *x, const double *y, const double *z,
+                          int n, const double *m, OCCStruct3f *out)
+{
+    const int nv = n & ~1;
+    float res[3][4];
+    for (int i = 0; i < nv; i += 2) {
+        const __m128d px = _mm_loadu_pd(x + i);
+        const __m128d py = _mm_loadu_pd(y + i);
+        const __m128d pz = _mm_loadu_pd(z + i);
+        for (int r = 0; r < 3; r++) {
+            __m128d v = _mm_mul_pd(_mm_set1_pd(m[4*r]), px);
+            v = _mm_add_pd(v, _mm_mul_pd(_mm_set1_pd(m[4*r + 1]), py));
+            v = _mm_add_pd(v, _mm_mul_pd(_mm_set1_pd(m[4*r + 2]), pz));
+            v = _mm_add_pd(v, _mm_set1_pd(m[4*r + 3]));
+            _mm_storeu_ps(res[r], _mm_cvtpd_ps(v));
+        }
+        for (int j = 0; j < 2; j++) {
+            out[i + j].x = res[0][j];
+            out[i + j].y = res[1][j];
+            out[i + j].z = res[2][j];
+        }
+    }
+    transformScalar(x + nv, y + nv, z + nv, n - nv, m, out + nv);
+}
+
+OCC_TARGET_SSE2
+static inline __m128d gather2(const double *v, int a, int b)
+{
+    return _mm_set_pd(v[b], v[a]);
+}
+
+OCC_TARGET_SSE2
+static void faceNormalsSSE2(const double *x, const double *y, const double *z,
+                            const int *tris, int ntris, double *nx, double *ny,
+                            double *nz, unsigned char *valid)
+{
+    const int nv = ntris & ~1;
+    const __m128d eps = _mm_set1_pd(DEGENERATED);
+    for (int t = 0; t < nv; t += 2) {
+        const int *a = tris + 3*t, *b = a + 3;
+        const __m128d x1 = gather2(x, a[0], b[0]), y1 = gather2(y, a[0], b[0]), z1 = gather2(z, a[0], b[0]);
+        const __m128d x2 = gather2(x, a[1], b[1]), y2 = gather2(y, a[1], b[1]), z2 = gather2(z, a[1], b[1]);
+        const __m128d x3 = gather2(x, a[2], b[2]), y3 = gather2(y, a[2], b[2]), z3 = gather2(z, a[2], b[2]);
+        
+        const __m128d v1x = _mm_sub_pd(x3, x1), v1y = _mm_sub_pd(y3, y1), v1z = _mm_sub_pd(z3, z1);
+        const __m128d v2x = _mm_sub_pd(x2, x1), v2y = _mm_sub_pd(y2, y1), v2z = _mm_sub_pd(z2, z1);
+        const __m128d cx = _mm_sub_pd(_mm_mul_pd(v1y, v2z), _mm_mul_pd(v1z, v2y));
+        const __m128d cy = _mm_sub_pd(_mm_mul_pd(v1z, v2x), _mm_mul_pd(v1x, v2z));
+        const __m128d cz = _mm_sub_pd(_mm_mul_pd(v1x, v2y), _mm_mul_pd(v1y, v2x));
+        _mm_storeu_pd(nx + t, cx);
+        _mm_storeu_pd(ny + t, cy);
+        _mm_storeu_pd(nz + t, cz);
+        
+        const __m128d l1 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(v1x, v1x), _mm_mul_pd(v1y, v1y)), _mm_mul_pd(v1z, v1z));
+        const __m128d l2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(v2x, v2x), _mm_mul_pd(v2y, v2y)), _mm_mul_pd(v2z, v2z));
+        const __m128d l3 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(cx, cx), _mm_mul_pd(cy, cy)), _mm_mul_pd(cz, cz));
+        const __m128d ok = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(l1, eps), _mm_cmpge_pd(l2, eps)),
+                                      _mm_cmpge_pd(l3, eps));
+        const int mask = _mm_movemask_pd(ok);
+        
+        valid[t] = (mask & 1) && a[0] != a[1] && a[1] != a[2] && a[2] != a[0];
+        valid[t + 1] = (mask & 2) && b[0] != b[1] && b[1] != b[2] && b[2] != b[0];
+    }
+    faceNormalsScalar(x, y, z, tris + 3*nv, ntris - nv, nx + nv, ny + nv, nz + nv, valid + nv);
+}
+
+OCC_TARGET_SSE2
+static void normalizeSSE2(const double *x, const double *y, const double *z,
+                          int n, OCCStruct3f *out)
+{
+    const int nv = n & ~1;
+    const __m128d eps = _mm_set1_pd(DEGENERATED);
+    float res[3][4];
+    for (int i = 0; i < nv; i += 2) {
+        __m128d vx = _mm_loadu_pd(x + i), vy = _mm_loadu_pd(y + i), vz = _mm_loadu_pd(z + i);
+        const __m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(vx, vx), _mm_mul_pd(vy, vy)), _mm_mul_pd(vz, vz));
+        const __m128d mask = _mm_cmpgt_pd(d2, eps);
+        const __m128d d = _mm_sqrt_pd(d2);
+        vx = _mm_or_pd(_mm_and_pd(mask, _mm_div_pd(vx, d)), _mm_andnot_pd(mask, vx));
+        vy = _mm_or_pd(_mm_and_pd(mask, _mm_div_pd(vy, d)), _mm_andnot_pd(mask, vy));
+        vz = _mm_or_pd(_mm_and_pd(mask, _mm_div_pd(vz, d)), _mm_andnot_pd(mask, vz));
+        _mm_storeu_ps(res[0], _mm_cvtpd_ps(vx));
+        _mm_storeu_ps(res[1], _mm_cvtpd_ps(vy));
+        _mm_storeu_ps(res[2], _mm_cvtpd_ps(vz));
+        for (int j = 0; j < 2; j++) {
+            out[i + j].x = res[0][j];
+            out[i + j].y = res[1][j];
+            out[i + j].z = res[2][j];
+        }
+    }
+    normalizeScalar(x + nv, y + nv, z + nv, n - nv, out + nv);
+}
+
+OCC_TARGET_SSE2
+static inline __m128d absSSE2(__m128d v)
+{
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), v);
+}
+
+// mask ? a : b
+OCC_TARGET_SSE2
+static inline __m128d selectSSE2(__m128d mask, __m128d a, __m128d b)
+{
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+OCC_TARGET_SSE2
+static inline __m128d signSSE2(__m128d v)
+{
+    return selectSSE2(_mm_cmpge_pd(v, _mm_setzero_pd()), _mm_set1_pd(1.0), _mm_set1_pd(-1.0));
+}
+
+OCC_TARGET_SSE2
+static inline void quantizeStoreSSE2(__m128d t, __m128d range, unsigned int *q)
+{
+    t = _mm_max_pd(_mm_add_pd(t, _mm_set1_pd(0.5)), _mm_setzero_pd());
+    t = _mm_min_pd(t, range);
+    _mm_storel_epi64((__m128i *)q, _mm_cvttpd_epi32(t));
+}
+
+OCC_TARGET_SSE2
+static inline __m128d loadUIntSSE2(const unsigned int *q)
+{
+    return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)q));
+}
+
+OCC_TARGET_SSE2
+static inline void storeStructSSE2(__m128d vx, __m128d vy, __m128d vz, OCCStruct3f *out)
+{
+    float res[3][4];
+    _mm_storeu_ps(res[0], _mm_cvtpd_ps(vx));
+    _mm_storeu_ps(res[1], _mm_cvtpd_ps(vy));
+    _mm_storeu_ps(res[2], _mm_cvtpd_ps(vz));
+    for (int j = 0; j < 2; j++) {
+        out[j].x = res[0][j];
+        out[j].y = res[1][j];
+        out[j].z = res[2][j];
+    }
+}
+
+OCC_TARGET_SSE2
+static void quantizeSSE2(const double *x, const double *y, const double *z,
+                         int n, const double *origin, const double *inv,
+                         double range, unsigned int *qx, unsigned int *qy,
+                         unsigned int *qz)
+{
+    const int nv = n & ~1;
+    const __m128d r = _mm_set1_pd(range);
+    const __m128d ox = _mm_set1_pd(origin[0]), oy = _mm_set1_pd(origin[1]), oz = _mm_set1_pd(origin[2]);
+    const __m128d sx = _mm_set1_pd(inv[0]), sy = _mm_set1_pd(inv[1]), sz = _mm_set1_pd(inv[2]);
+    for (int i = 0; i < nv; i += 2) {
+        quantizeStoreSSE2(_mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(x + i), ox), sx), r, qx + i);
+        quantizeStoreSSE2(_mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(y + i), oy), sy), r, qy + i);
+        quantizeStoreSSE2(_mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(z + i), oz), sz), r, qz + i);
+    }
+    quantizeScalar(x + nv, y + nv, z + nv, n - nv, origin, inv, range,
+                   qx + nv, qy + nv, qz + nv);
+}
+
+OCC_TARGET_SSE2
+static void dequantizeSSE2(const unsigned int *qx, const unsigned int *qy,
+                           const unsigned int *qz, int n, const double *origin,
+                           const double *scale, OCCStruct3f *out)
+{
+    const int nv = n & ~1;
+    const __m128d ox = _mm_set1_pd(origin[0]), oy = _mm_set1_pd(origin[1]), oz = _mm_set1_pd(origin[2]);
+    const __m128d sx = _mm_set1_pd(scale[0]), sy = _mm_set1_pd(scale[1]), sz = _mm_set1_pd(scale[2]);
+    for (int i = 0; i < nv; i += 2) {
+        const __m128d vx = _mm_add_pd(ox, _mm_mul_pd(loadUIntSSE2(qx + i), sx));
+        const __m128d vy = _mm_add_pd(oy, _mm_mul_pd(loadUIntSSE2(qy + i), sy));
+        const __m128d vz = _mm_add_pd(oz, _mm_mul_pd(loadUIntSSE2(qz + i), sz));
+        storeStructSSE2(vx, vy, vz, out + i);
+    }
+    dequantizeScalar(qx + nv, qy + nv, qz + nv, n - nv, origin, scale, out + nv);
+}
+
+// The fold of the lower half is computed for all lanes and blended in
+// where z < 0.
+OCC_TARGET_SSE2
+static void octEncodeSSE2(const double *x, const double *y, const double *z,
+                          int n, double range, unsigned int *qu, unsigned int *qv)
+{
+    const int nv = n & ~1;
+    const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0), half = _mm_set1_pd(0.5);
+    const __m128d r = _mm_set1_pd(range);
+    for (int i = 0; i < nv; i += 2) {
+        const __m128d vx = _mm_loadu_pd(x + i), vy = _mm_loadu_pd(y + i), vz = _mm_loadu_pd(z + i);
+        const __m128d l1 = _mm_add_pd(_mm_add_pd(absSSE2(vx), absSSE2(vy)), absSSE2(vz));
+        const __m128d inv = _mm_and_pd(_mm_cmpgt_pd(l1, zero), _mm_div_pd(one, l1));
+        __m128d u = _mm_mul_pd(vx, inv), v = _mm_mul_pd(vy, inv);
+        
+        const __m128d fu = _mm_mul_pd(_mm_sub_pd(one, absSSE2(v)), signSSE2(u));
+        const __m128d fv = _mm_mul_pd(_mm_sub_pd(one, absSSE2(u)), signSSE2(v));
+        const __m128d lower = _mm_cmplt_pd(vz, zero);
+        u = selectSSE2(lower, fu, u);
+        v = selectSSE2(lower, fv, v);
+        
+        quantizeStoreSSE2(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(u, half), half), r), r, qu + i);
+        quantizeStoreSSE2(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(v, half), half), r), r, qv + i);
+    }
+    octEncodeScalar(x + nv, y + nv, z + nv, n - nv, range, qu + nv, qv + nv);
+}
+
+OCC_TARGET_SSE2
+static void octDecodeSSE2(const unsigned int *qu, const unsigned int *qv, int n,
+                          double range, OCCStruct3f *out)
+{
+    const int nv = n & ~1;
+    const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0), two = _mm_set1_pd(2.0);
+    const __m128d r = _mm_set1_pd(range);
+    for (int i = 0; i < nv; i += 2) {
+        __m128d u = _mm_sub_pd(_mm_mul_pd(_mm_div_pd(loadUIntSSE2(qu + i), r), two), one);
+        __m128d v = _mm_sub_pd(_mm_mul_pd(_mm_div_pd(loadUIntSSE2(qv + i), r), two), one);
+        const __m128d w = _mm_sub_pd(_mm_sub_pd(one, absSSE2(u)), absSSE2(v));
+        
+        const __m128d fu = _mm_mul_pd(_mm_sub_pd(one, absSSE2(v)), signSSE2(u));
+        const __m128d fv = _mm_mul_pd(_mm_sub_pd(one, absSSE2(u)), signSSE2(v));
+        const __m128d lower = _mm_cmplt_pd(w, zero);
+        u = selectSSE2(lower, fu, u);
+        v = selectSSE2(lower, fv, v);
+        
+        const __m128d len = _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(u, u), _mm_mul_pd(v, v)),
+                                                   _mm_mul_pd(w, w)));
+        storeStructSSE2(_mm_div_pd(u, len), _mm_div_pd(v, len), _mm_div_pd(w, len), out + i);
+    }
+    octDecodeScalar(qu + nv, qv + nv, n - nv, range, out + nv);
+}
+
+// AVX2 kernels, four doubles per lane
+
+OCC_TARGET_AVX2
+static void transformAVX2(const double *x, const double *y, const double *z,
+                          int n, const double *m, OCCStruct3f *out)
+{
+    const int nv = n & ~3;
+    float res[3][4];
+    for (int i = 0; i < nv; i += 4) {
+        const __m256d px = _mm256_loadu_pd(x + i);
+        const __m256d py = _mm256_loadu_pd(y + i);
+        const __m256d pz = _mm256_loadu_pd(z + i);
+        for (int r = 0; r < 3; r++) {
+            __m256d v = _mm256_mul_pd(_mm256_set1_pd(m[4*r]), px);
+            v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_set1_pd(m[4*r + 1]), py));
+            v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_set1_pd(m[4*r + 2]), pz));
+            v = _mm256_add_pd(v, _mm256_set1_pd(m[4*r + 3]));
+            _mm_storeu_ps(res[r], _mm256_cvtpd_ps(v));
+        }
+        for (int j = 0; j < 4; j++) {
+            out[i + j].x = res[0][j];
+            out[i + j].y = res[1][j];
+            out[i + j].z = res[2][j];
+        }
+    }
+    transformScalar(x + nv, y + nv, z + nv, n - nv, m, out + nv);
+}
+
+OCC_TARGET_AVX2
+static void faceNormalsAVX2(const double *x, const double *y, const double *z,
+                            const int *tris, int ntris, double *nx, double *ny,
+                            double *nz, unsigned char *valid)
+{
+    const int nv = ntris & ~3;
+    const __m128i stride = _mm_setr_epi32(0, 3, 6, 9);
+    const __m256d eps = _mm256_set1_pd(DEGENERATED);
+    for (int t = 0; t < nv; t += 4) {
+        const int *base = tris + 3*t;
+        const __m128i i1 = _mm_i32gather_epi32(base, stride, 4);
+        const __m128i i2 = _mm_i32gather_epi32(base + 1, stride, 4);
+        const __m128i i3 = _mm_i32gather_epi32(base + 2, stride, 4);
+        
+        const __m256d x1 = _mm256_i32gather_pd(x, i1, 8), y1 = _mm256_i32gather_pd(y, i1, 8), z1 = _mm256_i32gather_pd(z, i1, 8);
+        const __m256d x2 = _mm256_i32gather_pd(x, i2, 8), y2 = _mm256_i32gather_pd(y, i2, 8), z2 = _mm256_i32gather_pd(z, i2, 8);
+        const __m256d x3 = _mm256_i32gather_pd(x, i3, 8), y3 = _mm256_i32gather_pd(y, i3, 8), z3 = _mm256_i32gather_pd(z, i3, 8);
+        
+        const __m256d v1x = _mm256_sub_pd(x3, x1), v1y = _mm256_sub_pd(y3, y1), v1z = _mm256_sub_pd(z3, z1);
+        const __m256d v2x = _mm256_sub_pd(x2, x1), v2y = _mm256_sub_pd(y2, y1), v2z = _mm256_sub_pd(z2, z1);
+        const __m256d cx = _mm256_sub_pd(_mm256_mul_pd(v1y, v2z), _mm256_mul_pd(v1z, v2y));
+        const __m256d cy = _mm256_sub_pd(_mm256_mul_pd(v1z, v2x), _mm256_mul_pd(v1x, v2z));
+        const __m256d cz = _mm256_sub_pd(_mm256_mul_pd(v1x, v2y), _mm256_mul_pd(v1y, v2x));
+        _mm256_storeu_pd(nx + t, cx);
+        _mm256_storeu_pd(ny + t, cy);
+        _mm256_storeu_pd(nz + t, cz);
+        
+        const __m256d l1 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(v1x, v1x), _mm256_mul_pd(v1y, v1y)), _mm256_mul_pd(v1z, v1z));
+        const __m256d l2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(v2x, v2x), _mm256_mul_pd(v2y, v2y)), _mm256_mul_pd(v2z, v2z));
+        const __m256d l3 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(cx, cx), _mm256_mul_pd(cy, cy)), _mm256_mul_pd(cz, cz));
+        const __m256d ok = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(l1, eps, _CMP_GE_OQ),
+                                                       _mm256_cmp_pd(l2, eps, _CMP_GE_OQ)),
+                                         _mm256_cmp_pd(l3, eps, _CMP_GE_OQ));
+        
+        // indices must differ, 4 bits set in same
+        const __m128i same = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(i1, i2), _mm_cmpeq_epi32(i2, i3)),
+                                          _mm_cmpeq_epi32(i3, i1));
+        const int mask = _mm256_movemask_pd(ok) & ~_mm_movemask_ps(_mm_castsi128_ps(same));
+        for (int j = 0; j < 4; j++)
+            valid[t + j] = (mask >> j) & 1;
+    }
+    faceNormalsScalar(x, y, z, tris + 3*nv, ntris - nv, nx + nv, ny + nv, nz + nv, valid + nv);
+}
+
+OCC_TARGET_AVX2
+static void normalizeAVX2(const double *x, const double *y, const double *z,
+                          int n, OCCStruct3f *out)
+{
+    const int nv = n & ~3;
+    const __m256d eps = _mm256_set1_pd(DEGENERATED);
+    float res[3][4];
+    for (int i = 0; i < nv; i += 4) {
+        __m256d vx = _mm256_loadu_pd(x + i), vy = _mm256_loadu_pd(y + i), vz = _mm256_loadu_pd(z + i);
+        const __m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vx, vx), _mm256_mul_pd(vy, vy)),
+                                         _mm256_mul_pd(vz, vz));
+        const __m256d mask = _mm256_cmp_pd(d2, eps, _CMP_GT_OQ);
+        const __m256d d = _mm256_sqrt_pd(d2);
+        vx = _mm256_blendv_pd(vx, _mm256_div_pd(vx, d), mask);
+        vy = _mm256_blendv_pd(vy, _mm256_div_pd(vy, d), mask);
+        vz = _mm256_blendv_pd(vz, _mm256_div_pd(vz, d), mask);
+        _mm_storeu_ps(res[0], _mm256_cvtpd_ps(vx));
+        _mm_storeu_ps(res[1], _mm256_cvtpd_ps(vy));
+        _mm_storeu_ps(res[2], _mm256_cvtpd_ps(vz));
+        for (int j = 0; j < 4; j++) {
+            out[i + j].x = res[0][j];
+            out[i + j].y = res[1][j];
+            out[i + j].z = res[2][j];
+        }
+    }
+    normalizeScalar(x + nv, y + nv, z + nv, n - nv, out + nv);
+}
+
+OCC_TARGET_AVX2
+static inline __m256d absAVX2(__m256d v)
+{
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), v);
+}
+
+OCC_TARGET_AVX2
+static inline __m256d signAVX2(__m256d v)
+{
+    const __m256d mask = _mm256_cmp_pd(v, _mm256_setzero_pd(), _CMP_GE_OQ);
+    return _mm256_blendv_pd(_mm256_set1_pd(-1.0), _mm256_set1_pd(1.0), mask);
+}
+
+OCC_TARGET_AVX2
+static inline void quantizeStoreAVX2(__m256d t, __m256d range, unsigned int *q)
+{
+    t = _mm256_max_pd(_mm256_add_pd(t, _mm256_set1_pd(0.5)), _mm256_setzero_pd());
+    t = _mm256_min_pd(t, range);
+    _mm_storeu_si128((__m128i *)q, _mm256_cvttpd_epi32(t));
+}
+
+OCC_TARGET_AVX2
+static inline __m256d loadUIntAVX2(const unsigned int *q)
+{
+    return _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)q));
+}
+
+OCC_TARGET_AVX2
+static inline void storeStructAVX2(__m256d vx, __m256d vy, __m256d vz, OCCStruct3f *out)
+{
+    float res[3][4];
+    _mm_storeu_ps(res[0], _mm256_cvtpd_ps(vx));
+    _mm_storeu_ps(res[1], _mm256_cvtpd_ps(vy));
+    _mm_storeu_ps(res[2], _mm256_cvtpd_ps(vz));
+    for (int j = 0; j < 4; j++) {
+        out[j].x = res[0][j];
+        out[j].y = res[1][j];
+        out[j].z = res[2][j];
+    }
+}
+
+OCC_TARGET_AVX2
+static void quantizeAVX2(const double *x, const double *y, const double *z,
+                         int n, const double *origin, const double *inv,
+                         double range, unsigned int *qx, unsigned int *qy,
+                         unsigned int *qz)
+{
+    const int nv = n & ~3;
+    const __m256d r = _mm256_set1_pd(range);
+    const __m256d ox = _mm256_set1_pd(origin[0]), oy = _mm256_set1_pd(origin[1]), oz = _mm256_set1_pd(origin[2]);
+    const __m256d sx = _mm256_set1_pd(inv[0]), sy = _mm256_set1_pd(inv[1]), sz = _mm256_set1_pd(inv[2]);
+    for (int i = 0; i < nv; i += 4) {
+        quantizeStoreAVX2(_mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(x + i), ox), sx), r, qx + i);
+        quantizeStoreAVX2(_mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(y + i), oy), sy), r, qy + i);
+        quantizeStoreAVX2(_mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(z + i), oz), sz), r, qz + i);
+    }
+    quantizeScalar(x + nv, y + nv, z + nv, n - nv, origin, inv, range,
+                   qx + nv, qy + nv, qz + nv);
+}
+
+OCC_TARGET_AVX2
+static void dequantizeAVX2(const unsigned int *qx, const unsigned int *qy,
+                           const unsigned int *qz, int n, const double *origin,
+                           const double *scale, OCCStruct3f *out)
+{
+    const int nv = n & ~3;
+    const __m256d ox = _mm256_set1_pd(origin[0]), oy = _mm256_set1_pd(origin[1]), oz = _mm256_set1_pd(origin[2]);
+    const __m256d sx = _mm256_set1_pd(scale[0]), sy = _mm256_set1_pd(scale[1]), sz = _mm256_set1_pd(scale[2]);
+    for (int i = 0; i < nv; i += 4) {
+        const __m256d vx = _mm256_add_pd(ox, _mm256_mul_pd(loadUIntAVX2(qx + i), sx));
+        const __m256d vy = _mm256_add_pd(oy, _mm256_mul_pd(loadUIntAVX2(qy + i), sy));
+        const __m256d vz = _mm256_add_pd(oz, _mm256_mul_pd(loadUIntAVX2(qz + i), sz));
+        storeStructAVX2(vx, vy, vz, out + i);
+    }
+    dequantizeScalar(qx + nv, qy + nv, qz + nv, n - nv, origin, scale, out + nv);
+}
+
+OCC_TARGET_AVX2
+static void octEncodeAVX2(const double *x, const double *y, const double *z,
+                          int n, double range, unsigned int *qu, unsigned int *qv)
+{
+    const int nv = n & ~3;
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0), half = _mm256_set1_pd(0.5);
+    const __m256d r = _mm256_set1_pd(range);
+    for (int i = 0; i < nv; i += 4) {
+        const __m256d vx = _mm256_loadu_pd(x + i), vy = _mm256_loadu_pd(y + i), vz = _mm256_loadu_pd(z + i);
+        const __m256d l1 = _mm256_add_pd(_mm256_add_pd(absAVX2(vx), absAVX2(vy)), absAVX2(vz));
+        const __m256d inv = _mm256_and_pd(_mm256_cmp_pd(l1, zero, _CMP_GT_OQ), _mm256_div_pd(one, l1));
+        __m256d u = _mm256_mul_pd(vx, inv), v = _mm256_mul_pd(vy, inv);
+        
+        const __m256d fu = _mm256_mul_pd(_mm256_sub_pd(one, absAVX2(v)), signAVX2(u));
+        const __m256d fv = _mm256_mul_pd(_mm256_sub_pd(one, absAVX2(u)), signAVX2(v));
+        const __m256d lower = _mm256_cmp_pd(vz, zero, _CMP_LT_OQ);
+        u = _mm256_blendv_pd(u, fu, lower);
+        v = _mm256_blendv_pd(v, fv, lower);
+        
+        quantizeStoreAVX2(_mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(u, half), half), r), r, qu + i);
+        quantizeStoreAVX2(_mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(v, half), half), r), r, qv + i);
+    }
+    octEncodeScalar(x + nv, y + nv, z + nv, n - nv, range, qu + nv, qv + nv);
+}
+
+OCC_TARGET_AVX2
+static void octDecodeAVX2(const unsigned int *qu, const unsigned int *qv, int n,
+                          double range, OCCStruct3f *out)
+{
+    const int nv = n & ~3;
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0), two = _mm256_set1_pd(2.0);
+    const __m256d r = _mm256_set1_pd(range);
+    for (int i = 0; i < nv; i += 4) {
+        __m256d u = _mm256_sub_pd(_mm256_mul_pd(_mm256_div_pd(loadUIntAVX2(qu + i), r), two), one);
+        __m256d v = _mm256_sub_pd(_mm256_mul_pd(_mm256_div_pd(loadUIntAVX2(qv + i), r), two), one);
+        const __m256d w = _mm256_sub_pd(_mm256_sub_pd(one, absAVX2(u)), absAVX2(v));
+        
+        const __m256d fu = _mm256_mul_pd(_mm256_sub_pd(one, absAVX2(v)), signAVX2(u));
+        const __m256d fv = _mm256_mul_pd(_mm256_sub_pd(one, absAVX2(u)), signAVX2(v));
+        const __m256d lower = _mm256_cmp_pd(w, zero, _CMP_LT_OQ);
+        u = _mm256_blendv_pd(u, fu, lower);
+        v = _mm256_blendv_pd(v, fv, lower);
+        
+        const __m256d len = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(u, u), _mm256_mul_pd(v, v)),
+                                                         _mm256_mul_pd(w, w)));
+        storeStructAVX2(_mm256_div_pd(u, len), _mm256_div_pd(v, len), _mm256_div_pd(w, len), out + i);
+    }
+    octDecodeScalar(qu + nv, qv + nv, n - nv, range, out + nv);
+}
+
+#endif
+
+static int supportedLevel()
+{
+#ifdef OCC_MESH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return MESH_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return MESH_SIMD_SSE2;
+#endif
+    return MESH_SIMD_SCALAR;
+}
+
+// Initialized when the library is loaded, before any parallel region
+// reads it. Only changed by setMeshSIMDLevel between mesh operations.
+static int activeLevel = supportedLevel();
+
+int meshSIMDLevel()
+{
+    return activeLevel;
+}
+
+// Select kernel level, limited to what the CPU supports. A negative
+// level select the best supported. Returns the active level.
+int setMeshSIMDLevel(int level)
+{
+    const int supported = supportedLevel();
+    activeLevel = level < 0 ? supported : std::min(level, supported);
+    return activeLevel;
+}
+
+void meshTransformNodes(const double *x, const double *y, const double *z,
+                        int n, const double *m, OCCStruct3f *out)
+{
+    switch (meshSIMDLevel()) {
+#ifdef OCC_MESH_X86
+        case MESH_SIMD_AVX2:
+            transformAVX2(x, y, z, n, m, out);
+            break;
+        case MESH_SIMD_SSE2:
+            transformSSE2(x, y, z, n, m, out);
+            break;
+#endif
+        default:
+            transformScalar(x, y, z, n, m, out);
+    }
+}
+
+void meshFaceNormals(const double *x, const double *y, const double *z,
+                     const int *tris, int ntris, double *nx, double *ny,
+                     double *nz, unsigned char *valid)
+{
+    switch (meshSIMDLevel()) {
+#ifdef OCC_MESH_X86
+        case MESH_SIMD_AVX2:
+            faceNormalsAVX2(x, y, z, tris, ntris, nx, ny, nz, valid);
+            break;
+        case MESH_SIMD_SSE2:
+            faceNormalsSSE2(x, y, z, tris, ntris, nx, ny, nz, valid);
+            break;
+#endif
+        default:
+            faceNormalsScalar(x, y, z, tris, ntris, nx, ny, nz, valid);
+    }
+}
+
+void meshNormalize(const double *x, const double *y, const double *z,
+                   int n, OCCStruct3f *out)
+{
+    switch (meshSIMDLevel()) {
+#ifdef OCC_MESH_X86
+        case MESH_SIMD_AVX2:
+            normalizeAVX2(x, y, z, n, out);
+            break;
+        case MESH_SIMD_SSE2:
+            normalizeSSE2(x, y, z, n, out);
+            break;
+#endif
+        default:
+            normalizeScalar(x, y, z, n, out);
+    }
+}
+
+void meshQuantize(const double *x, const double *y, const double *z, int n,
+                  const double *origin, const double *inv, double range,
+                  unsigned int *qx, unsigned int *qy, unsigned int *qz)
+{
+    switch (meshSIMDLevel()) {
+#ifdef OCC_MESH_X86
+        case MESH_SIMD_AVX2:
+            quantizeAVX2(x, y, z, n, origin, inv, range, qx, qy, qz);
+            break;
+        case MESH_SIMD_SSE2:
+            quantizeSSE2(x, y, z, n, origin, inv, range, qx, qy, qz);
+            break;
+#endif
+        default:
+            quantizeScalar(x, y, z, n, origin, inv, range, qx, qy, qz);
+    }
+}
+
+void meshDequantize(const unsigned int *qx, const unsigned int *qy,
+                    const unsigned int *qz, int n, const double *origin,
+                    const double *scale, OCCStruct3f *out)
+{
+    switch (meshSIMDLevel()) {
+#ifdef OCC_MESH_X86
+        case MESH_SIMD_AVX2:
+            dequantizeAVX2(qx, qy, qz, n, origin, scale, out);
+            break;
+        case MESH_SIMD_SSE2:
+            dequantizeSSE2(qx, qy, qz, n, origin, scale, out);
+            break;
+#endif
+        default:
+            dequantizeScalar(qx, qy, qz, n, origin, scale, out);
+    }
+}
+
+void meshOctEncode(const double *x, const double *y, const double *z, int n,
+                   double range, unsigned int *qu, unsigned int *qv)
+{
+    switch (meshSIMDLevel()) {
+#ifdef OCC_MESH_X86
+        case MESH_SIMD_AVX2:
+            octEncodeAVX2(x, y, z, n, range, qu, qv);
+            break;
+        case MESH_SIMD_SSE2:
+            octEncodeSSE2(x, y, z, n, range, qu, qv);
+            break;
+#endif
+        default:
+            octEncodeScalar(x, y, z, n, range, qu, qv);
+    }
+}
+
+void meshOctDecode(const unsigned int *qu, const unsigned int *qv, int n,
+                   double range, OCCStruct3f *out)
+{
+    switch (meshSIMDLevel()) {
+#ifdef OCC_MESH_X86
+        case MESH_SIMD_AVX2:
+            octDecodeAVX2(qu, qv, n, range, out);
+            break;
+        case MESH_SIMD_SSE2:
+            octDecodeSSE2(qu, qv, n, range, out);
+            break;
+#endif
+        default:
+            octDecodeScalar(qu, qv, n, range, out);
+    }
+}
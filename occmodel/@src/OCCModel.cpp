@@ -95,186 +95,221 @@ int OCCVertex::project(OCCBase *target) {
     return 1;
 }
         
-int OCCMesh::extractFaceMesh(const TopoDS_Face& face, bool qualityNormals = false)
+// Append triangles, normals and edges of the triangulation of face.
+// Raise Standard_Failure when the face has no triangulation, the
+// caller reports the error.
+void OCCMesh::appendFaceMesh(const TopoDS_Face& face, int faceId, int qualityNormals,
+                             double *normalTime)
 {
     int vsize = this->vertices.size();
-    std::vector<gp_Vec> normals;
+    int tsize = this->triangles.size();
+    // SoA work arrays, reused between faces
+    OCCMeshScratch& s = this->scratch;
     bool reversed = false;
     OCCStruct3f vert;
     OCCStruct3f norm;
     OCCStruct3I tri;
     
-    try {
-        if(face.IsNull())
-            StdFail_NotDone::Raise("Face is Null");
+    if(face.IsNull())
+        StdFail_NotDone::Raise("Face is Null");
+    
+    TopLoc_Location loc;
+    Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, loc);
+    
+    if(triangulation.IsNull())
+        StdFail_NotDone::Raise("No triangulation created");
+    
+    const int nnodes = triangulation->NbNodes();
+    const int ntris = triangulation->NbTriangles();
+    s.resize(nnodes, ntris);
+    
+    const TColgp_Array1OfPnt& narr = triangulation->Nodes();
+    for (int i = 0; i < nnodes; i++)
+    {
+        const gp_Pnt& pnt = narr(i + 1);
+        s.x[i] = pnt.X();
+        s.y[i] = pnt.Y();
+        s.z[i] = pnt.Z();
+    }
+    
+    // location as 3x4 matrix including scale factor
+    gp_Trsf tr = loc;
+    double mat[12];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 4; c++)
+            mat[4*r + c] = tr.Value(r + 1, c + 1);
+    }
+    
+    // output relative to mesh origin, the subtraction is done in
+    // double precision before conversion to float
+    mat[3] -= this->origin.x;
+    mat[7] -= this->origin.y;
+    mat[11] -= this->origin.z;
+    
+    // ensure we have normals for all vertices
+    norm.x = 0.f;
+    norm.y = 0.f;
+    norm.z = 0.f;
+    this->vertices.resize(vsize + nnodes);
+    this->normals.resize(vsize + nnodes, norm);
+    if (nnodes > 0)
+        meshTransformNodes(&s.x[0], &s.y[0], &s.z[0], nnodes, mat, &this->vertices[vsize]);
+    
+    if (this->interleave) {
+        for (int i = 0; i < nnodes; i++) {
+            vert = this->vertices[vsize + i];
+            OCCVertexNormal rec = {{vert.x, vert.y, vert.z, 1.f}, {0.f, 0.f, 0.f, 0.f}};
+            this->interleaved.push_back(rec);
+        }
+    }
     
-        TopLoc_Location loc;
-        Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, loc);
+    if (this->precise)
+        this->appendPrecise(triangulation, loc);
+    
+    if (face.Orientation() == TopAbs_REVERSED)
+        reversed = true;
+    
+    const Poly_Array1OfTriangle& triarr = triangulation->Triangles();
+    for (int i = 0; i < ntris; i++)
+    {
+        Standard_Integer n1,n2,n3;
+        if(reversed)
+            triarr(i + 1).Get(n2,n1,n3);
+        else
+            triarr(i + 1).Get(n1,n2,n3);
         
-        if(triangulation.IsNull())
-            StdFail_NotDone::Raise("No triangulation created");
+        s.tris[3*i] = n1 - 1;
+        s.tris[3*i + 1] = n2 - 1;
+        s.tris[3*i + 2] = n3 - 1;
+    }
+    
+    // face normals, invalid and degenerated triangles are flagged
+    if (ntris > 0)
+        meshFaceNormals(&s.x[0], &s.y[0], &s.z[0], &s.tris[0], ntris,
+                        &s.tx[0], &s.ty[0], &s.tz[0], &s.valid[0]);
+    
+    for (int i = 0; i < ntris; i++)
+    {
+        if (!s.valid[i])
+            continue;
+        
+        const int n1 = s.tris[3*i], n2 = s.tris[3*i + 1], n3 = s.tris[3*i + 2];
+        tri.i = vsize + n1;
+        tri.j = vsize + n2;
+        tri.k = vsize + n3;
+        this->triangles.push_back(tri);
         
-        gp_Trsf tr = loc;
-        const TColgp_Array1OfPnt& narr = triangulation->Nodes();
-        for (int i = 1; i <= triangulation->NbNodes(); i++)
+        s.nx[n1] = s.nx[n1] - s.tx[i];
+        s.ny[n1] = s.ny[n1] - s.ty[i];
+        s.nz[n1] = s.nz[n1] - s.tz[i];
+        s.nx[n2] = s.nx[n2] - s.tx[i];
+        s.ny[n2] = s.ny[n2] - s.ty[i];
+        s.nz[n2] = s.nz[n2] - s.tz[i];
+        s.nx[n3] = s.nx[n3] - s.tx[i];
+        s.ny[n3] = s.ny[n3] - s.ty[i];
+        s.nz[n3] = s.nz[n3] - s.tz[i];
+    }
+    
+    // Normals are accumulated from the untransformed nodes, rotate
+    // them to the frame of the shape. The scale factor of the location
+    // cancels out when they are normalized.
+    if (!loc.IsIdentity()) {
+        const gp_Mat& rot = tr.HVectorialPart();
+        for (int i = 0; i < nnodes; i++)
         {
-            Standard_Real x,y,z;
-            const gp_Pnt& pnt = narr(i);
-            x = pnt.X();
-            y = pnt.Y();
-            z = pnt.Z();
-            tr.Transforms(x,y,z);
-            
-            vert.x = (float)x;
-            vert.y = (float)y;
-            vert.z = (float)z;
-            this->vertices.push_back(vert);
-            
-            // ensure we have normals for all vertices
-            norm.x = 0.f;
-            norm.y = 0.f;
-            norm.z = 0.f;
-            this->normals.push_back(norm);
-            
-            if (!qualityNormals)
-                normals.push_back(gp_Vec(0.0,0.0,0.0));
+            const double x = s.nx[i], y = s.ny[i], z = s.nz[i];
+            s.nx[i] = rot.Value(1, 1)*x + rot.Value(1, 2)*y + rot.Value(1, 3)*z;
+            s.ny[i] = rot.Value(2, 1)*x + rot.Value(2, 2)*y + rot.Value(2, 3)*z;
+            s.nz[i] = rot.Value(3, 1)*x + rot.Value(3, 2)*y + rot.Value(3, 3)*z;
         }
-        
-        if (face.Orientation() == TopAbs_REVERSED)
-            reversed = true;
-        
-        const Poly_Array1OfTriangle& triarr = triangulation->Triangles();
-        for (int i = 1; i <= triangulation->NbTriangles(); i++)
+    }
+    
+    const double start = meshTimer();
+    if (qualityNormals == NORMALS_SURFACE && triangulation->HasUVNodes()) {
+        // evaluate surface normals directly at the (u,v) nodes
+        // of the triangulation with a single surface adaptor.
+        const TColgp_Array1OfPnt2d& uvarr = triangulation->UVNodes();
+        BRepAdaptor_Surface adaptor(face, Standard_False);
+        BRepLProp_SLProps faceprop(adaptor, 1, gp::Resolution());
+        gp_Vec normal;
+        for (int i = 0; i < nnodes; i++)
         {
-            Poly_Triangle pt = triarr(i);
-            Standard_Integer n1,n2,n3;
+            const gp_Pnt2d& uv = uvarr(i + 1);
+            faceprop.SetParameters(uv.X(), uv.Y());
             
-            if(reversed)
-                pt.Get(n2,n1,n3);
-            else
-                pt.Get(n1,n2,n3);
+            if (faceprop.IsNormalDefined()) {
+                normal = faceprop.Normal();
+                if (reversed)
+                    normal.Reverse();
+            } else {
+                // singular point (cone apex, sphere pole)
+                normal = gp_Vec(s.nx[i], s.ny[i], s.nz[i]);
+            }
             
-            // make sure that we don't process invalid triangle
-            if (n1 == n2 || n2 == n3 || n3 == n1)
-                continue;
-                
-            // Calculate face normal
-            const gp_Pnt& P1 = narr(n1);
-            const gp_Pnt& P2 = narr(n2);
-            const gp_Pnt& P3 = narr(n3);
+            if (normal.SquareMagnitude() > 1.0e-10)
+                normal.Normalize();
             
-            gp_Vec V1(P3.X() - P1.X(), P3.Y() - P1.Y(), P3.Z() - P1.Z());
-            if (V1.SquareMagnitude() < 1.0e-10)
-                // Degenerated triangle
-                continue;
-            
-            gp_Vec V2(P2.X() - P1.X(), P2.Y() - P1.Y(), P2.Z() - P1.Z());
-            if (V2.SquareMagnitude() < 1.0e-10)
-                // Degenerated triangle
-                continue;
+            norm.x = (float)normal.X();
+            norm.y = (float)normal.Y();
+            norm.z = (float)normal.Z();
+            this->setNormal(vsize + i, norm);
+        }
+    } else if (qualityNormals != NORMALS_SMOOTH) {
+        // recover (u,v) by projecting each node onto the surface
+        Handle_Geom_Surface surface = BRep_Tool::Surface(face);
+        gp_Vec normal;
+        for (int i = 0; i < nnodes; i++)
+        {
+            // absolute node position, independent of mesh origin
+            gp_Pnt vertex = narr(i + 1).Transformed(tr);
+            GeomAPI_ProjectPointOnSurf SrfProp(vertex, surface);
+            Standard_Real fU, fV;
+            SrfProp.Parameters(1, fU, fV);
             
-            gp_Vec normal = V1.Crossed(V2);
-            if (normal.SquareMagnitude() < 1.0e-10)
-                // Degenerated triangle
-                continue;
+            GeomLProp_SLProps faceprop(surface, fU, fV, 2, gp::Resolution());
+            normal = faceprop.Normal();
             
-            tri.i = vsize + n1 - 1;
-            tri.j = vsize + n2 - 1;
-            tri.k = vsize + n3 - 1;
-            this->triangles.push_back(tri);
+            if (normal.SquareMagnitude() > 1.0e-10)
+                normal.Normalize();
             
-            if (!qualityNormals) {
-                normals[n1 - 1] = normals[n1 - 1] - normal;
-                normals[n2 - 1] = normals[n2 - 1] - normal;
-                normals[n3 - 1] = normals[n3 - 1] - normal;
-            }
-        }
-        
-        if (qualityNormals) {
-            Handle_Geom_Surface surface = BRep_Tool::Surface(face);
-            gp_Vec normal;
-            for (int i = 0; i < triangulation->NbNodes(); i++)
-            {
-                vert = this->vertices[vsize + i];
-                gp_Pnt vertex(vert.x, vert.y, vert.z);
-                GeomAPI_ProjectPointOnSurf SrfProp(vertex, surface);
-                Standard_Real fU, fV;
-                SrfProp.Parameters(1, fU, fV);
-
-                GeomLProp_SLProps faceprop(surface, fU, fV, 2, gp::Resolution());
-                normal = faceprop.Normal();
-                
-                if (normal.SquareMagnitude() > 1.0e-10)
-                    normal.Normalize();
-                
-                if (reversed) {
-                    norm.x = (float)-normal.X();
-                    norm.y = (float)-normal.Y();
-                    norm.z = (float)-normal.Z();
-                } else {
-                    norm.x = (float)normal.X();
-                    norm.y = (float)normal.Y();
-                    norm.z = (float)normal.Z();
-                }
-                this->normals[vsize + i] = norm;
-            }
-        } else {
-            // Normalize vertex normals
-            for (int i = 0; i < triangulation->NbNodes(); i++)
-            {
-                gp_Vec normal = normals[i];
-                if (normal.SquareMagnitude() > 1.0e-10)
-                    normal.Normalize();
-                
+            if (reversed) {
+                norm.x = (float)-normal.X();
+                norm.y = (float)-normal.Y();
+                norm.z = (float)-normal.Z();
+            } else {
                 norm.x = (float)normal.X();
                 norm.y = (float)normal.Y();
                 norm.z = (float)normal.Z();
-                this->normals[vsize + i] = norm;
             }
+            this->setNormal(vsize + i, norm);
         }
+    } else {
+        // Normalize vertex normals
+        if (nnodes > 0)
+            meshNormalize(&s.nx[0], &s.ny[0], &s.nz[0], nnodes, &this->normals[vsize]);
         
-        // extract edge indices from mesh
-        std::set<int> seen;
-        for (unsigned int i = 0; i < this->edgehash.size(); i++)
-            seen.insert(this->edgehash[i]);
-        
-        int lastSize = this->edgeindices.size();
-        TopExp_Explorer ex0, ex1;
-        for (ex0.Init(face, TopAbs_WIRE); ex0.More(); ex0.Next()) {
-            const TopoDS_Wire& wire = TopoDS::Wire(ex0.Current());
-            for (ex1.Init(wire, TopAbs_EDGE); ex1.More(); ex1.Next()) {
-                const TopoDS_Edge& edge = TopoDS::Edge(ex1.Current());
-                
-                // skip degenerated edge
-                if (BRep_Tool::Degenerated(edge))
-                    continue;
-                
-                // skip edge if it is a seam
-                if (BRep_Tool::IsClosed(edge, face))
-                    continue;
-                    
-                int hash = edge.HashCode(std::numeric_limits<int>::max());
-                if (seen.count(hash) == 0) {
-                    Handle(Poly_PolygonOnTriangulation) edgepoly = BRep_Tool::PolygonOnTriangulation(edge, triangulation, loc);
-                    if (edgepoly.IsNull()) {
-                        continue;
-                    }
-                    seen.insert(hash);
-                    this->edgehash.push_back(hash);
-                    this->edgeranges.push_back(this->edgeindices.size());
-                    
-                    const TColStd_Array1OfInteger& edgeind = edgepoly->Nodes();
-                    for (int i=edgeind.Lower();i <= edgeind.Upper();i++) {
-                        const unsigned int idx = (unsigned int)edgeind(i);
-                        this->edgeindices.push_back(vsize + idx - 1);
-                    }
-                    
-                    this->edgeranges.push_back(this->edgeindices.size() - lastSize);
-                    lastSize = this->edgeindices.size();
-                }
-            }
+        if (this->interleave) {
+            for (int i = 0; i < nnodes; i++)
+                this->setNormal(vsize + i, this->normals[vsize + i]);
         }
-        
+    }
+    if (normalTime != NULL)
+        *normalTime += meshTimer() - start;
+    
+    this->extractFaceEdges(face, triangulation, loc, vsize);
+    
+    this->faceranges.push_back(tsize);
+    this->faceranges.push_back(this->triangles.size() - tsize);
+    this->faceranges.push_back(vsize);
+    this->faceranges.push_back(this->vertices.size() - vsize);
+    this->faceranges.push_back(faceId);
+}
+
+int OCCMesh::extractFaceMesh(const TopoDS_Face& face, int faceId,
+                             int qualityNormals = NORMALS_SMOOTH, double *normalTime = NULL)
+{
+    try {
+        this->appendFaceMesh(face, faceId, qualityNormals, normalTime);
     } catch(Standard_Failure &err) {
         Handle_Standard_Failure e = Standard_Failure::Caught();
         const Standard_CString msg = e->GetMessageString();
@@ -289,190 +324,543 @@ int OCCMesh::extractFaceMesh(const TopoDS_Face& face, bool qualityNormals = fals
     return 1;
 }
 
+// Append polylines of the edges of face not already in the mesh
+void OCCMesh::extractFaceEdges(const TopoDS_Face& face,
+                               const Handle(Poly_Triangulation)& triangulation,
+                               const TopLoc_Location& loc, int vsize)
+{
+    const double start = meshTimer();
+    int lastSize = this->edgeindices.size();
+    TopExp_Explorer ex0, ex1;
+    for (ex0.Init(face, TopAbs_WIRE); ex0.More(); ex0.Next()) {
+        const TopoDS_Wire& wire = TopoDS::Wire(ex0.Current());
+        for (ex1.Init(wire, TopAbs_EDGE); ex1.More(); ex1.Next()) {
+            const TopoDS_Edge& edge = TopoDS::Edge(ex1.Current());
+            
+            // skip degenerated edge
+            if (BRep_Tool::Degenerated(edge))
+                continue;
+            
+            // skip edge if it is a seam
+            if (BRep_Tool::IsClosed(edge, face))
+                continue;
+            
+            const OCCEdgeKey key(edge);
+            if (!this->edgeseen.Contains(key)) {
+                Handle(Poly_PolygonOnTriangulation) edgepoly = BRep_Tool::PolygonOnTriangulation(edge, triangulation, loc);
+                if (edgepoly.IsNull()) {
+                    continue;
+                }
+                this->edgeseen.Add(key);
+                this->edgekeys.push_back(key);
+                this->edgeranges.push_back(this->edgeindices.size());
+                
+                const TColStd_Array1OfInteger& edgeind = edgepoly->Nodes();
+                for (int i=edgeind.Lower();i <= edgeind.Upper();i++) {
+                    const unsigned int idx = (unsigned int)edgeind(i);
+                    this->edgeindices.push_back(vsize + idx - 1);
+                }
+                
+                this->edgeranges.push_back(this->edgeindices.size() - lastSize);
+                lastSize = this->edgeindices.size();
+            }
+        }
+    }
+    this->edgeTime += meshTimer() - start;
+}
+
+int OCCMesh::extractFaceMeshes(const std::vector<TopoDS_Face>& faces,
+                               const std::vector<int>& faceIds, int qualityNormals,
+                               int threads = 1, double *normalTime = NULL)
+{
+    const int nfaces = faces.size();
+    int failed = 0;
+    
+    threads = meshThreads(threads);
+    if (threads == 1 || nfaces < 2) {
+        this->reserveFaces(faces);
+        for (int i = 0; i < nfaces; i++) {
+            if (!this->extractFaceMesh(faces[i], faceIds[i], qualityNormals, normalTime))
+                failed++;
+        }
+        this->scratch.release();
+        return failed == 0;
+    }
+    
+    // extract every face into private buffers, the normal
+    // evaluation time is summed over all threads. Each thread
+    // lends its scratch arena to the part it is working on.
+    std::vector<OCCMesh> parts(nfaces);
+    std::vector<double> times(nfaces, 0.);
+    std::vector<OCCMeshScratch> arenas(threads);
+    #pragma omp parallel for num_threads(threads) schedule(dynamic)
+    for (int i = 0; i < nfaces; i++) {
+#ifdef _OPENMP
+        OCCMeshScratch& arena = arenas[omp_get_thread_num()];
+#else
+        OCCMeshScratch& arena = arenas[0];
+#endif
+        OCCMesh& part = parts[i];
+        part.interleave = this->interleave;
+        part.precise = this->precise;
+        part.origin = this->origin;
+        part.reserveFaces(std::vector<TopoDS_Face>(1, faces[i]));
+        part.scratch.swap(arena);
+        try {
+            part.appendFaceMesh(faces[i], faceIds[i], qualityNormals, &times[i]);
+        } catch(Standard_Failure &err) {
+            // the error message is global, set it once after the loop
+            #pragma omp atomic
+            failed++;
+        }
+        part.scratch.swap(arena);
+    }
+    if (normalTime != NULL) {
+        for (int i = 0; i < nfaces; i++)
+            *normalTime += times[i];
+    }
+    
+    // prefix sum of vertex and triangle offsets
+    std::vector<unsigned int> voffset(nfaces + 1), toffset(nfaces + 1);
+    voffset[0] = this->vertices.size();
+    toffset[0] = this->triangles.size();
+    for (int i = 0; i < nfaces; i++) {
+        voffset[i + 1] = voffset[i] + parts[i].vertices.size();
+        toffset[i + 1] = toffset[i] + parts[i].triangles.size();
+    }
+    
+    // exact sizes are known, resize once
+    this->vertices.resize(voffset[nfaces]);
+    this->normals.resize(voffset[nfaces]);
+    this->triangles.resize(toffset[nfaces]);
+    if (this->interleave)
+        this->interleaved.resize(voffset[nfaces]);
+    if (this->precise)
+        this->precisevertices.resize(voffset[nfaces]);
+    
+    #pragma omp parallel for num_threads(threads) schedule(dynamic)
+    for (int i = 0; i < nfaces; i++) {
+        const OCCMesh& part = parts[i];
+        const unsigned int vsize = voffset[i];
+        
+        std::copy(part.vertices.begin(), part.vertices.end(), this->vertices.begin() + vsize);
+        std::copy(part.normals.begin(), part.normals.end(), this->normals.begin() + vsize);
+        if (this->interleave)
+            std::copy(part.interleaved.begin(), part.interleaved.end(),
+                      this->interleaved.begin() + vsize);
+        if (this->precise)
+            std::copy(part.precisevertices.begin(), part.precisevertices.end(),
+                      this->precisevertices.begin() + vsize);
+        for (unsigned int j = 0; j < part.triangles.size(); j++) {
+            OCCStruct3I& tri = this->triangles[toffset[i] + j];
+            tri.i = vsize + part.triangles[j].i;
+            tri.j = vsize + part.triangles[j].j;
+            tri.k = vsize + part.triangles[j].k;
+        }
+    }
+    
+    for (int i = 0; i < nfaces; i++) {
+        const std::vector<int>& ranges = parts[i].faceranges;
+        for (unsigned int j = 0; j < ranges.size(); j += 5) {
+            this->faceranges.push_back(toffset[i] + ranges[j]);
+            this->faceranges.push_back(ranges[j + 1]);
+            this->faceranges.push_back(voffset[i] + ranges[j + 2]);
+            this->faceranges.push_back(ranges[j + 3]);
+            this->faceranges.push_back(ranges[j + 4]);
+        }
+    }
+    
+    // merge edges in face order, skipping edges already
+    // emitted by a previous face as the serial path does.
+    const double start = meshTimer();
+    for (int i = 0; i < nfaces; i++) {
+        const OCCMesh& part = parts[i];
+        this->edgeTime += part.edgeTime;
+        for (unsigned int j = 0; j < part.edgekeys.size(); j++) {
+            const OCCEdgeKey& key = part.edgekeys[j];
+            if (!this->edgeseen.Add(key))
+                continue;
+            this->edgekeys.push_back(key);
+            this->edgeranges.push_back(this->edgeindices.size());
+            
+            const int start = part.edgeranges[2*j];
+            const int count = part.edgeranges[2*j + 1];
+            for (int k = start; k < start + count; k++)
+                this->edgeindices.push_back(voffset[i] + part.edgeindices[k]);
+            
+            this->edgeranges.push_back(count);
+        }
+    }
+    this->edgeTime += meshTimer() - start;
+    
+    if (failed) {
+        setErrorMessage("Failed to extract face mesh");
+        return 0;
+    }
+    return 1;
+}
+
+int meshThreads(int threads)
+{
+#ifdef _OPENMP
+    if (threads <= 0)
+        return omp_get_max_threads();
+    return threads;
+#else
+    return 1;
+#endif
+}
+
+// Index of each face in the map of faces of shape
+// (TopExp::MapShapes order), -1 if not found.
+void faceIndices(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces,
+                 std::vector<int>& ids)
+{
+    TopTools_IndexedMapOfShape facemap;
+    TopExp::MapShapes(shape, TopAbs_FACE, facemap);
+    
+    ids.resize(faces.size());
+    for (unsigned int i = 0; i < faces.size(); i++)
+        ids[i] = facemap.FindIndex(faces[i]) - 1;
+}
+
+double meshTimer()
+{
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+// Triangulate faces of shape, return number of faces failed.
+int triangulateShape(BRepMesh_FastDiscret& MSH, const TopoDS_Shape& shape, int threads)
+{
+    threads = meshThreads(threads);
+    if (threads == 1) {
+        MSH.Perform(shape);
+        return 0;
+    }
+    
+    std::vector<TopoDS_Face> faces;
+    TopExp_Explorer exFace;
+    for (exFace.Init(shape, TopAbs_FACE); exFace.More(); exFace.Next())
+        faces.push_back(TopoDS::Face(exFace.Current()));
+    
+    return triangulateFaces(MSH, faces, threads);
+}
+
+// Triangulate faces, return number of faces failed.
+int triangulateFaces(BRepMesh_FastDiscret& MSH, const std::vector<TopoDS_Face>& faces,
+                     int threads)
+{
+    // Same steps as BRepMesh_FastDiscret::Perform. Edges are shared
+    // between faces and are discretized serially by Add, the interior
+    // of each face is then triangulated concurrently by Process.
+    const int nfaces = faces.size();
+    for (int i = 0; i < nfaces; i++)
+        MSH.Add(faces[i]);
+    
+    return processFaces(MSH, faces, threads);
+}
+
+// Triangulate interior of faces already added to MSH, return number
+// of faces failed.
+int processFaces(BRepMesh_FastDiscret& MSH, const std::vector<TopoDS_Face>& faces,
+                 int threads)
+{
+    const int nfaces = faces.size();
+    int failed = 0;
+    threads = meshThreads(threads);
+    if (threads == 1 || nfaces < 2) {
+        for (int i = 0; i < nfaces; i++) {
+            try {
+                MSH.Process(faces[i]);
+            } catch(Standard_Failure &err) {
+                failed++;
+            }
+        }
+        return failed;
+    }
+    
+    MeshReentrant reentrant;
+    
+    #pragma omp parallel for num_threads(threads) schedule(dynamic)
+    for (int i = 0; i < nfaces; i++) {
+        try {
+            MSH.Process(faces[i]);
+        } catch(Standard_Failure &err) {
+            #pragma omp atomic
+            failed++;
+        }
+    }
+    return failed;
+}
+
 void OCCMesh::optimize() {
     //printf("calcCacheEfficiency1 = %f\n", MeshOptimizer::calcCacheEfficiency(this));
     MeshOptimizer::optimizeIndexOrder(this);
     //printf("calcCacheEfficiency2 = %f\n\n", MeshOptimizer::calcCacheEfficiency(this));
 }
         
-void OptVertex::updateScore(int cacheIndex)
+static inline float vertexScore(const float *cacheScore, const float *valenceScore,
+                               int cachePos, unsigned int valence)
 {
-	if(faces.empty())
-	{	
-		score = 0;
-		return;
-	}
-	
+	if(valence == 0) return 0.0f;
+ 
 	// The constants used here are coming from the paper
-	if(cacheIndex < 0) score = 0;				// Not in cache
-	else if(cacheIndex < 3) score = 0.75f;	// Among three most recent vertices
-	else score = pow(1.0f - ((cacheIndex - 3) / MeshOptimizer::maxCacheSize), 1.5f);
-
-	score += 2.0f * pow((float)faces.size(), -0.5f);
+	float score = cachePos < 0 ? 0.0f : cacheScore[cachePos];
+	if(valence < MeshOptimizer::maxValence) score += valenceScore[valence];
+	else score += 2.0f * powf((float)valence, -0.5f);
+	return score;
 }
 
+// Live triangle with its score when pushed. Stale entries are
+// detected by comparing with the current score when popped.
+struct OptTriangle {
+	float score;
+	unsigned int index;
+	OptTriangle(float score, unsigned int index) : score(score), index(index) { ; }
+	bool operator<(const OptTriangle& other) const {
+		// best score first, lowest index among equal scores
+		if(score != other.score) return score < other.score;
+		return index > other.index;
+	}
+};
+
 void MeshOptimizer::optimizeIndexOrder(OCCMesh *mesh)
 {
 	// Implementation of Linear-Speed Vertex Cache Optimisation by Tom Forsyth
 	// (see http://home.comcast.net/~tom_forsyth/papers/fast_vert_cache_opt.html)
-	const size_t nvertices = mesh->vertices.size();
-	const size_t nindices = mesh->triangles.size();
-	if(nindices == 0) return;
-    
-    std::vector<OptVertex> verts(nvertices);
-	std::set<OptFace *> faces;
-	std::list<OptVertex *> cache;
-    
-    // Build vertex and triangle structures
-	for(unsigned int i = 0; i < nindices; ++i)
+	const unsigned int nvertices = mesh->vertices.size();
+	const unsigned int ntriangles = mesh->triangles.size();
+	if(ntriangles == 0) return;
+ 
+	// Precomputed score tables. The cache position score divides
+	// integers as the list based implementation did, which scores
+	// every position after the three most recent as one. Positions
+	// up to maxCacheSize + 2 are scored before the cache is trimmed.
+	float cacheScore[maxCacheSize + 3];
+	for(unsigned int i = 0; i < maxCacheSize + 3; ++i)
 	{
-		std::set<OptFace *>::iterator itr1 = faces.insert(faces.begin(), new OptFace());
-		OptFace *face = (*itr1);
-		
-        const OCCStruct3I *tri = &mesh->triangles[i];
-		face->verts[0] = &verts[tri->i];
-		face->verts[1] = &verts[tri->j];
-		face->verts[2] = &verts[tri->k];
-		face->verts[0]->faces.insert(face);
-		face->verts[1]->faces.insert(face);
-		face->verts[2]->faces.insert(face);
+		if(i < 3) cacheScore[i] = 0.75f;	// Among three most recent vertices
+		else cacheScore[i] = powf(1.0f - ((i - 3) / maxCacheSize), 1.5f);
 	}
-    for( unsigned int i = 0; i < nvertices; ++i )
+	float valenceScore[maxValence];
+	valenceScore[0] = 0.0f;
+	for(unsigned int i = 1; i < maxValence; ++i)
+		valenceScore[i] = 2.0f * powf((float)i, -0.5f);
+ 
+	// Vertex to triangle adjacency in compressed row storage. The live
+	// triangles of vertex v are adjacency[offsets[v] .. offsets[v] + valence[v]]
+	// in increasing order.
+	std::vector<unsigned int> offsets(nvertices + 1, 0);
+	for(unsigned int i = 0; i < ntriangles; ++i)
 	{
-		verts[i].index = i;
-		verts[i].updateScore( -1 );
+		const OCCStruct3I& tri = mesh->triangles[i];
+		offsets[tri.i + 1]++;
+		offsets[tri.j + 1]++;
+		offsets[tri.k + 1]++;
 	}
-    
-    // Main loop of algorithm
-	unsigned int curIndex = 0;
-	
-    while( !faces.empty() )
+	for(unsigned int i = 0; i < nvertices; ++i)
+		offsets[i + 1] += offsets[i];
+ 
+	std::vector<unsigned int> adjacency(3*ntriangles);
+	std::vector<unsigned int> valence(nvertices, 0);
+	for(unsigned int i = 0; i < ntriangles; ++i)
+	{
+		const OCCStruct3I& tri = mesh->triangles[i];
+		adjacency[offsets[tri.i] + valence[tri.i]++] = i;
+		adjacency[offsets[tri.j] + valence[tri.j]++] = i;
+		adjacency[offsets[tri.k] + valence[tri.k]++] = i;
+	}
+ 
+	std::vector<float> score(nvertices);
+	for(unsigned int i = 0; i < nvertices; ++i)
+		score[i] = vertexScore(cacheScore, valenceScore, -1, valence[i]);
+ 
+	// Live triangles by score. A vertex score only changes while the
+	// vertex is in the cache, so when the cache holds no live triangle
+	// the entries pushed last for each triangle are current.
+	std::priority_queue<OptTriangle> heap;
+	for(unsigned int i = 0; i < ntriangles; ++i)
 	{
-		OptFace *bestFace = 0x0;
+		const OCCStruct3I& tri = mesh->triangles[i];
+		heap.push(OptTriangle(score[tri.i] + score[tri.j] + score[tri.k], i));
+	}
+ 
+	std::vector<unsigned char> dead(ntriangles, 0);
+	std::vector<unsigned int> order(ntriangles);
+ 
+	unsigned int cache[maxCacheSize + 3];
+	unsigned int cacheSize = 0;
+ 
+	// Main loop of algorithm
+	for(unsigned int curIndex = 0; curIndex < ntriangles; ++curIndex)
+	{
+		// Try to find best scoring triangle in cache
+		int best = -1;
 		float bestScore = -1.0f;
-		
-		// Try to find best scoring face in cache
-		std::list<OptVertex *>::iterator itr1 = cache.begin();
-		while(itr1 != cache.end())
+		for(unsigned int i = 0; i < cacheSize; ++i)
 		{
-			std::set<OptFace *>::iterator itr2 = (*itr1)->faces.begin();
-			while(itr2 != (*itr1)->faces.end())
+			const unsigned int v = cache[i];
+			const unsigned int *adj = &adjacency[offsets[v]];
+			for(unsigned int j = 0; j < valence[v]; ++j)
 			{
-				if((*itr2)->getScore() > bestScore)
+				const OCCStruct3I& cand = mesh->triangles[adj[j]];
+				const float triScore = score[cand.i] + score[cand.j] + score[cand.k];
+				if(triScore > bestScore)
 				{
-					bestFace = *itr2;
-					bestScore = bestFace->getScore();
+					best = adj[j];
+					bestScore = triScore;
 				}
-				++itr2;
 			}
-			++itr1;
 		}
-        
-        // If that didn't work find it in the complete list of triangles
-		if(bestFace == 0x0)
+  
+		// If that didn't work take the best scoring live triangle
+		while(best < 0)
 		{
-			std::set<OptFace *>::iterator itr2 = faces.begin();
-			while(itr2 != faces.end())
+			const OptTriangle top = heap.top();
+			heap.pop();
+			const OCCStruct3I& cand = mesh->triangles[top.index];
+			if(!dead[top.index] && top.score == score[cand.i] + score[cand.j] + score[cand.k])
+				best = top.index;
+		}
+  
+		const OCCStruct3I tri = mesh->triangles[best];
+		order[curIndex] = best;
+		dead[best] = 1;
+  
+		const unsigned int verts[3] = {tri.i, tri.j, tri.k};
+		for(unsigned int i = 0; i < 3; ++i)
+		{
+			// Move vertex to head of cache
+			const unsigned int v = verts[i];
+			unsigned int pos = 0;
+			while(pos < cacheSize && cache[pos] != v) ++pos;
+			if(pos == cacheSize) ++cacheSize;
+			for(; pos > 0; --pos)
+				cache[pos] = cache[pos - 1];
+			cache[0] = v;
+   
+			// Remove triangle from live list of vertex
+			unsigned int *adj = &adjacency[offsets[v]];
+			for(unsigned int j = 0; j < valence[v]; ++j)
 			{
-				if((*itr2)->getScore() > bestScore)
+				if(adj[j] == (unsigned int)best)
 				{
-					bestFace = (*itr2);
-					bestScore = bestFace->getScore();
+					std::copy(adj + j + 1, adj + valence[v], adj + j);
+					--valence[v];
+					break;
 				}
-				++itr2;
 			}
 		}
-        
-        // Process vertices of best face
-        OCCStruct3I *tri = &mesh->triangles[curIndex++];
-        tri->i = bestFace->verts[0]->index;
-        tri->j = bestFace->verts[1]->index;
-        tri->k = bestFace->verts[2]->index;
-        
-		for( unsigned int i = 0; i < 3; ++i )
+  
+		// Update scores of vertices in cache
+		for(unsigned int i = 0; i < cacheSize; ++i)
 		{
-			// Move vertex to head of cache
-			itr1 = find(cache.begin(), cache.end(), bestFace->verts[i]);
-			if(itr1 != cache.end() ) cache.erase( itr1);
-			cache.push_front(bestFace->verts[i]);
-
-			// Remove face from vertex lists
-			bestFace->verts[i]->faces.erase(bestFace);
+			const unsigned int v = cache[i];
+			score[v] = vertexScore(cacheScore, valenceScore, i, valence[v]);
 		}
-        
-        // Remove best face
-		faces.erase(faces.find(bestFace));
-		delete bestFace;
-        
-        // Update scores of vertices in cache
-		unsigned int cacheIndex = 0;
-		for(itr1 = cache.begin(); itr1 != cache.end(); ++itr1)
+  
+		// Trim cache. Vertices pushed out keep their last score, push
+		// their live triangles with it.
+		for(unsigned int i = maxCacheSize; i < cacheSize; ++i)
 		{
-			(*itr1)->updateScore( cacheIndex++ );
+			const unsigned int v = cache[i];
+			const unsigned int *adj = &adjacency[offsets[v]];
+			for(unsigned int j = 0; j < valence[v]; ++j)
+			{
+				const OCCStruct3I& cand = mesh->triangles[adj[j]];
+				heap.push(OptTriangle(score[cand.i] + score[cand.j] + score[cand.k], adj[j]));
+			}
 		}
-
-		// Trim cache
-		for(unsigned int i = cache.size(); i > maxCacheSize; --i)
+		if(cacheSize > maxCacheSize) cacheSize = maxCacheSize;
+	}
+ 
+	// Keep triangles of each face together, in optimized order
+	// within the face, so the face ranges stay valid.
+	std::vector<int>& ranges = mesh->faceranges;
+	const unsigned int nranges = ranges.size() / 5;
+	if(nranges > 0)
+	{
+		std::vector<unsigned int> triRange(ntriangles, nranges);
+		for(unsigned int r = 0; r < nranges; ++r)
 		{
-			cache.pop_back();
+			for(int i = 0; i < ranges[5*r + 1]; ++i)
+				triRange[ranges[5*r] + i] = r;
 		}
-    }
-    
-    // Remap vertices to make access to them as linear as possible
-	std::map<unsigned int, unsigned int> mapping;
+  
+		std::vector<unsigned int> start(nranges + 2, 0);
+		for(unsigned int i = 0; i < ntriangles; ++i)
+			start[triRange[i] + 1]++;
+		for(unsigned int r = 0; r <= nranges; ++r)
+			start[r + 1] += start[r];
+  
+		std::vector<unsigned int> grouped(ntriangles);
+		for(unsigned int i = 0; i < ntriangles; ++i)
+			grouped[start[triRange[order[i]]]++] = order[i];
+		order.swap(grouped);
+	}
+ 
+	std::vector<OCCStruct3I> result(ntriangles);
+	for(unsigned int i = 0; i < ntriangles; ++i)
+		result[i] = mesh->triangles[order[i]];
+ 
+	// Remap vertices to make access to them as linear as possible.
+	// Vertices not used by any triangle are placed last.
+	std::vector<int> mapping(nvertices, -1);
+	std::vector<unsigned int> firstUse(ntriangles + 1);
 	unsigned int curVertex = 0;
-    
-    for(unsigned int i = 0; i < nindices; ++i)
+	for(unsigned int i = 0; i < ntriangles; ++i)
 	{
-        OCCStruct3I *tri = &mesh->triangles[i];
-        
-        std::map<unsigned int, unsigned int>::iterator itr1 = mapping.find(tri->i);
-		if(itr1 == mapping.end())
-		{
-			mapping[tri->i] = curVertex;
-			tri->i = curVertex++;
-		}
-		else
-		{
-			tri->i = itr1->second;
-		}
-        
-        std::map<unsigned int, unsigned int>::iterator itr2 = mapping.find(tri->j);
-		if(itr2 == mapping.end())
-		{
-			mapping[tri->j] = curVertex;
-			tri->j = curVertex++;
-		}
-		else
-		{
-			tri->j = itr2->second;
-		}
-        
-        std::map<unsigned int, unsigned int>::iterator itr3 = mapping.find(tri->k);
-		if(itr3 == mapping.end())
-		{
-			mapping[tri->k] = curVertex;
-			tri->k = curVertex++;
-		}
-		else
-		{
-			tri->k = itr3->second;
-		}
-    }
-    
-    std::vector<OCCStruct3f> oldVertices(mesh->vertices.begin(),  mesh->vertices.end());
-    std::vector<OCCStruct3f> oldNormals(mesh->normals.begin(), mesh->normals.end());    
-    for(std::map<unsigned int, unsigned int>::iterator itr1 = mapping.begin();
-        itr1 != mapping.end(); ++itr1 )
+		firstUse[i] = curVertex;
+		OCCStruct3I& tri = result[i];
+		if(mapping[tri.i] < 0) mapping[tri.i] = curVertex++;
+		if(mapping[tri.j] < 0) mapping[tri.j] = curVertex++;
+		if(mapping[tri.k] < 0) mapping[tri.k] = curVertex++;
+		tri.i = mapping[tri.i];
+		tri.j = mapping[tri.j];
+		tri.k = mapping[tri.k];
+	}
+	firstUse[ntriangles] = curVertex;
+ 
+	// The vertex range of a face holds the vertices first used by it
+	for(unsigned int r = 0, first = 0; r < nranges; ++r)
 	{
-		mesh->vertices[itr1->second] = oldVertices[itr1->first];
-		mesh->normals[itr1->second] = oldNormals[itr1->first];
+		const unsigned int count = ranges[5*r + 1];
+		ranges[5*r] = first;
+		ranges[5*r + 2] = firstUse[first];
+		ranges[5*r + 3] = firstUse[first + count] - firstUse[first];
+		first += count;
 	}
-    
-    for(unsigned int i = 0; i < mesh->edgeindices.size(); ++i)
+	for(unsigned int i = 0; i < nvertices; ++i)
 	{
-        mesh->edgeindices[i] = mapping[mesh->edgeindices[i]];
-    }
+		if(mapping[i] < 0) mapping[i] = curVertex++;
+	}
+ 
+	std::vector<OCCStruct3f> oldVertices(mesh->vertices.begin(),  mesh->vertices.end());
+	std::vector<OCCStruct3f> oldNormals(mesh->normals.begin(), mesh->normals.end());
+	for(unsigned int i = 0; i < nvertices; ++i)
+	{
+		mesh->vertices[mapping[i]] = oldVertices[i];
+		mesh->normals[mapping[i]] = oldNormals[i];
+	}
+ 
+	if(mesh->precise)
+	{
+		std::vector<OCCStruct3d> oldPrecise(mesh->precisevertices.begin(), mesh->precisevertices.end());
+		for(unsigned int i = 0; i < nvertices; ++i)
+			mesh->precisevertices[mapping[i]] = oldPrecise[i];
+	}
+ 
+	for(unsigned int i = 0; i < mesh->edgeindices.size(); ++i)
+	{
+		mesh->edgeindices[i] = mapping[mesh->edgeindices[i]];
+	}
+ 
+	mesh->triangles.swap(result);
+	mesh->updateInterleaved();
 }
 
 float MeshOptimizer::calcCacheEfficiency(OCCMesh *mesh,
@@ -4,13 +4,29 @@
 #define OCCMODEL_H
 #include "OCCIncludes.h"
 #include <sstream>
+#include <iomanip>
 #include <math.h>
+#include <stdlib.h>
+#if defined(_MSC_VER) && _MSC_VER < 1600
+// Visual Studio 2008 has no stdint.h
+typedef unsigned __int16 uint16_t;
+typedef unsigned __int32 uint32_t;
+typedef unsigned __int64 uint64_t;
+#else
+#include <stdint.h>
+#endif
+#include <time.h>
 #include <limits>
 #include <vector>
 #include <set>
 #include <map>
 #include <list>
+#include <queue>
+#include <iterator>
 #include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 typedef std::vector<float> FVec;
 typedef std::vector<double> DVec;
@@ -28,30 +44,32 @@ struct OCCStruct3f {
     float z;
 };
 
+// Interleaved vertex for GPU upload. Position and normal start on
+// 16 byte boundaries, w is 1 for the position and 0 for the normal.
+struct OCCVertexNormal {
+    float position[4];
+    float normal[4];
+};
+
 struct OCCStruct3I {
     unsigned int i;
     unsigned int j;
     unsigned int k;
 };
 
-struct OptFace;
-
-struct OptVertex
-{
-	unsigned int           index;  // Index in vertex array
-	float                  score;
-	std::set<OptFace *>    faces;  // Faces that are using this vertex
-	void updateScore(int cacheIndex);
-};
-
-struct OptFace
-{
-	OptVertex  *verts[3];
-	float getScore()  {return verts[0]->score + verts[1]->score + verts[2]->score;}
+// Approximate bytes held by the data of a shape. Data shared
+// between sub-shapes is counted once.
+struct OCCShapeMemory {
+    size_t triangulation;
+    size_t polygons;
+    size_t pcurves;
+    size_t geometry;
 };
 
 enum BoolOpType {BOOL_FUSE, BOOL_CUT, BOOL_COMMON};
 
+enum NormalMode {NORMALS_SMOOTH, NORMALS_SURFACE, NORMALS_PROJECTED};
+
 class OCCBase;
 class OCCEdge;
 class OCCSolid;
@@ -63,9 +81,110 @@ class OCCTesselation {
     public:
         std::vector<OCCStruct3f> vertices;
         std::vector<unsigned int> ranges;
+        // source index of each polyline
+        std::vector<int> ids;
         OCCTesselation() { ; }
 };
 
+// Identity of an edge shared between faces, the edge with forward
+// orientation. Keys are equal for the same TShape and an equal
+// location, the hash code only selects the bucket.
+struct OCCEdgeKey {
+    TopoDS_Shape edge;
+    OCCEdgeKey() { ; }
+    OCCEdgeKey(const TopoDS_Shape& shape) : edge(shape.Oriented(TopAbs_FORWARD)) { ; }
+};
+
+inline Standard_Integer HashCode(const OCCEdgeKey& key, const Standard_Integer upper)
+{
+    return key.edge.HashCode(upper);
+}
+
+inline Standard_Boolean IsEqual(const OCCEdgeKey& key1, const OCCEdgeKey& key2)
+{
+    return key1.edge.IsSame(key2.edge);
+}
+
+typedef NCollection_Map<OCCEdgeKey> OCCEdgeSet;
+
+// Mass properties of a closed mesh with unit density. The inertia
+// is taken about the centre of mass in the order Ixx, Iyy, Izz, Ixy,
+// Ixz, Iyz used by OCCSolid::inertia. The volume, centre and inertia
+// errors bound the difference to the exact solid from the deflection
+// of the mesh, the area error is an estimate.
+struct OCCMassProperties {
+    double volume;
+    double area;
+    OCCStruct3d centre;
+    double inertia[6];
+    double volumeError;
+    double areaError;
+    double centreError;
+    double inertiaError;
+};
+
+// Mesh generation settings shared by Face and Solid meshing. The
+// stage timings in seconds are updated by every mesh operation.
+class OCCMeshParams {
+    public:
+        double deflection;
+        bool relative;
+        double angle;
+        bool relativeToEdge;
+        int qualityNormals;
+        int threads;
+        bool weld;
+        double creaseAngle;
+        bool interleaved;
+        bool originRelative;
+        bool preciseVertices;
+        bool releaseTriangulation;
+        double timeBBox;
+        double timeDiscretize;
+        double timeExtract;
+        double timeNormals;
+        double timeEdges;
+        // faces triangulated by the last operation
+        int facesMeshed;
+        OCCMeshParams() {
+            deflection = .01;
+            relative = true;
+            angle = .25;
+            relativeToEdge = true;
+            qualityNormals = NORMALS_SURFACE;
+            threads = 1;
+            weld = false;
+            creaseAngle = M_PI/6.;
+            interleaved = false;
+            originRelative = false;
+            preciseVertices = false;
+            releaseTriangulation = false;
+            resetTimings();
+        }
+        void resetTimings() {
+            timeBBox = timeDiscretize = timeExtract = timeNormals = timeEdges = 0.;
+            facesMeshed = 0;
+        }
+        double absoluteDeflection(const Bnd_Box& box) const;
+        double chordalDeflection(const Bnd_Box& box) const;
+};
+
+class OCCMeshSink;
+
+// Reusable work arrays of extractFaceMesh. Nodes, normal accumulators
+// and triangle normals are kept in SoA layout for the batched kernels.
+class OCCMeshScratch {
+    public:
+        std::vector<double> x, y, z;
+        std::vector<double> nx, ny, nz;
+        std::vector<double> tx, ty, tz;
+        std::vector<int> tris;
+        std::vector<unsigned char> valid;
+        void resize(int nnodes, int ntriangles);
+        void swap(OCCMeshScratch& other);
+        void release();
+};
+
 class OCCMesh {
     public:
         std::vector<OCCStruct3f> normals;
@@ -73,16 +192,255 @@ class OCCMesh {
         std::vector<OCCStruct3I> triangles;
         std::vector<unsigned int> edgeindices;
         std::vector<int> edgeranges;
-        std::vector<int> edgehash;
-        OCCMesh() { ; }
-        int extractFaceMesh(const TopoDS_Face& face, bool qualityNormals);
+        std::vector<int> faceranges;
+        std::vector<OCCEdgeKey> edgekeys;
+        OCCEdgeSet edgeseen;
+        std::vector<OCCVertexNormal> interleaved;
+        // float vertices are relative to origin, precisevertices
+        // optionally hold the absolute position in double precision.
+        OCCStruct3d origin;
+        std::vector<OCCStruct3d> precisevertices;
+        OCCMeshScratch scratch;
+        bool interleave;
+        bool precise;
+        size_t weldsaved;
+        // absolute chordal and angular deflection, zero when unknown
+        double deflection;
+        double angle;
+        // time spent extracting edge polylines, summed over threads
+        double edgeTime;
+        OCCMesh() {
+            weldsaved = 0;
+            edgeTime = 0.;
+            interleave = false;
+            precise = false;
+            origin.x = origin.y = origin.z = 0.;
+            deflection = angle = 0.;
+        }
+        void setNormal(int index, const OCCStruct3f& norm) {
+            this->normals[index] = norm;
+            if (this->interleave) {
+                float *dst = this->interleaved[index].normal;
+                dst[0] = norm.x; dst[1] = norm.y; dst[2] = norm.z; dst[3] = 0.f;
+            }
+        }
+        void configure(const OCCMeshParams& params, const Bnd_Box& box);
+        void reserve(size_t nvertices, size_t ntriangles);
+        void reserveFaces(const std::vector<TopoDS_Face>& faces);
+        void appendInterleaved(unsigned int first, unsigned int count);
+        void updateInterleaved();
+        void appendPrecise(const Handle(Poly_Triangulation)& triangulation,
+                           const TopLoc_Location& loc);
+        void appendFaceMesh(const TopoDS_Face& face, int faceId, int qualityNormals,
+                            double *normalTime);
+        int extractFaceMesh(const TopoDS_Face& face, int faceId, int qualityNormals,
+                            double *normalTime);
+        void extractFaceEdges(const TopoDS_Face& face,
+                              const Handle(Poly_Triangulation)& triangulation,
+                              const TopLoc_Location& loc, int vsize);
+        int extractFaceMeshes(const std::vector<TopoDS_Face>& faces,
+                              const std::vector<int>& faceIds, int qualityNormals,
+                              int threads, double *normalTime);
+        int streamFaceMeshes(BRepMesh_FastDiscret& MSH, const std::vector<TopoDS_Face>& faces,
+                             const std::vector<int>& faceIds, OCCMeshSink *sink,
+                             OCCMeshParams& params, unsigned int chunkSize);
+        int weld(const std::vector<TopoDS_Face>& faces, double creaseAngle);
+        int decimate(unsigned int target, double maxError);
         void optimize();
+        int massProperties(OCCMassProperties& props, int threads);
+        int samplePoints(int n, unsigned int seed, int threads, double *points,
+                         double *normals, int *faces);
+        size_t memoryUsage();
 };
 
+// Compact encoding of a mesh. Positions are quantized to 16 bit
+// against the bounding box, normals are octahedral encoded with 8 or
+// 16 bit per component and indices use 16 bit below 65537 vertices.
+class OCCMeshEncoding {
+    public:
+        double origin[3];
+        double scale[3];
+        OCCStruct3d meshorigin;
+        double meshdeflection;
+        double meshangle;
+        int normalBits;
+        int indexSize;
+        std::vector<uint16_t> positions;
+        std::vector<unsigned char> normals;
+        std::vector<unsigned char> triangles;
+        std::vector<unsigned char> edgeindices;
+        std::vector<int> edgeranges;
+        std::vector<int> faceranges;
+        double maxPositionError;
+        double meanPositionError;
+        double maxNormalError;
+        double meanNormalError;
+        OCCMeshEncoding();
+        int encode(const OCCMesh *mesh, int normalBits, int threads);
+        OCCMesh *decode(int threads);
+        size_t numVertices() { return positions.size()/3; }
+        size_t memoryUsage();
+};
+
+// Node of OCCMeshBVH. Inner nodes have count 0, the left child
+// follows the node and first is the index of the right child. Leaf
+// nodes hold triangles order[first, first + count).
+struct OCCBVHNode {
+    float lo[3];
+    float hi[3];
+    int first;
+    int count;
+};
+
+// Bounding volume hierarchy over the triangles of a mesh built with
+// the surface area heuristic. Holds a copy of the mesh geometry and
+// answers batched ray, closest point and box queries in absolute
+// coordinates.
+class OCCMeshBVH {
+    public:
+        std::vector<OCCBVHNode> nodes;
+        std::vector<int> order;
+        std::vector<int> faces;
+        std::vector<OCCStruct3f> vertices;
+        std::vector<OCCStruct3I> triangles;
+        OCCStruct3d origin;
+        int depth;
+        OCCMeshBVH() { depth = 0; origin.x = origin.y = origin.z = 0.; }
+        int build(const OCCMesh *mesh, int leafSize);
+        int intersect(const double *origins, const double *directions, int nrays,
+                      double tmax, int threads, int *tris, int *faceIds, double *distances);
+        int closestPoint(const double *points, int npoints, double maxDistance, int threads,
+                         int *tris, int *faceIds, double *closest, double *distances);
+        int overlap(const double *lo, const double *hi, std::vector<int>& tris);
+        size_t numTriangles() { return triangles.size(); }
+        size_t memoryUsage();
+};
+
+// Receiver of streamed mesh chunks. The chunk buffers are reused
+// between calls and only valid during emit. Return 0 to stop.
+class OCCMeshSink {
+    public:
+        virtual ~OCCMeshSink() { ; }
+        virtual int emit(int firstFace, int numFaces, OCCMesh *chunk) = 0;
+};
+
+typedef int (*OCCMeshCallback)(void *data, int firstFace, int numFaces, OCCMesh *chunk);
+
+class OCCMeshCallbackSink : public OCCMeshSink {
+    public:
+        OCCMeshCallback callback;
+        void *data;
+        OCCMeshCallbackSink(OCCMeshCallback callback, void *data) {
+            this->callback = callback;
+            this->data = data;
+        }
+        int emit(int firstFace, int numFaces, OCCMesh *chunk) {
+            return callback(data, firstFace, numFaces, chunk);
+        }
+};
+
+// In-process mesh cache keyed on a digest of the shape BREP and the
+// meshing parameters. Disabled until a byte budget is set.
+class OCCMeshCache {
+    public:
+        size_t budget;
+        size_t used;
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long evictions;
+        static OCCMeshCache& instance();
+        bool isEnabled() { return budget > 0; }
+        std::string shapeDigest(const TopoDS_Shape& shape);
+        std::string makeKey(const char *tag, const std::string& digest,
+                            const OCCMeshParams& params);
+        OCCMesh *lookup(const std::string& key);
+        void insert(const std::string& key, OCCMesh *mesh);
+        void setBudget(size_t bytes);
+        void clear();
+        size_t size() { return entries.size(); }
+    private:
+        typedef std::pair<std::string, OCCMesh *> Entry;
+        typedef std::list<Entry> EntryList;
+        EntryList entries;
+        std::map<std::string, EntryList::iterator> index;
+#ifdef _OPENMP
+        omp_lock_t mutex;
+#endif
+        OCCMeshCache();
+        ~OCCMeshCache();
+        void lock();
+        void unlock();
+        void evict(size_t limit);
+};
+
+enum MeshSIMDLevel {MESH_SIMD_SCALAR, MESH_SIMD_SSE2, MESH_SIMD_AVX2};
+int meshSIMDLevel();
+int setMeshSIMDLevel(int level);
+void meshTransformNodes(const double *x, const double *y, const double *z,
+                        int n, const double *m, OCCStruct3f *out);
+void meshFaceNormals(const double *x, const double *y, const double *z,
+                     const int *tris, int ntris, double *nx, double *ny,
+                     double *nz, unsigned char *valid);
+void meshNormalize(const double *x, const double *y, const double *z,
+                   int n, OCCStruct3f *out);
+void meshQuantize(const double *x, const double *y, const double *z, int n,
+                  const double *origin, const double *inv, double range,
+                  unsigned int *qx, unsigned int *qy, unsigned int *qz);
+void meshDequantize(const unsigned int *qx, const unsigned int *qy,
+                    const unsigned int *qz, int n, const double *origin,
+                    const double *scale, OCCStruct3f *out);
+void meshOctEncode(const double *x, const double *y, const double *z, int n,
+                   double range, unsigned int *qu, unsigned int *qv);
+void meshOctDecode(const unsigned int *qu, const unsigned int *qv, int n,
+                   double range, OCCStruct3f *out);
+
+// Reentrant mode of the OCC memory manager is process wide and slows
+// down all allocations. Enable it while faces or levels of detail are
+// meshed concurrently and restore the mode set by MMGT_REENTRANT at
+// startup afterwards.
+class MeshReentrant {
+    public:
+        MeshReentrant() { Standard::SetReentrant(Standard_True); }
+        ~MeshReentrant() {
+            const char *env = getenv("MMGT_REENTRANT");
+            Standard::SetReentrant(env != NULL && atoi(env) != 0);
+        }
+};
+
+int meshThreads(int threads);
+void faceIndices(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces,
+                 std::vector<int>& ids);
+double meshTimer();
+int triangulateShape(BRepMesh_FastDiscret& MSH, const TopoDS_Shape& shape, int threads);
+int triangulateFaces(BRepMesh_FastDiscret& MSH, const std::vector<TopoDS_Face>& faces,
+                     int threads);
+int processFaces(BRepMesh_FastDiscret& MSH, const std::vector<TopoDS_Face>& faces,
+                 int threads);
+OCCMesh *createShapeMesh(const char *tag, const TopoDS_Shape& shape,
+                         const std::vector<TopoDS_Face>& faces, OCCMeshParams& params,
+                         bool inshape);
+int createShapeMeshLOD(const char *tag, const TopoDS_Shape& shape,
+                       const std::vector<TopoDS_Face>& faces,
+                       const std::vector<double>& deflections, OCCMeshParams& params,
+                       bool inshape, std::vector<OCCMesh *>& meshes);
+OCCMesh *updateShapeMesh(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces,
+                         const std::vector<int>& history, OCCMesh *previous,
+                         OCCMeshParams& params);
+int streamShapeMesh(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces,
+                    OCCMeshSink *sink, OCCMeshParams& params, bool inshape,
+                    unsigned int chunkSize);
+int tesselateEdge(const TopoDS_Edge& edge, double angular, double curvature,
+                  bool copyGeometry, std::vector<OCCStruct3f>& vertices);
+OCCTesselation *tesselateShapes(const std::vector<OCCBase *>& shapes, double angular,
+                                double curvature, int threads);
+OCCTesselation *tesselateShapeEdges(const TopoDS_Shape& shape, double angular,
+                                    double curvature, int threads);
+
 class MeshOptimizer
 {
 public:
 	static const unsigned int maxCacheSize = 16;
+	static const unsigned int maxValence = 32;
 	static float calcCacheEfficiency(OCCMesh *mesh,
                                      const unsigned  int cacheSize = maxCacheSize);
 	static void optimizeIndexOrder(OCCMesh *mesh);
@@ -122,6 +480,8 @@ class OCCBase {
         bool fixShape();
         int toString(std::string *output);
         int fromString(std::string input);
+        void clearMesh();
+        OCCShapeMemory memoryUsage();
         virtual bool canSetShape(const TopoDS_Shape&) { return true; }
         virtual const TopoDS_Shape& getShape() { return TopoDS_Shape(); }
         virtual void setShape(TopoDS_Shape shape) { ; }
@@ -190,6 +550,11 @@ class OCCEdge : public OCCBase {
         OCCEdge *copy(bool deepCopy);
         int numVertices();
         OCCTesselation *tesselate(double factor, double angle);
+        DVec parameterRange();
+        int evaluate(const double *params, int n, int derivatives, int threads,
+                     double *points, double *d1, double *d2);
+        int sampleUniform(int n, int derivatives, int threads, double *params,
+                          double *points, double *d1, double *d2);
         int createLine(OCCVertex *start, OCCVertex *end);
         int createArc(OCCVertex *start, OCCVertex *end, OCCStruct3d center);
         int createArc3P(OCCVertex *start, OCCVertex *end, OCCStruct3d pnt);
@@ -301,7 +666,16 @@ class OCCFace : public OCCBase {
         int sweep(OCCWire *spine, std::vector<OCCBase *> profiles, int cornerMode);
         int loft(std::vector<OCCBase *> profiles, bool ruled, double tolerance);
         int boolean(OCCSolid *tool, BoolOpType op);
-        OCCMesh *createMesh(double defle, double angle, bool qualityNormals);
+        OCCMesh *createMesh(OCCMeshParams& params);
+        OCCTesselation *tesselateEdges(double angular, double curvature, int threads);
+        int createMeshLOD(const std::vector<double>& factors, OCCMeshParams& params,
+                          std::vector<OCCMesh *>& meshes);
+        int createMeshStream(OCCMeshSink *sink, OCCMeshParams& params, unsigned int chunkSize);
+        DVec parameterRange();
+        int evaluateUV(const double *uv, int n, int threads, double *points,
+                       double *normals, double *curvatures, unsigned char *inside);
+        int evaluateGrid(int nu, int nv, int threads, double *uv, double *points,
+                         double *normals, double *curvatures, unsigned char *inside);
         bool canSetShape(const TopoDS_Shape& shape) {
             return shape.ShapeType() == TopAbs_FACE || shape.ShapeType() == TopAbs_SHELL;
         }
@@ -335,6 +709,9 @@ class OCCFaceIterator {
 class OCCSolid : public OCCBase {
     public:
         TopoDS_Shape solid;
+        // index of each face in the shape before the last fillet, chamfer
+        // or boolean operation, -1 for new or modified faces.
+        std::vector<int> faceHistory;
         OCCSolid() { ; }
         OCCSolid *copy(bool deepCopy);
         int numSolids();
@@ -344,7 +721,13 @@ class OCCSolid : public OCCBase {
         double volume();
         DVec inertia();
         OCCStruct3d centreOfMass();
-        OCCMesh *createMesh(double defle, double angle, bool qualityNormals);
+        OCCMesh *createMesh(OCCMeshParams& params);
+        OCCTesselation *tesselateEdges(double angular, double curvature, int threads);
+        int createMeshLOD(const std::vector<double>& factors, OCCMeshParams& params,
+                          std::vector<OCCMesh *>& meshes);
+        int createMeshStream(OCCMeshSink *sink, OCCMeshParams& params, unsigned int chunkSize);
+        OCCMesh *updateMesh(OCCMesh *previous, OCCMeshParams& params);
+        void setHistory(const TopTools_IndexedMapOfShape& faces, const std::vector<bool>& touched);
         int addSolids(std::vector<OCCSolid *> solids);
         int createSphere(OCCStruct3d center, double radius);
         int createCylinder(OCCStruct3d p1, OCCStruct3d p2, double radius);
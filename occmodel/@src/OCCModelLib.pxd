@@ -28,6 +28,26 @@ cdef extern from "OCCModel.h":
         float y
         float z
         
+    cdef struct c_OCCVertexNormal "OCCVertexNormal":
+        float position[4]
+        float normal[4]
+    
+    cdef struct c_OCCShapeMemory "OCCShapeMemory":
+        size_t triangulation
+        size_t polygons
+        size_t pcurves
+        size_t geometry
+    
+    cdef struct c_OCCMassProperties "OCCMassProperties":
+        double volume
+        double area
+        c_OCCStruct3d centre
+        double inertia[6]
+        double volumeError
+        double areaError
+        double centreError
+        double inertiaError
+    
     cdef struct c_OCCStruct3I "OCCStruct3I":
         unsigned int i
         unsigned int j
@@ -36,18 +56,111 @@ cdef extern from "OCCModel.h":
     cdef cppclass c_OCCTesselation "OCCTesselation":
         vector[c_OCCStruct3f] vertices
         vector[int] ranges
+        vector[int] ids
         c_OCCTesselation()
         
+    cdef cppclass c_OCCMeshParams "OCCMeshParams":
+        double deflection
+        bint relative
+        double angle
+        bint relativeToEdge
+        int qualityNormals
+        int threads
+        bint weld
+        double creaseAngle
+        bint interleaved
+        bint originRelative
+        bint preciseVertices
+        bint releaseTriangulation
+        double timeBBox
+        double timeDiscretize
+        double timeExtract
+        double timeNormals
+        double timeEdges
+        int facesMeshed
+        c_OCCMeshParams()
+    
     cdef cppclass c_OCCMesh "OCCMesh":
         vector[c_OCCStruct3f] vertices
         vector[c_OCCStruct3f] normals
         vector[c_OCCStruct3I] triangles
         vector[unsigned int] edgeindices
         vector[int] edgeranges
-        vector[int] edgehash
+        vector[int] faceranges
+        vector[c_OCCVertexNormal] interleaved
+        c_OCCStruct3d origin
+        vector[c_OCCStruct3d] precisevertices
+        size_t weldsaved
+        double deflection
+        double angle
         
         c_OCCMesh()
+        c_OCCMesh(c_OCCMesh&)
+        int decimate(unsigned int target, double maxError)
         void optimize()
+        int massProperties(c_OCCMassProperties& props, int threads)
+        int samplePoints(int n, unsigned int seed, int threads, double *points,
+                         double *normals, int *faces)
+        size_t memoryUsage()
+    
+    cdef cppclass c_OCCMeshEncoding "OCCMeshEncoding":
+        double origin[3]
+        double scale[3]
+        int normalBits
+        int indexSize
+        vector[unsigned short] positions
+        vector[unsigned char] normals
+        vector[unsigned char] triangles
+        vector[unsigned char] edgeindices
+        vector[int] edgeranges
+        vector[int] faceranges
+        double maxPositionError
+        double meanPositionError
+        double maxNormalError
+        double meanNormalError
+        
+        c_OCCMeshEncoding()
+        int encode(c_OCCMesh *mesh, int normalBits, int threads)
+        c_OCCMesh *decode(int threads)
+        size_t numVertices()
+        size_t memoryUsage()
+    
+    cdef cppclass c_OCCMeshBVH "OCCMeshBVH":
+        int depth
+        
+        c_OCCMeshBVH()
+        int build(c_OCCMesh *mesh, int leafSize)
+        int intersect(double *origins, double *directions, int nrays, double tmax,
+                      int threads, int *tris, int *faceIds, double *distances)
+        int closestPoint(double *points, int npoints, double maxDistance, int threads,
+                         int *tris, int *faceIds, double *closest, double *distances)
+        int overlap(double *lo, double *hi, vector[int]& tris)
+        size_t numTriangles()
+        size_t memoryUsage()
+    
+    cdef cppclass c_OCCMeshCache "OCCMeshCache":
+        size_t budget
+        size_t used
+        unsigned long hits
+        unsigned long misses
+        unsigned long evictions
+        @staticmethod
+        c_OCCMeshCache& instance()
+        void setBudget(size_t bytes)
+        void clear()
+        size_t size()
+    
+    int meshSIMDLevel()
+    int setMeshSIMDLevel(int level)
+    
+    ctypedef int (*c_OCCMeshCallback "OCCMeshCallback")(void *data, int firstFace,
+                                                        int numFaces, c_OCCMesh *chunk)
+    
+    cdef cppclass c_OCCMeshSink "OCCMeshSink":
+        int emit(int firstFace, int numFaces, c_OCCMesh *chunk)
+    
+    cdef cppclass c_OCCMeshCallbackSink "OCCMeshCallbackSink"(c_OCCMeshSink):
+        c_OCCMeshCallbackSink(c_OCCMeshCallback callback, void *data)
     
     cdef enum c_BoolOpType "BoolOpType":
         BOOL_FUSE
@@ -79,6 +192,11 @@ cdef extern from "OCCModel.h":
         int findPlane(c_OCCStruct3d *origin, c_OCCStruct3d *normal, double tolerance)
         int toString(string *output)
         int fromString(string input)
+        void clearMesh()
+        c_OCCShapeMemory memoryUsage()
+    
+    c_OCCTesselation *tesselateShapes(vector[c_OCCBase *] shapes, double angular,
+                                      double curvature, int threads)
         
     cdef cppclass c_OCCVertex "OCCVertex":
         c_OCCVertex(double x, double y, double z)
@@ -100,6 +218,11 @@ cdef extern from "OCCModel.h":
         c_OCCEdge *copy(bint deepCopy)
         int numVertices()
         c_OCCTesselation *tesselate(double factor, double angle)
+        vector[double] parameterRange()
+        int evaluate(double *params, int n, int derivatives, int threads,
+                     double *points, double *d1, double *d2)
+        int sampleUniform(int n, int derivatives, int threads, double *params,
+                          double *points, double *d1, double *d2)
         int createLine(c_OCCVertex *v1, c_OCCVertex *v2)
         int createArc(c_OCCVertex *start, c_OCCVertex *end, c_OCCStruct3d center)
         int createArc3P(c_OCCVertex *start, c_OCCVertex *end, c_OCCStruct3d pnt)
@@ -159,7 +282,17 @@ cdef extern from "OCCModel.h":
         int sweep(c_OCCWire *spine, vector[c_OCCBase *] profiles, int cornerMode)
         int loft(vector[c_OCCBase *] profiles, bint ruled, double tolerance)
         int boolean(c_OCCSolid *tool, c_BoolOpType op)
-        c_OCCMesh *createMesh(double factor, double angle, bint qualityNormals)
+        c_OCCMesh *createMesh(c_OCCMeshParams& params)
+        c_OCCTesselation *tesselateEdges(double angular, double curvature, int threads)
+        int createMeshLOD(vector[double] factors, c_OCCMeshParams& params,
+                          vector[c_OCCMesh *]& meshes)
+        int createMeshStream(c_OCCMeshSink *sink, c_OCCMeshParams& params,
+                             unsigned int chunkSize)
+        vector[double] parameterRange()
+        int evaluateUV(double *uv, int n, int threads, double *points,
+                       double *normals, double *curvatures, unsigned char *inside)
+        int evaluateGrid(int nu, int nv, int threads, double *uv, double *points,
+                         double *normals, double *curvatures, unsigned char *inside)
     
     cdef cppclass c_OCCFaceIterator "OCCFaceIterator":
         c_OCCFaceIterator(c_OCCBase *arg)
@@ -176,7 +309,13 @@ cdef extern from "OCCModel.h":
         double volume()
         vector[double] inertia()
         c_OCCStruct3d centreOfMass()
-        c_OCCMesh *createMesh(double factor, double angle, bint qualityNormals)
+        c_OCCMesh *createMesh(c_OCCMeshParams& params)
+        c_OCCTesselation *tesselateEdges(double angular, double curvature, int threads)
+        int createMeshLOD(vector[double] factors, c_OCCMeshParams& params,
+                          vector[c_OCCMesh *]& meshes)
+        int createMeshStream(c_OCCMeshSink *sink, c_OCCMeshParams& params,
+                             unsigned int chunkSize)
+        c_OCCMesh *updateMesh(c_OCCMesh *previous, c_OCCMeshParams& params)
         int addSolids(vector[c_OCCSolid *] solids)
         int createSphere(c_OCCStruct3d center, double radius)
         int createCylinder(c_OCCStruct3d p1, c_OCCStruct3d p2, double radius)
@@ -202,6 +341,9 @@ cdef extern from "OCCModel.h":
         void reset()
         c_OCCSolid *next()
 
+cdef extern from "OCCModel.h" namespace "MeshOptimizer":
+    float calcCacheEfficiency(c_OCCMesh *mesh, unsigned int cacheSize)
+    
 cdef extern from "OCCModel.h" namespace "OCCTools":
     int writeBREP(char *filename, vector[c_OCCBase *] shapes)
     int writeSTEP(char *filename, vector[c_OCCBase *] shapes)
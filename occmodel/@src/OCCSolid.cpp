@@ -122,57 +122,89 @@ int OCCSolid::numFaces()
     return anIndices.Extent();
 }
 
-OCCMesh *OCCSolid::createMesh(double factor, double angle, bool qualityNormals = true)
+static void solidFaces(const TopoDS_Shape& shape, std::vector<TopoDS_Face>& faces)
 {
-    OCCMesh *mesh = new OCCMesh();
-    const TopoDS_Shape& shape = this->getShape();
-    
-    try {
-        Bnd_Box aBox;
-        BRepBndLib::Add(shape, aBox);
-        
-        Standard_Real aXmin, aYmin, aZmin;
-        Standard_Real aXmax, aYmax, aZmax;
-        aBox.Get(aXmin, aYmin, aZmin, aXmax, aYmax, aZmax);
-        
-        Standard_Real maxd = fabs(aXmax - aXmin);
-        maxd = std::max(maxd, fabs(aYmax - aYmin));
-        maxd = std::max(maxd, fabs(aZmax - aZmin));
-        
-        BRepMesh_FastDiscret MSH(factor*maxd, angle, aBox, Standard_True, Standard_True, 
-                                 Standard_True, Standard_True);
-        
-        MSH.Perform(shape);
-        
-        if (shape.ShapeType() == TopAbs_COMPSOLID || shape.ShapeType() == TopAbs_COMPOUND) {
-            TopExp_Explorer exSolid, exFace;
-            for (exSolid.Init(shape, TopAbs_SOLID); exSolid.More(); exSolid.Next()) {
-                const TopoDS_Solid& solid = static_cast<const TopoDS_Solid &>(exSolid.Current());
-                for (exFace.Init(solid, TopAbs_FACE); exFace.More(); exFace.Next()) {
-                    const TopoDS_Face& face = static_cast<const TopoDS_Face &>(exFace.Current());
-                    if (face.IsNull()) continue;
-                    mesh->extractFaceMesh(face, qualityNormals);
-                }
-            }
-        }  else {
-            TopExp_Explorer exFace;
-            for (exFace.Init(shape, TopAbs_FACE); exFace.More(); exFace.Next()) {
+    if (shape.ShapeType() == TopAbs_COMPSOLID || shape.ShapeType() == TopAbs_COMPOUND) {
+        TopExp_Explorer exSolid, exFace;
+        for (exSolid.Init(shape, TopAbs_SOLID); exSolid.More(); exSolid.Next()) {
+            const TopoDS_Solid& solid = static_cast<const TopoDS_Solid &>(exSolid.Current());
+            for (exFace.Init(solid, TopAbs_FACE); exFace.More(); exFace.Next()) {
                 const TopoDS_Face& face = static_cast<const TopoDS_Face &>(exFace.Current());
                 if (face.IsNull()) continue;
-                mesh->extractFaceMesh(face, qualityNormals);
+                faces.push_back(face);
             }
         }
-    } catch(Standard_Failure &err) {
-        Handle_Standard_Failure e = Standard_Failure::Caught();
-        const Standard_CString msg = e->GetMessageString();
-        if (msg != NULL && strlen(msg) > 1) {
-            setErrorMessage(msg);
-        } else {
-            setErrorMessage("Failed to mesh object");
+    }  else {
+        TopExp_Explorer exFace;
+        for (exFace.Init(shape, TopAbs_FACE); exFace.More(); exFace.Next()) {
+            const TopoDS_Face& face = static_cast<const TopoDS_Face &>(exFace.Current());
+            if (face.IsNull()) continue;
+            faces.push_back(face);
         }
-        return NULL;
     }
-    return mesh;
+}
+
+OCCMesh *OCCSolid::createMesh(OCCMeshParams& params)
+{
+    std::vector<TopoDS_Face> faces;
+    solidFaces(this->getShape(), faces);
+    return createShapeMesh("solid", this->getShape(), faces, params, true);
+}
+
+OCCTesselation *OCCSolid::tesselateEdges(double angular, double curvature, int threads)
+{
+    return tesselateShapeEdges(this->getShape(), angular, curvature, threads);
+}
+
+int OCCSolid::createMeshLOD(const std::vector<double>& factors, OCCMeshParams& params,
+                            std::vector<OCCMesh *>& meshes)
+{
+    std::vector<TopoDS_Face> faces;
+    solidFaces(this->getShape(), faces);
+    return createShapeMeshLOD("solid", this->getShape(), faces, factors, params, true, meshes);
+}
+
+int OCCSolid::createMeshStream(OCCMeshSink *sink, OCCMeshParams& params,
+                               unsigned int chunkSize = 0)
+{
+    std::vector<TopoDS_Face> faces;
+    solidFaces(this->getShape(), faces);
+    return streamShapeMesh(this->getShape(), faces, sink, params, true, chunkSize);
+}
+
+OCCMesh *OCCSolid::updateMesh(OCCMesh *previous, OCCMeshParams& params)
+{
+    std::vector<TopoDS_Face> faces;
+    solidFaces(this->getShape(), faces);
+    return updateShapeMesh(this->getShape(), faces, faceHistory, previous, params);
+}
+
+// Map faces of shape and mark faces modified or deleted by builder
+static void touchedFaces(const TopoDS_Shape& shape, BRepBuilderAPI_MakeShape& builder,
+                         TopTools_IndexedMapOfShape& faces, std::vector<bool>& touched)
+{
+    TopExp::MapShapes(shape, TopAbs_FACE, faces);
+    touched.assign(faces.Extent(), false);
+    for (int i = 1; i <= faces.Extent(); i++) {
+        const TopoDS_Shape& face = faces(i);
+        if (builder.IsDeleted(face) || !builder.Modified(face).IsEmpty())
+            touched[i - 1] = true;
+    }
+}
+
+void OCCSolid::setHistory(const TopTools_IndexedMapOfShape& faces,
+                          const std::vector<bool>& touched)
+{
+    TopTools_IndexedMapOfShape facemap;
+    TopExp::MapShapes(this->getShape(), TopAbs_FACE, facemap);
+    
+    faceHistory.assign(facemap.Extent(), -1);
+    for (int i = 1; i <= facemap.Extent(); i++) {
+        const int index = faces.FindIndex(facemap(i));
+        if (index > 0 && !touched[index - 1] &&
+            faces(index).Orientation() == facemap(i).Orientation())
+            faceHistory[i - 1] = index - 1;
+    }
 }
 
 int OCCSolid::addSolids(std::vector<OCCSolid *> solids)
@@ -803,6 +835,8 @@ int OCCSolid::loft(std::vector<OCCBase *> profiles, bool ruled, double tolerance
 int OCCSolid::boolean(OCCSolid *tool, BoolOpType op) {
     try {
         TopoDS_Shape shape;
+        TopTools_IndexedMapOfShape oldFaces;
+        std::vector<bool> touched;
         switch (op) {
             case BOOL_FUSE:
             {
@@ -810,6 +844,7 @@ int OCCSolid::boolean(OCCSolid *tool, BoolOpType op) {
                 if (!FU.IsDone())
                     Standard_ConstructionError::Raise("operation failed");
                 shape = FU.Shape();
+                touchedFaces(this->getShape(), FU, oldFaces, touched);
                 break;
             }
             case BOOL_CUT:
@@ -818,6 +853,7 @@ int OCCSolid::boolean(OCCSolid *tool, BoolOpType op) {
                 if (!CU.IsDone())
                     Standard_ConstructionError::Raise("operation failed");
                 shape = CU.Shape();
+                touchedFaces(this->getShape(), CU, oldFaces, touched);
                 break;
             }
             case BOOL_COMMON:
@@ -826,6 +862,7 @@ int OCCSolid::boolean(OCCSolid *tool, BoolOpType op) {
                 if (!CO.IsDone())
                     Standard_ConstructionError::Raise("operation failed");
                 shape = CO.Shape();
+                touchedFaces(this->getShape(), CO, oldFaces, touched);
                 break;
             }
             default:
@@ -848,6 +885,8 @@ int OCCSolid::boolean(OCCSolid *tool, BoolOpType op) {
         if (!this->fixShape())
             StdFail_NotDone::Raise("Shapes not valid");
         
+        this->setHistory(oldFaces, touched);
+        
     } catch(Standard_Failure &err) {
         Handle_Standard_Failure e = Standard_Failure::Caught();
         const Standard_CString msg = e->GetMessageString();
@@ -908,12 +947,18 @@ int OCCSolid::chamfer(std::vector<OCCEdge *> edges, std::vector<double> distance
         if (tmp.IsNull())
             StdFail_NotDone::Raise("Chamfer operaton return Null shape");
         
+        TopTools_IndexedMapOfShape oldFaces;
+        std::vector<bool> touched;
+        touchedFaces(solid, CF, oldFaces, touched);
+        
         this->setShape(tmp);
         
         // possible fix shape
         if (!this->fixShape())
             StdFail_NotDone::Raise("Shapes not valid");
         
+        this->setHistory(oldFaces, touched);
+        
     } catch(Standard_Failure &err) {
         Handle_Standard_Failure e = Standard_Failure::Caught();
         const Standard_CString msg = e->GetMessageString();
@@ -975,12 +1020,18 @@ int OCCSolid::fillet(std::vector<OCCEdge *> edges, std::vector<double> radius) {
         if (tmp.IsNull())
             StdFail_NotDone::Raise("Fillet operation resulted in Null shape");
         
+        TopTools_IndexedMapOfShape oldFaces;
+        std::vector<bool> touched;
+        touchedFaces(solid, fill, oldFaces, touched);
+        
         this->setShape(tmp);
         
         // possible fix shape
         if (!this->fixShape())
             StdFail_NotDone::Raise("Shapes not valid");
         
+        this->setHistory(oldFaces, touched);
+        
     } catch(Standard_Failure &err) {
         Handle_Standard_Failure e = Standard_Failure::Caught();
         const Standard_CString msg = e->GetMessageString();
@@ -1114,6 +1165,8 @@ OCCFace *OCCSolid::section(OCCStruct3d pnt, OCCStruct3d nor)
 
 void OCCSolid::setShape(TopoDS_Shape shape)
 {
+    faceHistory.clear();
+    
     TopAbs_ShapeEnum type = shape.ShapeType();
     if (type == TopAbs_SOLID || type == TopAbs_COMPSOLID) {
         solid = shape;
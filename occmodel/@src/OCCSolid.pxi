@@ -84,24 +84,200 @@ cdef class Solid(Base):
         return occ.numFaces()
         
     cpdef Mesh createMesh(self, double factor = .01, double angle = .25,
-                          bint qualityNormals = False):
+                          int qualityNormals = NORMALS_SMOOTH, int threads = 1,
+                          bint weld = False, double creaseAngle = M_PI/6.,
+                          Mesher mesher = None):
         '''
         Create triangle mesh of solid.
         
         :param factor: deflection from true position
         :param angle: max angle
-        :param qualityNormals: create normals by evaluating surface parameters
+        :param qualityNormals: create normals by evaluating surface parameters.
+                               True or NORMALS_SURFACE evaluates the surface at
+                               the (u,v) nodes of the triangulation.
+                               NORMALS_PROJECTED recover (u,v) by projecting
+                               each node onto the surface (slow).
+        :param threads: number of threads used to triangulate and extract
+                        faces. Zero use all available cores. The result is
+                        identical to the single threaded mesh.
+        :param weld: merge coincident vertices along shared edges into a
+                     single indexed vertex.
+        :param creaseAngle: vertices are only merged where the normals
+                            differ less than this angle, which keeps
+                            sharp edges sharp.
+        :param mesher: Mesher object replacing all other arguments.
+                       Stage timings are stored in the mesher.
         '''
         cdef c_OCCSolid *occ = <c_OCCSolid *>self.thisptr
-        cdef c_OCCMesh *mesh = occ.createMesh(factor, angle, qualityNormals)
+        cdef c_OCCMesh *mesh
         cdef Mesh ret = Mesh.__new__(Mesh, None)
         
+        if mesher is None:
+            mesher = Mesher(factor, True, angle, True, qualityNormals, threads,
+                            weld, creaseAngle)
+        
+        mesh = occ.createMesh(mesher.params)
+        
         if mesh == NULL:
             raise OCCError(errorMessage)
         
         ret.thisptr = mesh
         ret.setArrays()
         return ret
+    
+    cpdef Mesh updateMesh(self, Mesh previous, double factor = .01, double angle = .25,
+                          int qualityNormals = NORMALS_SMOOTH, int threads = 1,
+                          bint weld = False, double creaseAngle = M_PI/6.,
+                          Mesher mesher = None):
+        '''
+        Update mesh of solid after a fillet, chamfer or boolean
+        operation.
+        
+        Faces left untouched by the last operation are copied from
+        the previous mesh, which must be the mesh of the solid before
+        the operation. Only new and modified faces are triangulated.
+        Without a recorded operation the whole solid is meshed.
+        
+        Untouched faces are copied also when their triangulation was
+        released. Edges shared with triangulated faces are then
+        discretized again and may not match node by node. With weld
+        such faces are triangulated again.
+        
+        :param previous: mesh of solid before the operation
+        
+        Other arguments as for createMesh. Use the same settings as
+        the previous mesh for a consistent result.
+        '''
+        cdef c_OCCSolid *occ = <c_OCCSolid *>self.thisptr
+        cdef c_OCCMesh *mesh
+        cdef Mesh ret = Mesh.__new__(Mesh, None)
+        
+        if mesher is None:
+            mesher = Mesher(factor, True, angle, True, qualityNormals, threads,
+                            weld, creaseAngle)
+        
+        mesh = occ.updateMesh(<c_OCCMesh *>previous.thisptr, mesher.params)
+        if mesh == NULL:
+            raise OCCError(errorMessage)
+        
+        ret.thisptr = mesh
+        ret.setArrays()
+        return ret
+    
+    cpdef Tesselation tesselateEdges(self, double angular = .1, double curvature = .1,
+                                     int threads = 1):
+        '''
+        Tesselate the edges of the solid as wireframe.
+        
+        Each edge is discretized once, also when shared between
+        faces. Seam and degenerated edges are skipped. ranges hold a
+        (start, count) pair for each edge and ids the index of the
+        edge among the unique edges of the solid.
+        
+        :param angular: max angular deflection
+        :param curvature: max curvature deflection
+        :param threads: number of threads, zero use all cores
+        '''
+        cdef c_OCCSolid *occ = <c_OCCSolid *>self.thisptr
+        cdef c_OCCTesselation *tess = occ.tesselateEdges(angular, curvature, threads)
+        cdef Tesselation ret = Tesselation.__new__(Tesselation, None)
+        
+        if tess == NULL:
+            raise OCCError(errorMessage)
+        
+        ret.thisptr = tess
+        ret.setArrays()
+        return ret
+    
+    cpdef list createMeshLOD(self, factors, double angle = .25,
+                             int qualityNormals = NORMALS_SMOOTH, int threads = 1,
+                             bint weld = False, double creaseAngle = M_PI/6.,
+                             Mesher mesher = None):
+        '''
+        Create triangle meshes of solid at several levels of detail.
+        
+        Return a list with one mesh for each deflection factor, in the
+        given order. Each level is equal to a createMesh call with that
+        factor, the bounding box, face indices and cache digest are
+        computed once for all levels. Several levels are meshed on
+        copies of the solid, one thread per level up to threads, and
+        the triangulation of the solid is left untouched.
+        
+        :param factors: sequence of deflection factors
+        
+        Other arguments as for createMesh. The deflection of the
+        mesher is replaced by each factor.
+        '''
+        cdef c_OCCSolid *occ = <c_OCCSolid *>self.thisptr
+        cdef vector[double] cfactors
+        cdef vector[c_OCCMesh *] meshes
+        cdef Mesh mesh
+        cdef list ret = []
+        cdef size_t i
+        
+        for factor in factors:
+            cfactors.push_back(factor)
+        
+        if mesher is None:
+            mesher = Mesher(.01, True, angle, True, qualityNormals, threads,
+                            weld, creaseAngle)
+        
+        if not occ.createMeshLOD(cfactors, mesher.params, meshes):
+            raise OCCError(errorMessage)
+        
+        for i in range(meshes.size()):
+            mesh = Mesh.__new__(Mesh, None)
+            mesh.thisptr = meshes[i]
+            mesh.setArrays()
+            ret.append(mesh)
+        
+        return ret
+    
+    cpdef createMeshStream(self, callback, double factor = .01, double angle = .25,
+                           int qualityNormals = NORMALS_SMOOTH, unsigned int chunkSize = 0,
+                           Mesher mesher = None):
+        '''
+        Stream triangle mesh of solid in chunks to a callable.
+        
+        The callable is called as callback(firstFace, numFaces, mesh)
+        for each chunk. Chunks contains whole faces and are emitted
+        when they hold at least chunkSize triangles, or for every face
+        when chunkSize is zero. Each call gets a new mesh, which may be
+        kept after the call.
+        Return False or raise an exception to stop the stream.
+        
+        Edges shared with previous chunks are not repeated. Peak memory
+        is bounded by the chunk size as face triangulations are released
+        after extraction, unless a mesher without releaseTriangulation
+        is given. With several threads faces are triangulated in
+        batches of four per thread.
+        
+        :param callback: callable receiving mesh chunks
+        :param factor: deflection from true position
+        :param angle: max angle
+        :param qualityNormals: normal mode, see createMesh
+        :param chunkSize: minimum number of triangles in each chunk
+        :param mesher: Mesher object replacing factor, angle and
+                       qualityNormals. Weld is not supported.
+        '''
+        cdef c_OCCSolid *occ = <c_OCCSolid *>self.thisptr
+        cdef MeshStream stream = MeshStream(callback)
+        cdef c_OCCMeshCallbackSink *sink
+        cdef int ret
+        
+        if mesher is None:
+            mesher = Mesher(factor, True, angle, True, qualityNormals,
+                            releaseTriangulation = True)
+        
+        sink = new c_OCCMeshCallbackSink(<c_OCCMeshCallback>meshStreamCallback,
+                                         <void *>stream)
+        try:
+            ret = occ.createMeshStream(sink, mesher.params, chunkSize)
+        finally:
+            del sink
+        
+        stream.check(ret)
+        return self
         
     cpdef createSolid(self, faces, double tolerance = 0.):
         '''
@@ -381,7 +557,49 @@ cdef class Solid(Base):
         cdef c_OCCSolid *occ = <c_OCCSolid *>self.thisptr
         cdef c_OCCStruct3d cg = occ.centreOfMass()
         return cg.x,cg.y,cg.z
+    
+    cpdef dict meshMassProperties(self, double factor = .01, double angle = .25,
+                                  int threads = 1, Mesher mesher = None):
+        '''
+        Return approximate mass properties computed from a mesh of
+        the solid with error bounds, see Mesh.massProperties. Much
+        faster than the exact properties for complex solids.
+        
+        The default mesher does not scale the deflection relative to
+        edges, which keeps the bounds tight on large solids.
+        
+        :param factor: deflection from true position
+        :param angle: max angle
+        :param threads: number of threads, zero use all cores
+        :param mesher: Mesher object replacing factor and angle
+        '''
+        cdef Mesh mesh
         
+        if mesher is None:
+            mesher = Mesher(factor, True, angle, False, NORMALS_SMOOTH, threads)
+        
+        mesh = self.createMesh(mesher = mesher)
+        return mesh.massProperties(threads)
+        
+    cpdef dict samplePoints(self, int n, unsigned int seed = 0, double factor = .01,
+                            double angle = .25, int threads = 1, Mesher mesher = None):
+        '''
+        Sample n points uniformly by area over the surface of the
+        solid, see Mesh.samplePoints. The solid is meshed first and
+        the samples lie on the triangulation, within the mesh
+        deflection from the true surface.
+        
+        :param n: number of samples
+        :param seed: random seed
+        :param factor: deflection from true position
+        :param angle: max angle
+        :param threads: number of threads, zero use all cores
+        :param mesher: Mesher object replacing factor and angle
+        '''
+        cdef Mesh mesh = self.createMesh(factor, angle, NORMALS_SMOOTH, threads,
+                                         mesher = mesher)
+        return mesh.samplePoints(n, seed, threads)
+    
     cpdef extrude(self, obj, p1, p2):
         '''
         Create solid by extruding edge, wire or face from
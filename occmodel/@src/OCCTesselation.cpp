@@ -0,0 +1,167 @@
+// Copyright 2012 by Runar Tenfjord, Tenko as.
+// See LICENSE.txt for details on conditions.
+#include "OCCModel.h"
+
+// Discretize the 3d curve of edge with GCPnts_TangentialDeflection and
+// append the points to vertices. Return number of points added, zero
+// for degenerated edges and edges without a 3d curve.
+int tesselateEdge(const TopoDS_Edge& edge, double angular, double curvature,
+                  bool copyGeometry, std::vector<OCCStruct3f>& vertices)
+{
+    if (BRep_Tool::Degenerated(edge))
+        return 0;
+    
+    Standard_Real start, end;
+    TopLoc_Location loc;
+    Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, loc, start, end);
+    if (curve.IsNull())
+        return 0;
+    
+    // B-spline curves cache the last evaluated span, evaluate a copy
+    // when the curve may be shared with other threads.
+    if (copyGeometry)
+        curve = Handle(Geom_Curve)::DownCast(curve->Copy());
+    
+    const gp_Trsf& location = loc.Transformation();
+    GeomAdaptor_Curve aCurve(curve);
+    GCPnts_TangentialDeflection TD(aCurve, start, end, angular, curvature);
+    
+    const int npoints = TD.NbPoints();
+    OCCStruct3f vert;
+    for (Standard_Integer i = 1; i <= npoints; i++) {
+        gp_Pnt pnt = TD.Value(i).Transformed(location);
+        vert.x = (float)pnt.X();
+        vert.y = (float)pnt.Y();
+        vert.z = (float)pnt.Z();
+        vertices.push_back(vert);
+    }
+    return npoints;
+}
+
+// Discretize edges in parallel, each into its own buffer, and copy
+// them to their offset in one vertex array. ranges get a (start,
+// count) pair for each edge and ids the given id.
+static OCCTesselation *tesselateEdges(const std::vector<TopoDS_Edge>& edges,
+                                      const std::vector<int>& ids, double angular,
+                                      double curvature, int threads)
+{
+    threads = meshThreads(threads);
+    const int nedges = (int)edges.size();
+    std::vector<std::vector<OCCStruct3f> > points(nedges);
+    int failed = 0;
+    
+    #pragma omp parallel for num_threads(threads) schedule(dynamic)
+    for (int i = 0; i < nedges; i++) {
+        try {
+            tesselateEdge(edges[i], angular, curvature, threads > 1, points[i]);
+        } catch(Standard_Failure &err) {
+            #pragma omp atomic
+            failed++;
+        }
+    }
+    
+    if (failed) {
+        setErrorMessage("Failed to tesselate edge");
+        return NULL;
+    }
+    
+    OCCTesselation *ret = new OCCTesselation();
+    ret->ranges.resize(2*nedges);
+    ret->ids = ids;
+    unsigned int size = 0;
+    for (int i = 0; i < nedges; i++) {
+        ret->ranges[2*i] = size;
+        ret->ranges[2*i + 1] = points[i].size();
+        size += points[i].size();
+    }
+    ret->vertices.resize(size);
+    
+    #pragma omp parallel for num_threads(threads)
+    for (int i = 0; i < nedges; i++) {
+        if (!points[i].empty())
+            std::copy(points[i].begin(), points[i].end(),
+                      ret->vertices.begin() + ret->ranges[2*i]);
+    }
+    return ret;
+}
+
+// Tesselate edges and wires into one vertex array, ids hold the index
+// of the shape of each edge. Wire edges are in connected order.
+OCCTesselation *tesselateShapes(const std::vector<OCCBase *>& shapes, double angular,
+                                double curvature, int threads)
+{
+    try {
+        std::vector<TopoDS_Edge> edges;
+        std::vector<int> owner;
+        for (unsigned int i = 0; i < shapes.size(); i++) {
+            const TopoDS_Shape& shape = shapes[i]->getShape();
+            if (shape.IsNull())
+                continue;
+            
+            if (shape.ShapeType() == TopAbs_WIRE) {
+                BRepTools_WireExplorer exWire;
+                for (exWire.Init(TopoDS::Wire(shape)); exWire.More(); exWire.Next()) {
+                    edges.push_back(exWire.Current());
+                    owner.push_back(i);
+                }
+            } else {
+                TopExp_Explorer ex;
+                for (ex.Init(shape, TopAbs_EDGE); ex.More(); ex.Next()) {
+                    edges.push_back(TopoDS::Edge(ex.Current()));
+                    owner.push_back(i);
+                }
+            }
+        }
+        return tesselateEdges(edges, owner, angular, curvature, threads);
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to tesselate edges");
+        }
+        return NULL;
+    }
+}
+
+// Tesselate each unique edge of shape once. ids hold the index of the
+// edge in the map of unique edges of shape, in explorer order.
+// Degenerated edges and seam edges of a face are skipped like the
+// edge polylines of the mesh.
+OCCTesselation *tesselateShapeEdges(const TopoDS_Shape& shape, double angular,
+                                    double curvature, int threads)
+{
+    try {
+        TopTools_IndexedDataMapOfShapeListOfShape edgeFaces;
+        TopExp::MapShapesAndAncestors(shape, TopAbs_EDGE, TopAbs_FACE, edgeFaces);
+        
+        std::vector<TopoDS_Edge> edges;
+        std::vector<int> ids;
+        for (int i = 1; i <= edgeFaces.Extent(); i++) {
+            const TopoDS_Edge& edge = TopoDS::Edge(edgeFaces.FindKey(i));
+            if (BRep_Tool::Degenerated(edge))
+                continue;
+            
+            bool seam = false;
+            TopTools_ListIteratorOfListOfShape it(edgeFaces.FindFromIndex(i));
+            for (; it.More() && !seam; it.Next())
+                seam = BRep_Tool::IsClosed(edge, TopoDS::Face(it.Value()));
+            if (seam)
+                continue;
+            
+            edges.push_back(edge);
+            ids.push_back(i - 1);
+        }
+        return tesselateEdges(edges, ids, angular, curvature, threads);
+    } catch(Standard_Failure &err) {
+        Handle_Standard_Failure e = Standard_Failure::Caught();
+        const Standard_CString msg = e->GetMessageString();
+        if (msg != NULL && strlen(msg) > 1) {
+            setErrorMessage(msg);
+        } else {
+            setErrorMessage("Failed to tesselate edges");
+        }
+        return NULL;
+    }
+}
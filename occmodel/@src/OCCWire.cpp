@@ -374,43 +374,9 @@ int OCCWire::chamfer(std::vector<OCCVertex *> vertices, std::vector<double> dist
 
 OCCTesselation *OCCWire::tesselate(double angular, double curvature)
 {
-    OCCTesselation *ret = new OCCTesselation();
-    try {
-        Standard_Real start, end;
-        OCCStruct3f dtmp;
-        
-        // explore wire edges in connected order
-        int lastSize = 0;
-        BRepTools_WireExplorer exWire;
-        
-        for (exWire.Init(this->getWire()); exWire.More(); exWire.Next()) {
-            const TopoDS_Edge& edge = exWire.Current();
-            TopLoc_Location loc = edge.Location();
-            gp_Trsf location = loc.Transformation();
-            
-            const Handle(Geom_Curve)& curve = BRep_Tool::Curve(edge, start, end);
-            const GeomAdaptor_Curve& aCurve(curve);
-            
-            GCPnts_TangentialDeflection TD(aCurve, start, end, angular, curvature);
-            
-            ret->ranges.push_back(ret->vertices.size());
-            
-            for (Standard_Integer i = 1; i <= TD.NbPoints(); i++)
-            {
-                gp_Pnt pnt = TD.Value(i).Transformed(location);
-                dtmp.x = (float)pnt.X();
-                dtmp.y = (float)pnt.Y();
-                dtmp.z = (float)pnt.Z();
-                ret->vertices.push_back(dtmp);
-            }
-            
-            ret->ranges.push_back(ret->vertices.size() - lastSize);
-            lastSize = ret->vertices.size();
-        }
-    } catch(Standard_Failure &err) {
-        return NULL;
-    }
-    return ret;
+    // edges in connected order
+    std::vector<OCCBase *> shapes(1, this);
+    return tesselateShapes(shapes, angular, curvature, 1);
 }
 
 double OCCWire::length() {
@@ -0,0 +1,346 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#
+# This file is part of occmodel - See LICENSE.txt
+#
+# Mesh benchmarks. Not part of the test suite, run directly:
+#
+#   python bench_Mesh.py
+#
+import sys
+import time
+import random
+from array import array
+from math import pi
+
+from occmodel import Edge, Face, Solid, Mesher, MeshBVH, MeshCache, EdgeIterator, tesselateMany
+from occmodel import NORMALS_SMOOTH, NORMALS_SURFACE, NORMALS_PROJECTED
+
+def sphere():
+    return Solid().createSphere((0.,0.,0.),.5)
+
+def torus():
+    return Solid().createTorus((0.,0.,0.),(0.,0.,1.), 1., 2.)
+
+def loft():
+    e1 = Edge().createCircle(center=(0.,0.,0.),normal=(0.,0.,1.),radius = 1.)
+    e2 = Edge().createEllipse(center=(0.,0.,5.),normal=(0.,0.,1.), rMajor = 2.0, rMinor=1.0)
+    e3 = Edge().createCircle(center=(0.,0.,10.),normal=(0.,0.,1.),radius = 1.0)
+    return Solid().loft((e1,e2,e3), False)
+
+FIXTURES = (('sphere', sphere), ('torus', torus), ('loft', loft))
+
+def timeit(func, repeat = 5):
+    best = 1e99
+    for i in range(repeat):
+        start = time.time()
+        func()
+        best = min(best, time.time() - start)
+    return best
+
+def bench_normals(factor = .001):
+    print('quality normals, factor = %g' % factor)
+    print('%-8s %10s %10s %10s %10s %8s' % ('model', 'triangles', 'smooth',
+                                           'projected', 'surface', 'speedup'))
+    for name, fixture in FIXTURES:
+        solid = fixture()
+        ntri = solid.createMesh(factor).ntriangles()
+        res = []
+        for mode in (NORMALS_SMOOTH, NORMALS_PROJECTED, NORMALS_SURFACE):
+            res.append(timeit(lambda: solid.createMesh(factor, qualityNormals = mode)))
+        
+        # compare cost of the normal evaluation only
+        speedup = (res[1] - res[0]) / max(res[2] - res[0], 1e-9)
+        print('%-8s %10d %9.4fs %9.4fs %9.4fs %7.1fx' % ((name, ntri) + tuple(res) + (speedup,)))
+    
+def bench_optimize(factors = (.001, .0002)):
+    print('vertex cache optimization')
+    print('%-8s %10s %10s %10s %10s %12s' % ('model', 'triangles', 'ATVR',
+                                           'optimized', 'time', 'triangles/s'))
+    for name, fixture in FIXTURES:
+        solid = fixture()
+        for factor in factors:
+            mesh = solid.createMesh(factor)
+            before = mesh.cacheEfficiency()
+            start = time.time()
+            mesh.optimize()
+            dt = max(time.time() - start, 1e-9)
+            args = name, mesh.ntriangles(), before, mesh.cacheEfficiency(), dt, mesh.ntriangles() / dt
+            print('%-8s %10d %10.3f %10.3f %9.4fs %12.0f' % args)
+    
+def bench_decimate(factor = .0002, ratios = (.5, .1, .02)):
+    print('quadric decimation, factor = %g' % factor)
+    print('%-8s %10s %10s %10s %12s' % ('model', 'triangles', 'result',
+                                      'time', 'triangles/s'))
+    for name, fixture in FIXTURES:
+        solid = fixture()
+        for ratio in ratios:
+            mesh = solid.createMesh(factor)
+            ntriangles = mesh.ntriangles()
+            start = time.time()
+            mesh.decimate(int(ratio*ntriangles))
+            dt = max(time.time() - start, 1e-9)
+            args = name, ntriangles, mesh.ntriangles(), dt, ntriangles / dt
+            print('%-8s %10d %10d %9.4fs %12.0f' % args)
+    
+def bench_encode(factor = .0002):
+    print('compact encoding, factor = %g, scalar / simd kernels' % factor)
+    print('%-8s %10s %6s %10s %10s %10s %10s %10s %10s %10s' % ('model', 'triangles', 'bits',
+                                                               'ratio', 'encode', 'simd',
+                                                               'decode', 'simd',
+                                                               'pos err', 'nor err'))
+    best = Mesher.setSIMDLevel()
+    for name, fixture in FIXTURES:
+        mesh = fixture().createMesh(factor)
+        for normalBits in (8, 16):
+            res = []
+            for level in (0, best):
+                Mesher.setSIMDLevel(level)
+                enc = mesh.encode(normalBits, 1)
+                res.append(timeit(lambda: mesh.encode(normalBits, 1), 3))
+                res.append(timeit(lambda: enc.decode(1), 3))
+            errors = enc.errors
+            args = (name, mesh.ntriangles(), normalBits,
+                    float(mesh.memoryUsage()) / enc.memoryUsage(), res[0], res[2],
+                    res[1], res[3], errors['maxPosition'], errors['maxNormal'])
+            print('%-8s %10d %6d %9.2fx %9.4fs %9.4fs %9.4fs %9.4fs %10.2e %10.2e' % args)
+    Mesher.setSIMDLevel(best)
+    
+def boxes(count):
+    solids = []
+    for i in range(count):
+        x = 2.*(i % 32)
+        y = 2.*(i // 32)
+        solids.append(Solid().createBox((x,y,0.),(x + 1.,y + 1.,1.)))
+    return Solid().addSolids(solids)
+    
+def bench_edges(counts = (16, 64, 256, 1024)):
+    # boxes triangulate to two triangles per face and share every edge,
+    # only the edge extraction stage reported by the mesher is timed.
+    print('edge extraction')
+    print('%-8s %10s %10s %10s %12s' % ('faces', 'edges', 'triangles',
+                                        'time', 'us/face'))
+    for count in counts:
+        solid = boxes(count)
+        mesher = Mesher()
+        mesh = solid.createMesh(mesher = mesher)
+        def edges():
+            solid.createMesh(mesher = mesher)
+            return mesher.timings['edges']
+        dt = min(edges() for i in range(5))
+        nfaces = solid.numFaces()
+        args = nfaces, mesh.nedgeRanges() // 2, mesh.ntriangles(), dt, 1e6*dt / nfaces
+        print('%-8d %10d %10d %9.4fs %12.2f' % args)
+    
+def plate(count):
+    solid = Solid().createBox((0.,0.,0.),(2.*count,2.*count,1.))
+    holes = []
+    for i in range(count):
+        for j in range(count):
+            x, y = 2.*i + 1., 2.*j + 1.
+            holes.append(Solid().createCylinder((x,y,-1.),(x,y,2.),.5))
+    return solid.cut(Solid().addSolids(holes))
+    
+def bench_update(count = 40, factor = .0005):
+    print('incremental mesh update after fillet')
+    print('%-8s %10s %10s %10s %8s' % ('faces', 'triangles', 'full',
+                                      'update', 'speedup'))
+    solid = plate(count)
+    previous = solid.createMesh(factor)
+    
+    # fillet longest outer edge of plate
+    edge = max(EdgeIterator(solid), key = lambda edge: edge.length())
+    solid.fillet(.2, edge)
+    
+    update = timeit(lambda: solid.updateMesh(previous, factor), 3)
+    full = timeit(lambda: solid.createMesh(factor), 3)
+    mesh = solid.updateMesh(previous, factor)
+    args = solid.numFaces(), mesh.ntriangles(), full, update, full / max(update, 1e-9)
+    print('%-8d %10d %9.4fs %9.4fs %7.1fx' % args)
+    
+def bench_lod(factors = (.0005, .002, .01, .05), threads = 0):
+    print('level of detail, factors = %s, threads = %d' % (factors, threads))
+    print('%-8s %10s %10s %10s %8s' % ('model', 'triangles', 'single',
+                                      'lod', 'speedup'))
+    MeshCache.setBudget(0)
+    for name, fixture in FIXTURES:
+        solid = fixture()
+        # createMesh keeps the triangulation and would reuse it for the
+        # coarser factors, clear it to mesh every level from scratch
+        single = timeit(lambda: [(solid.clearMesh(), solid.createMesh(factor, threads = threads))
+                                 for factor in factors], 3)
+        lod = timeit(lambda: solid.createMeshLOD(factors, threads = threads), 3)
+        ntriangles = sum(mesh.ntriangles() for mesh in solid.createMeshLOD(factors))
+        args = name, ntriangles, single, lod, single / max(lod, 1e-9)
+        print('%-8s %10d %9.4fs %9.4fs %7.1fx' % args)
+    
+def bench_simd(factor = .0002):
+    print('extraction kernels, factor = %g' % factor)
+    print('%-8s %10s %10s %10s %10s' % ('model', 'triangles', 'scalar',
+                                      'simd', 'speedup'))
+    best = Mesher.setSIMDLevel()
+    for name, fixture in FIXTURES:
+        solid = fixture()
+        mesher = Mesher(deflection = factor)
+        ntri = solid.createMesh(mesher = mesher).ntriangles()
+        res = []
+        # triangulation is reused, only extraction time is measured
+        for level in (0, best):
+            Mesher.setSIMDLevel(level)
+            def extract():
+                solid.createMesh(mesher = mesher)
+                return mesher.timings['extract']
+            res.append(min(extract() for i in range(5)))
+        args = name, ntri, res[0], res[1], res[0] / max(res[1], 1e-9)
+        print('%-8s %10d %9.4fs %9.4fs %7.1fx' % args)
+    Mesher.setSIMDLevel(best)
+    
+def bench_bvh(factor = .0002, nrays = 100000):
+    print('bvh ray casting, %d rays' % nrays)
+    print('%-8s %10s %10s %12s %12s' % ('model', 'triangles', 'build',
+                                      'rays/s', 'rays/s (mt)'))
+    rnd = random.Random(1)
+    for name, fixture in FIXTURES:
+        solid = fixture()
+        mesh = solid.createMesh(factor)
+        build = timeit(lambda: MeshBVH(mesh), 3)
+        bvh = MeshBVH(mesh)
+        
+        # rays from a sphere around the model towards its center
+        box = solid.boundingBox()
+        center = [.5*(box.min[i] + box.max[i]) for i in range(3)]
+        radius = max(box.max[i] - box.min[i] for i in range(3))
+        origins, directions = array('d'), array('d')
+        for i in range(nrays):
+            d = [rnd.gauss(0., 1.) for j in range(3)]
+            origins.extend(center[j] + radius*d[j] for j in range(3))
+            directions.extend(-x for x in d)
+        origins = memoryview(origins).cast('B').cast('d', (nrays, 3))
+        directions = memoryview(directions).cast('B').cast('d', (nrays, 3))
+        
+        single = timeit(lambda: bvh.intersect(origins, directions, threads = 1), 3)
+        multi = timeit(lambda: bvh.intersect(origins, directions, threads = 0), 3)
+        args = name, mesh.ntriangles(), build, nrays / single, nrays / multi
+        print('%-8s %10d %9.4fs %12.0f %12.0f' % args)
+    
+def bench_mass(factor = .001):
+    print('mass properties, exact against mesh')
+    print('%-8s %10s %10s %10s %10s %12s' % ('model', 'exact', 'mesh', 'mesh (mt)',
+                                           'speedup', 'volume err'))
+    for name, fixture in FIXTURES:
+        solid = fixture()
+        exact = timeit(lambda: (solid.volume(), solid.area(), solid.inertia(),
+                                solid.centreOfMass()), 3)
+        single = timeit(lambda: solid.meshMassProperties(factor, threads = 1), 3)
+        multi = timeit(lambda: solid.meshMassProperties(factor, threads = 0), 3)
+        props = solid.meshMassProperties(factor)
+        err = abs(props['volume'] - solid.volume()) / solid.volume()
+        args = name, exact, single, multi, exact / multi, err
+        print('%-8s %9.4fs %9.4fs %9.4fs %9.1fx %12.2e' % args)
+    
+def bench_tesselate(count = 2000, angular = .01, curvature = .01):
+    print('tesselate %d edges, one call per edge against tesselateMany' % count)
+    print('%10s %10s %10s %10s' % ('per edge', 'batch', 'batch (mt)', 'speedup'))
+    edges = []
+    for i in range(count):
+        center = (i % 50, i // 50, 0.)
+        if i % 2:
+            edges.append(Edge().createCircle(center = center, normal = (0.,0.,1.),
+                                             radius = .4))
+        else:
+            edges.append(Edge().createEllipse(center = center, normal = (0.,0.,1.),
+                                              rMajor = .4, rMinor = .2))
+    
+    single = timeit(lambda: [edge.tesselate(angular, curvature) for edge in edges], 3)
+    batch = timeit(lambda: tesselateMany(edges, angular, curvature, threads = 1), 3)
+    multi = timeit(lambda: tesselateMany(edges, angular, curvature, threads = 0), 3)
+    print('%9.4fs %9.4fs %9.4fs %9.1fx' % (single, batch, multi, single / multi))
+    
+def bench_wireframe(angular = .01, curvature = .01):
+    print('wireframe, EdgeIterator and tesselate against tesselateEdges')
+    print('%-8s %8s %8s %10s %10s %10s' % ('model', 'hits', 'edges', 'iterator',
+                                         'edges', 'edges (mt)'))
+    box = Solid().createBox((0.,0.,0.),(1.,1.,1.))
+    box.fillet(.1)
+    for name, solid in (('box', box), ('loft', loft())):
+        hits = len(list(EdgeIterator(solid)))
+        res = solid.tesselateEdges(angular, curvature)
+        single = timeit(lambda: [edge.tesselate(angular, curvature)
+                                 for edge in EdgeIterator(solid)], 3)
+        batch = timeit(lambda: solid.tesselateEdges(angular, curvature, threads = 1), 3)
+        multi = timeit(lambda: solid.tesselateEdges(angular, curvature, threads = 0), 3)
+        args = name, hits, len(list(res.ids)), single, batch, multi
+        print('%-8s %8d %8d %9.4fs %9.4fs %9.4fs' % args)
+    
+def bench_evaluate(n = 1000000):
+    print('curve evaluation, %d parameters' % n)
+    print('%-8s %-8s %10s %10s %12s' % ('curve', 'order', 'evaluate', 'mt', 'points/s'))
+    pnts = [(i, (-1.)**i, .1*i) for i in range(50)]
+    spline = Edge().createSpline(points = pnts)
+    ellipse = Edge().createEllipse(center=(0.,0.,0.),normal=(0.,0.,1.), rMajor = 2., rMinor = 1.)
+    for name, edge in (('spline', spline), ('ellipse', ellipse)):
+        first, last = edge.parameterRange()
+        step = (last - first) / (n - 1)
+        ordered = array('d', (first + i*step for i in range(n)))
+        shuffled = array('d', ordered)
+        random.Random(1).shuffle(shuffled)
+        for order, u in (('sorted', ordered), ('random', shuffled)):
+            single = timeit(lambda: edge.evaluate(u, 2), 3)
+            multi = timeit(lambda: edge.evaluate(u, 2, threads = 0), 3)
+            print('%-8s %-8s %9.4fs %9.4fs %12.0f' % (name, order, single, multi, n / multi))
+    
+def bench_surface(n = 1000):
+    print('surface evaluation, %d x %d grid' % (n, n))
+    print('%-8s %10s %10s %10s %12s' % ('surface', 'points', 'full', 'mt', 'points/s'))
+    circle = Edge().createCircle((0.,0.,0.), (0.,0.,1.), 1.)
+    plane = Face().createFace(circle)
+    line = Edge().createLine((0.,0.,0.), (1.,0.,0.))
+    cylinder = Face().revolve(line, (0.,1.,0.), (1.,1.,0.), pi)
+    for name, face in (('plane', plane), ('cylinder', cylinder)):
+        points = timeit(lambda: face.evaluateGrid(n, n, classify = False), 3)
+        full = timeit(lambda: face.evaluateGrid(n, n, curvatures = True), 3)
+        multi = timeit(lambda: face.evaluateGrid(n, n, curvatures = True, threads = 0), 3)
+        print('%-8s %9.4fs %9.4fs %9.4fs %12.0f' % (name, points, full, multi, n*n / multi))
+    
+def bench_sample(n = 100000, factor = .001):
+    print('surface sampling, %d points' % n)
+    print('%-8s %10s %10s %10s %12s' % ('model', 'sample', 'mt', 'speedup', 'points/s'))
+    for name, fixture in FIXTURES:
+        mesh = fixture().createMesh(factor)
+        single = timeit(lambda: mesh.samplePoints(n, threads = 1), 3)
+        multi = timeit(lambda: mesh.samplePoints(n, threads = 0), 3)
+        print('%-8s %9.4fs %9.4fs %9.1fx %12.0f' % (name, single, multi, single / multi, n / multi))
+    
+def bench_cache(factors = (.001, .0002)):
+    print('mesh cache, uncached against hit')
+    print('%-8s %-8s %10s %10s %10s' % ('model', 'factor', 'uncached', 'hit', 'speedup'))
+    for name, fixture in FIXTURES:
+        for factor in factors:
+            solid = fixture()
+            MeshCache.setBudget(0)
+            uncached = timeit(lambda: (solid.clearMesh(), solid.createMesh(factor)), 3)
+            MeshCache.setBudget(1 << 30)
+            solid.createMesh(factor)
+            hit = timeit(lambda: (solid.clearMesh(), solid.createMesh(factor)), 3)
+            MeshCache.setBudget(0)
+            MeshCache.clear()
+            print('%-8s %-8g %9.4fs %9.4fs %9.1fx' % (name, factor, uncached, hit, uncached / hit))
+    
+if __name__ == "__main__":
+    sys.dont_write_bytecode = True
+    bench_normals()
+    bench_cache()
+    bench_optimize()
+    bench_edges()
+    bench_update()
+    bench_lod()
+    bench_decimate()
+    bench_encode()
+    bench_simd()
+    bench_bvh()
+    bench_mass()
+    bench_tesselate()
+    bench_wireframe()
+    bench_evaluate()
+    bench_surface()
+    bench_sample()
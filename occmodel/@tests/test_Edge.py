@@ -5,6 +5,7 @@
 #
 import sys
 import unittest
+from array import array
 
 from math import pi, sin, cos, sqrt
 
@@ -165,6 +166,61 @@ class test_Edge(unittest.TestCase):
         
         e1 = Edge().createArc((0.,0.,0.),(1.,0.,1.),(1.,0.,0.))
         eq(e1.isClosed(), False)
+    
+    def test_evaluate(self):
+        aeq = self.assertAlmostEqual
+        dot = lambda a, b: sum(va*vb for va,vb in zip(a,b))
+        
+        e1 = Edge().createCircle(center=(0.,0.,0.),normal=(0.,0.,1.),radius = 1.)
+        first, last = e1.parameterRange()
+        aeq(last - first, 2*pi)
+        
+        u = array('d', (first + i*(last - first)/100. for i in range(100)))
+        points, d1, d2 = e1.evaluate(u, 2, threads = 0)
+        self.assertEqual(points.shape, (100, 3))
+        for i in range(100):
+            p, t, c = list(points[i]), list(d1[i]), list(d2[i])
+            aeq(dot(p, p), 1.)
+            aeq(dot(t, t), 1.)
+            aeq(dot(p, t), 0.)
+            self.almostEqual(c, [-v for v in p])
+        
+        # preallocated buffer is filled in place
+        buf = memoryview(array('d', [0.]*300)).cast('B').cast('d', (100, 3))
+        res = e1.evaluate(u, points = buf)
+        self.almostEqual(list(buf[50]), list(points[50]))
+        self.almostEqual(list(res[50]), list(points[50]))
+        self.assertRaises(OCCError, e1.evaluate, u, 3)
+        
+        # B-spline evaluated in any parameter order
+        pnts = ((0.,0.,0.), (1.,2.,0.), (2.,-1.,1.), (3.,1.,0.), (4.,0.,2.))
+        e2 = Edge().createSpline(points = pnts)
+        first, last = e2.parameterRange()
+        n = 10000
+        u = array('d', (first + ((7919*i) % n)*(last - first)/(n - 1) for i in range(n)))
+        single = e2.evaluate(u, 1)
+        multi = e2.evaluate(u, 1, threads = 0)
+        for i in range(0, n, 97):
+            self.almostEqual(list(single[0][i]), list(multi[0][i]))
+            self.almostEqual(list(single[1][i]), list(multi[1][i]))
+        i = list(u).index(first)
+        self.almostEqual(list(single[0][i]), pnts[0])
+    
+    def test_sampleUniform(self):
+        e1 = Edge().createArc((0.,0.,0.),(1.,0.,1.),(1.,0.,0.))
+        params, points = e1.sampleUniform(11)
+        self.assertEqual(points.shape, (11, 3))
+        self.almostEqual(list(points[0]), (0.,0.,0.))
+        self.almostEqual(list(points[10]), (1.,0.,1.))
+        
+        dist = lambda a, b: sqrt(sum((va - vb)**2 for va,vb in zip(a,b)))
+        chords = [dist(points[i], points[i + 1]) for i in range(10)]
+        for chord in chords:
+            self.assertAlmostEqual(chord, chords[0], places = 5)
+        
+        params, points, d1 = e1.sampleUniform(5, 1)
+        self.assertEqual(len(params), 5)
+        self.assertRaises(OCCError, e1.sampleUniform, 1)
 
 if __name__ == "__main__":
     sys.dont_write_bytecode = True
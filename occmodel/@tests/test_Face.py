@@ -5,6 +5,7 @@
 #
 import sys
 import unittest
+from array import array
 
 from math import pi, sin, cos, sqrt
 
@@ -77,6 +78,48 @@ class test_Face(unittest.TestCase):
         face = Face().revolve(e1, (0.,1.,0.),(1.,1.,0.), pi)
         
         eq(face.area(), pi)
+    
+    def test_evaluate(self):
+        eq = self.assertAlmostEqual
+        
+        # circular face, plane bounds (-1,1) x (-1,1)
+        e1 = Edge().createCircle((0.,0.,0.), (0.,0.,1.), 1.)
+        face = Face().createFace(e1)
+        umin, umax, vmin, vmax = face.parameterRange()
+        eq(umax - umin, 2.)
+        eq(vmax - vmin, 2.)
+        
+        res = face.evaluateGrid(5, 5, curvatures = True, threads = 2)
+        self.assertEqual(res['points'].shape, (25, 3))
+        self.assertEqual(res['uv'].shape, (25, 2))
+        for i in range(25):
+            eq(res['points'][i][2], 0.)
+            eq(abs(res['normals'][i][2]), 1.)
+            eq(res['curvatures'][i][0], 0.)
+        inside = res['inside']
+        self.assertEqual([inside[i] for i in (0, 4, 20, 24)], [0, 0, 0, 0])
+        self.assertEqual(inside[12], 1)
+        
+        uv = memoryview(array('d', (res['uv'][12][0], res['uv'][12][1]))).cast('B').cast('d', (1,2))
+        res = face.evaluateUV(uv)
+        self.assertEqual(sorted(res.keys()), ['normals', 'points'])
+        for i in range(3):
+            eq(res['points'][0][i], 0.)
+        
+        # cylindrical face of radius 1
+        p1 = Vertex(0.,0.,0.)
+        p2 = Vertex(1.,0.,0.)
+        e1 = Edge().createLine(p1,p2)
+        face = Face().revolve(e1, (0.,1.,0.),(1.,1.,0.), pi)
+        res = face.evaluateGrid(4, 4, curvatures = True, classify = False)
+        self.assertFalse('inside' in res)
+        for i in range(16):
+            eq(sum(v*v for v in res['normals'][i]), 1.)
+            k = sorted(abs(v) for v in res['curvatures'][i])
+            eq(k[0], 0.)
+            eq(k[1], 1.)
+        
+        self.assertRaises(OCCError, face.evaluateGrid, 1, 4)
         
 if __name__ == "__main__":
     sys.dont_write_bytecode = True
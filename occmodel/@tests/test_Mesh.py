@@ -0,0 +1,627 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#
+# This file is part of occmodel - See LICENSE.txt
+#
+import sys
+import unittest
+from array import array
+
+from math import pi, sin, cos, sqrt
+
+from occmodel import Vertex, Edge, Face, Solid, Mesher, MeshCache, OCCError
+from occmodel import EdgeIterator, SIMD_SCALAR, MeshBVH
+from occmodel import NORMALS_SMOOTH, NORMALS_SURFACE, NORMALS_PROJECTED
+
+def sphereBox(corner = (0.,0.,0.)):
+    # unit sphere fused with a box, curved and planar faces
+    solid = Solid().createSphere((0.,0.,0.),1.)
+    solid.fuse(Solid().createBox(corner,(2.,2.,2.)))
+    return solid
+    
+class test_Mesh(unittest.TestCase):
+    def test_createMeshThreads(self):
+        s1 = sphereBox((-.5,-.5,-.5))
+        
+        m1 = s1.createMesh()
+        m2 = s1.createMesh(threads = 4)
+        
+        self.assertEqual(m1.nvertices(), m2.nvertices())
+        self.assertEqual(m1.ntriangles(), m2.ntriangles())
+        self.assertEqual(m1.nedgeIndices(), m2.nedgeIndices())
+        self.assertEqual(tuple(m1.vertices), tuple(m2.vertices))
+        self.assertEqual(tuple(m1.normals), tuple(m2.normals))
+        self.assertEqual(tuple(m1.triangles), tuple(m2.triangles))
+        self.assertEqual(tuple(m1.edgeIndices), tuple(m2.edgeIndices))
+        self.assertEqual(tuple(m1.edgeRanges), tuple(m2.edgeRanges))
+    
+    def test_optimize(self):
+        solid = Solid().createSphere((0.,0.,0.),1.)
+        mesh = solid.createMesh(.001)
+        
+        nvertices = mesh.nvertices()
+        ntriangles = mesh.ntriangles()
+        nedgeIndices = mesh.nedgeIndices()
+        before = mesh.cacheEfficiency()
+        
+        mesh.optimize()
+        
+        self.assertEqual(mesh.nvertices(), nvertices)
+        self.assertEqual(mesh.ntriangles(), ntriangles)
+        self.assertEqual(mesh.nedgeIndices(), nedgeIndices)
+        self.assertTrue(mesh.cacheEfficiency() < before)
+        self.assertTrue(mesh.cacheEfficiency() < 1.5)
+        self.assertTrue(max(mesh.triangles) < nvertices)
+    
+    def test_decimate(self):
+        solid = sphereBox()
+        mesh = solid.createMesh(.0005)
+        
+        vertices = set(tuple(mesh.vertices[3*i:3*i + 3]) for i in range(mesh.nvertices()))
+        edgeVertices = [tuple(mesh.vertices[3*i:3*i + 3]) for i in mesh.edgeIndices]
+        ntriangles = mesh.ntriangles()
+        
+        mesh.decimate(ntriangles // 4)
+        self.assertTrue(mesh.ntriangles() < ntriangles)
+        self.assertTrue(mesh.ntriangles() >= ntriangles // 4)
+        self.assertEqual(mesh.nnormals(), mesh.nvertices())
+        self.assertTrue(max(mesh.triangles) < mesh.nvertices())
+        
+        # edge polylines are untouched
+        self.assertEqual(len(edgeVertices), mesh.nedgeIndices())
+        for i, index in enumerate(mesh.edgeIndices):
+            self.assertEqual(tuple(mesh.vertices[3*index:3*index + 3]), edgeVertices[i])
+        
+        self.checkFaceRanges(solid, mesh)
+        
+        # remaining vertices are not moved
+        for i in range(mesh.nvertices()):
+            self.assertTrue(tuple(mesh.vertices[3*i:3*i + 3]) in vertices)
+        
+        # error bound
+        mesh = solid.createMesh(.0005)
+        mesh.decimate(maxError = 1e-3)
+        self.assertTrue(mesh.ntriangles() < ntriangles)
+        self.assertTrue(mesh.ntriangles() > 0)
+        
+    def test_encode(self):
+        solid = sphereBox()
+        mesh = solid.createMesh(.001)
+        
+        for normalBits, maxNormal in ((8, .03), (16, 2e-4)):
+            enc = mesh.encode(normalBits)
+            self.assertEqual(enc.nvertices(), mesh.nvertices())
+            self.assertEqual(enc.normalBits, normalBits)
+            self.assertEqual(enc.indexSize, 2 if mesh.nvertices() <= 65536 else 4)
+            self.assertTrue(enc.memoryUsage() < mesh.memoryUsage() // 2)
+            
+            errors = enc.errors
+            self.assertTrue(0. <= errors['meanPosition'] <= errors['maxPosition'])
+            self.assertTrue(errors['maxPosition'] <= max(enc.scale))
+            self.assertTrue(errors['maxNormal'] < maxNormal)
+            
+            res = enc.decode()
+            self.assertEqual(tuple(res.triangles), tuple(mesh.triangles))
+            self.assertEqual(tuple(res.edgeIndices), tuple(mesh.edgeIndices))
+            self.assertEqual(tuple(res.faceRanges), tuple(mesh.faceRanges))
+            for i in range(3*mesh.nvertices()):
+                self.assertTrue(abs(res.vertices[i] - mesh.vertices[i]) <= errors['maxPosition'] + 1e-6)
+        
+        # parallel encoding gives identical result
+        enc1, enc2 = mesh.encode(16, 1), mesh.encode(16, 0)
+        self.assertEqual(tuple(enc1.positions), tuple(enc2.positions))
+        self.assertEqual(tuple(enc1.normals), tuple(enc2.normals))
+        
+        # vector kernels give identical result
+        best = Mesher.setSIMDLevel()
+        try:
+            for normalBits in (8, 16):
+                Mesher.setSIMDLevel(SIMD_SCALAR)
+                ref = mesh.encode(normalBits)
+                refmesh = ref.decode()
+                Mesher.setSIMDLevel(best)
+                enc = mesh.encode(normalBits)
+                self.assertEqual(tuple(enc.positions), tuple(ref.positions))
+                self.assertEqual(tuple(enc.normals), tuple(ref.normals))
+                self.assertEqual(enc.errors['maxNormal'], ref.errors['maxNormal'])
+                res = enc.decode()
+                self.assertEqual(tuple(res.vertices), tuple(refmesh.vertices))
+                self.assertEqual(tuple(res.normals), tuple(refmesh.normals))
+        finally:
+            Mesher.setSIMDLevel(best)
+        
+    def test_simd(self):
+        solid = sphereBox()
+        solid.rotate(pi/5., (1.,1.,0.))
+        solid.translate((10.,-5.,3.))
+        
+        best = Mesher.setSIMDLevel()
+        try:
+            Mesher.setSIMDLevel(SIMD_SCALAR)
+            self.assertEqual(Mesher.simdLevel(), SIMD_SCALAR)
+            ref = solid.createMesh(.001)
+            
+            for level in range(SIMD_SCALAR + 1, best + 1):
+                self.assertEqual(Mesher.setSIMDLevel(level), level)
+                mesh = solid.createMesh(.001)
+                self.assertEqual(tuple(mesh.triangles), tuple(ref.triangles))
+                for i in range(3*ref.nvertices()):
+                    self.assertAlmostEqual(mesh.vertices[i], ref.vertices[i], places = 5)
+                    self.assertAlmostEqual(mesh.normals[i], ref.normals[i], places = 5)
+        finally:
+            Mesher.setSIMDLevel(best)
+        
+    def checkPrecise(self, mesh, tol):
+        self.assertEqual(len(mesh.preciseVertices), 3*mesh.nvertices())
+        origin = mesh.origin
+        for i in range(3*mesh.nvertices()):
+            pos = origin[i % 3] + mesh.vertices[i]
+            self.assertTrue(abs(pos - mesh.preciseVertices[i]) < tol)
+        
+    def test_originRelative(self):
+        center = (1.e6, -2.e6, 5.e5)
+        far = Solid().createSphere(center,1.)
+        far.fuse(Solid().createBox(center,(center[0] + 2.,center[1] + 2.,center[2] + 2.)))
+        near = sphereBox()
+        
+        mesher = Mesher(originRelative = True, preciseVertices = True)
+        ref = near.createMesh(mesher = mesher)
+        mesh = far.createMesh(mesher = mesher)
+        self.checkPrecise(ref, 1e-6)
+        
+        # float vertices keep precision relative to the origin
+        for i in range(3):
+            self.assertAlmostEqual(mesh.origin[i] - ref.origin[i], center[i], places = 6)
+        for i in range(3*mesh.nvertices()):
+            self.assertTrue(abs(mesh.vertices[i]) < 2.)
+        self.checkPrecise(mesh, 1e-5)
+        
+        for threads in (0, 1):
+            mesher.threads = threads
+            mesh = far.createMesh(mesher = mesher)
+            self.checkPrecise(mesh, 1e-5)
+        
+        mesh.optimize()
+        self.checkPrecise(mesh, 1e-5)
+        mesh.decimate(mesh.ntriangles() // 2)
+        self.checkPrecise(mesh, 1e-5)
+        
+        mesher.weld = True
+        mesh = far.createMesh(mesher = mesher)
+        self.checkPrecise(mesh, 1e-5)
+        
+        res = mesh.encode().decode()
+        self.assertEqual(res.origin, mesh.origin)
+        
+    def test_qualityNormals(self):
+        # curved faces with a location from rotate and translate
+        solid = Solid().createCylinder((0.,0.,0.),(0.,0.,2.),1.)
+        solid.rotate(.5*pi, (1.,0.,0.))
+        solid.translate((5.,0.,0.))
+        
+        ref = solid.createMesh(.001, qualityNormals = NORMALS_PROJECTED)
+        for mode, tol in ((NORMALS_SURFACE, 1e-4), (NORMALS_SMOOTH, .05)):
+            mesh = solid.createMesh(.001, qualityNormals = mode)
+            self.assertEqual(tuple(mesh.vertices), tuple(ref.vertices))
+            for i in range(mesh.nvertices()):
+                n1 = mesh.normals[3*i:3*i + 3]
+                n2 = ref.normals[3*i:3*i + 3]
+                dot = sum(a*b for a, b in zip(n1, n2))
+                self.assertTrue(dot > 1. - tol)
+        
+    def test_releaseTriangulation(self):
+        solid = sphereBox()
+        
+        mem = solid.memoryUsage()
+        self.assertTrue(mem['geometry'] > 0)
+        self.assertTrue(mem['pcurves'] > 0)
+        self.assertEqual(mem['triangulation'], 0)
+        
+        mesh = solid.createMesh()
+        mem = solid.memoryUsage()
+        self.assertTrue(mem['triangulation'] > 0)
+        self.assertTrue(mem['polygons'] > 0)
+        self.assertEqual(mem['total'], sum(mem[key] for key in
+                         ('triangulation', 'polygons', 'pcurves', 'geometry')))
+        
+        solid.clearMesh()
+        mem = solid.memoryUsage()
+        self.assertEqual((mem['triangulation'], mem['polygons']), (0, 0))
+        
+        mesher = Mesher(releaseTriangulation = True)
+        res = solid.createMesh(mesher = mesher)
+        self.assertEqual(res.ntriangles(), mesh.ntriangles())
+        mem = solid.memoryUsage()
+        self.assertEqual((mem['triangulation'], mem['polygons']), (0, 0))
+        
+    def points(self, data):
+        # (n, 3) double buffer without numpy
+        return memoryview(array('d', data)).cast('B').cast('d', (len(data) // 3, 3))
+        
+    def test_massProperties(self):
+        box = Solid().createBox((1.,0.,0.),(2.,1.,3.))
+        props = box.meshMassProperties(threads = 0)
+        self.assertAlmostEqual(props['volume'], 3., places = 5)
+        self.assertAlmostEqual(props['area'], 14., places = 5)
+        for a, b in zip(props['centreOfMass'], (1.5,.5,1.5)):
+            self.assertAlmostEqual(a, b, places = 5)
+        for a, b in zip(props['inertia'], box.inertia()):
+            self.assertAlmostEqual(a, b, places = 4)
+        
+        solid = sphereBox()
+        mesh = solid.createMesh(.005)
+        self.assertTrue(mesh.deflection > 0.)
+        props = mesh.massProperties(threads = 0)
+        self.assertAlmostEqual(props['volume'], mesh.massProperties()['volume'], places = 8)
+        
+        self.assertTrue(abs(props['volume'] - solid.volume()) <= props['volumeError'])
+        self.assertTrue(abs(props['area'] - solid.area()) <= props['areaError'])
+        centre = solid.centreOfMass()
+        dist = sqrt(sum((a - b)**2 for a, b in zip(props['centreOfMass'], centre)))
+        self.assertTrue(dist <= props['centreError'])
+        for a, b in zip(props['inertia'], solid.inertia()):
+            self.assertTrue(abs(a - b) <= props['inertiaError'])
+        
+    def test_massPropertiesLarge(self):
+        # relativeToEdge scales the deflection of long edges, the
+        # recorded deflection must still bound the error
+        solid = Solid().createCylinder((0.,0.,0.),(0.,0.,200.), 60.)
+        mesh = solid.createMesh(.001)
+        props = mesh.massProperties()
+        self.assertTrue(mesh.deflection > .001*200.)
+        self.assertTrue(abs(props['volume'] - solid.volume()) <= props['volumeError'])
+        centre = solid.centreOfMass()
+        dist = sqrt(sum((a - b)**2 for a, b in zip(props['centreOfMass'], centre)))
+        self.assertTrue(dist <= props['centreError'])
+        
+        # without relativeToEdge the bound is tight
+        tight = solid.meshMassProperties(.001)
+        self.assertTrue(abs(tight['volume'] - solid.volume()) <= tight['volumeError'])
+        self.assertTrue(tight['volumeError'] < props['volumeError'])
+        self.assertTrue(tight['volumeError'] < .01*solid.volume())
+        for a, b in zip(tight['inertia'], solid.inertia()):
+            self.assertTrue(abs(a - b) <= tight['inertiaError'])
+        
+    def test_samplePoints(self):
+        box = Solid().createBox((1.,0.,0.),(2.,1.,3.))
+        res = box.samplePoints(14000, seed = 1)
+        points, normals, faces = res['points'], res['normals'], res['faces']
+        self.assertEqual(points.shape, (14000, 3))
+        self.assertEqual(faces.shape, (14000,))
+        
+        # on the surface with the normal of the side, uniform by area
+        bottom = 0
+        normal = {}
+        for i in range(14000):
+            p, n = points[i], normals[i]
+            self.assertTrue(1. - 1e-6 <= p[0] <= 2. + 1e-6)
+            self.assertTrue(-1e-6 <= p[2] <= 3. + 1e-6)
+            n = tuple(round(v, 5) for v in n)
+            self.assertEqual(sorted(abs(v) for v in n), [0., 0., 1.])
+            self.assertEqual(normal.setdefault(faces[i], n), n)
+            if abs(p[2]) < 1e-6:
+                bottom += 1
+        self.assertEqual(len(normal), 6)
+        self.assertTrue(850 < bottom < 1150)
+        
+        # deterministic for seed, independent of threads
+        mesh = box.createMesh()
+        res1 = mesh.samplePoints(1000, 7)
+        res2 = mesh.samplePoints(1000, 7, threads = 0)
+        res3 = mesh.samplePoints(1000, 8)
+        for key in ('points', 'normals', 'faces'):
+            self.assertEqual(res1[key].tobytes(), res2[key].tobytes())
+        self.assertNotEqual(res1['points'].tobytes(), res3['points'].tobytes())
+        self.assertRaises(OCCError, mesh.samplePoints, -1)
+        
+    def test_bvh(self):
+        solid = sphereBox()
+        mesh = solid.createMesh(.001)
+        bvh = MeshBVH(mesh)
+        self.assertEqual(bvh.ntriangles(), mesh.ntriangles())
+        
+        origins, directions = [], []
+        for i in range(16):
+            a = 2.*pi*i/16.
+            origins.extend((-5.*cos(a), -5.*sin(a), -.5))
+            directions.extend((cos(a), sin(a), 0.))
+        origins.extend((10., 10., 10.))
+        directions.extend((1., 0., 0.))
+        
+        for threads in (1, 0):
+            tris, faces, dist = bvh.intersect(self.points(origins), self.points(directions),
+                                              threads = threads)
+            for i in range(16):
+                self.assertTrue(tris[i] >= 0)
+                self.assertTrue(0 <= faces[i] < solid.numFaces())
+                # hit the sphere part at distance 5 - sqrt(1 - .25)
+                self.assertAlmostEqual(dist[i], 5. - sqrt(.75), places = 2)
+            self.assertEqual((tris[16], faces[16]), (-1, -1))
+        
+        tris, faces, closest, dist = bvh.closestPoint(self.points((0.,0.,-3., 1.,1.,5.)))
+        self.assertAlmostEqual(dist[0], 2., places = 2)
+        self.assertAlmostEqual(closest[0, 2], -1., places = 2)
+        self.assertAlmostEqual(dist[1], 3., places = 5)
+        self.assertTrue(faces[0] >= 0 and faces[1] >= 0)
+        
+        tris, faces, closest, dist = bvh.closestPoint(self.points((0.,0.,-3.)), maxDistance = 1.)
+        self.assertEqual(tris[0], -1)
+        
+        box = Solid().createBox((1.5,1.5,1.5),(3.,3.,3.)).boundingBox()
+        res = bvh.overlap(box)
+        self.assertTrue(len(res) > 0)
+        for tri in res:
+            for axis in range(3):
+                coords = [mesh.vertices[3*mesh.triangles[3*tri + j] + axis] for j in range(3)]
+                self.assertTrue(max(coords) >= 1.5 - 1e-6)
+        
+        box = Solid().createBox((5.,5.,5.),(6.,6.,6.)).boundingBox()
+        self.assertEqual(bvh.overlap(box), [])
+        
+    def checkInterleaved(self, mesh):
+        self.assertEqual(mesh.interleavedStride, 32)
+        self.assertEqual(len(mesh.interleaved), 8*mesh.nvertices())
+        for i in range(mesh.nvertices()):
+            rec = mesh.interleaved[8*i:8*i + 8]
+            self.assertEqual(tuple(rec[0:3]), tuple(mesh.vertices[3*i:3*i + 3]))
+            self.assertEqual(tuple(rec[4:7]), tuple(mesh.normals[3*i:3*i + 3]))
+            self.assertEqual((rec[3], rec[7]), (1., 0.))
+        
+    def test_interleaved(self):
+        solid = sphereBox()
+        
+        mesh = solid.createMesh()
+        self.assertEqual(mesh.interleaved, None)
+        
+        mesher = Mesher(interleaved = True)
+        for threads in (1, 0):
+            mesher.threads = threads
+            mesh = solid.createMesh(mesher = mesher)
+            self.checkInterleaved(mesh)
+            
+            mesh.optimize()
+            self.checkInterleaved(mesh)
+        
+        mesher.weld = True
+        mesh = solid.createMesh(mesher = mesher)
+        self.checkInterleaved(mesh)
+        
+        mesh.decimate(mesh.ntriangles() // 2)
+        self.checkInterleaved(mesh)
+        
+    def checkFaceRanges(self, solid, mesh):
+        nfaces = mesh.nfaceRanges() // 5
+        self.assertEqual(nfaces, solid.numFaces())
+        
+        ids, ntriangles = set(), 0
+        for i in range(nfaces):
+            tfirst, tcount, vfirst, vcount, faceid = mesh.faceRange(i)
+            self.assertEqual(tfirst, ntriangles)
+            ntriangles += tcount
+            ids.add(faceid)
+            for j in range(3*tfirst, 3*(tfirst + tcount)):
+                self.assertTrue(vfirst <= mesh.triangles[j] < vfirst + vcount)
+        
+        self.assertEqual(ntriangles, mesh.ntriangles())
+        self.assertEqual(ids, set(range(nfaces)))
+        
+    def test_faceRanges(self):
+        solid = sphereBox((-.5,-.5,-.5))
+        
+        mesh = solid.createMesh()
+        self.checkFaceRanges(solid, mesh)
+        self.assertEqual(tuple(mesh.faceRanges),
+                         tuple(solid.createMesh(threads = 4).faceRanges))
+        
+        mesh.optimize()
+        self.checkFaceRanges(solid, mesh)
+        
+        mesh = solid.createMesh(weld = True)
+        nfaces = mesh.nfaceRanges() // 5
+        self.assertEqual(sum(mesh.faceRange(i)[1] for i in range(nfaces)), mesh.ntriangles())
+        self.assertEqual(sum(mesh.faceRange(i)[3] for i in range(nfaces)), mesh.nvertices())
+        
+    def test_updateMesh(self):
+        solid = Solid().createBox((0.,0.,0.),(10.,10.,10.))
+        previous = solid.createMesh(.001)
+        
+        solid.fillet(1., tuple(EdgeIterator(solid))[0])
+        mesh = solid.updateMesh(previous, .001)
+        full = solid.createMesh(.001)
+        self.checkFaceRanges(solid, mesh)
+        self.assertEqual(mesh.nfaceRanges(), full.nfaceRanges())
+        
+        # cut a hole and update again
+        previous = mesh
+        solid.cut(Solid().createCylinder((5.,5.,-1.),(5.,5.,11.),2.))
+        mesh = solid.updateMesh(previous, .001)
+        self.checkFaceRanges(solid, mesh)
+        self.assertEqual(mesh.nfaceRanges() // 5, solid.numFaces())
+        
+        # untouched faces are copied also when triangulations are released
+        counts = []
+        for release in (False, True):
+            mesher = Mesher(.001, releaseTriangulation = release)
+            solid = Solid().createBox((0.,0.,0.),(10.,10.,10.))
+            previous = solid.createMesh(mesher = mesher)
+            self.assertEqual(mesher.facesMeshed, 6)
+            if release:
+                self.assertEqual(solid.memoryUsage()['triangulation'], 0)
+            
+            solid.fillet(1., tuple(EdgeIterator(solid))[0])
+            mesh = solid.updateMesh(previous, mesher = mesher)
+            self.checkFaceRanges(solid, mesh)
+            self.assertTrue(0 < mesher.facesMeshed < solid.numFaces())
+            counts.append((mesher.facesMeshed, mesh.ntriangles(), mesh.nedgeRanges()))
+        self.assertEqual(counts[0], counts[1])
+        
+    def test_mesher(self):
+        solid = Solid().createSphere((0.,0.,0.),1.)
+        m1 = solid.createMesh(.01, .25)
+        
+        mesher = Mesher(deflection = .01, angle = .25)
+        m2 = solid.createMesh(mesher = mesher)
+        self.assertEqual(m1.ntriangles(), m2.ntriangles())
+        
+        timings = mesher.timings
+        for key in ('bbox', 'discretize', 'extract', 'normals', 'edges'):
+            self.assertTrue(timings[key] >= 0.)
+        self.assertTrue(timings['discretize'] > 0.)
+        
+        # absolute deflection
+        mesher.relative = False
+        mesher.deflection = .02
+        m3 = solid.createMesh(mesher = mesher)
+        self.assertTrue(m3.ntriangles() > 0)
+        
+        # finer mesh
+        mesher.deflection = .002
+        m4 = solid.createMesh(mesher = mesher)
+        self.assertTrue(m4.ntriangles() > m3.ntriangles())
+        
+        # same object works for faces
+        face = Face().createFace(Edge().createCircle((0.,0.,0.),(0.,0.,1.),1.))
+        mesh = face.createMesh(mesher = mesher)
+        self.assertTrue(mesh.ntriangles() > 0)
+        
+    def test_createMeshLOD(self):
+        solid = Solid().createSphere((0.,0.,0.),1.)
+        factors = (.001, .01, .05)
+        meshes = solid.createMeshLOD(factors)
+        self.assertEqual(len(meshes), len(factors))
+        
+        # levels are identical to meshing a fresh solid
+        for factor, mesh in zip(factors, meshes):
+            ref = Solid().createSphere((0.,0.,0.),1.).createMesh(factor)
+            self.assertEqual(mesh.ntriangles(), ref.ntriangles())
+            self.assertEqual(tuple(mesh.vertices), tuple(ref.vertices))
+        
+        self.assertTrue(meshes[0].ntriangles() > meshes[1].ntriangles())
+        self.assertTrue(meshes[1].ntriangles() > meshes[2].ntriangles())
+        
+        # coarse to fine order
+        meshes = solid.createMeshLOD(factors[::-1])
+        self.assertTrue(meshes[0].ntriangles() < meshes[2].ntriangles())
+        
+        # levels are meshed concurrently on copies of the solid
+        solid = Solid().createSphere((0.,0.,0.),1.)
+        meshes = solid.createMeshLOD((.002, .02), threads = 0)
+        self.assertEqual(solid.memoryUsage()['triangulation'], 0)
+        ref = Solid().createSphere((0.,0.,0.),1.).createMesh(.002)
+        self.assertEqual(meshes[0].ntriangles(), ref.ntriangles())
+        self.assertEqual(meshes[0].nedgeRanges(), ref.nedgeRanges())
+        
+        face = Face().createFace(Edge().createCircle((0.,0.,0.),(0.,0.,1.),1.))
+        meshes = face.createMeshLOD((.001, .05))
+        self.assertTrue(meshes[0].ntriangles() > meshes[1].ntriangles())
+        
+        self.assertEqual(solid.createMeshLOD(()), [])
+        
+    def test_createMeshStream(self):
+        solid = sphereBox((-.5,-.5,-.5))
+        mesh = solid.createMesh()
+        
+        chunks = []
+        def sink(firstFace, numFaces, chunk):
+            self.assertTrue(max(chunk.triangles) < chunk.nvertices())
+            chunks.append((firstFace, numFaces, chunk.ntriangles()))
+        
+        solid.createMeshStream(sink)
+        self.assertEqual(sum(c[1] for c in chunks), solid.numFaces())
+        self.assertEqual(sum(c[2] for c in chunks), mesh.ntriangles())
+        
+        # single chunk
+        chunks = []
+        solid.createMeshStream(sink, chunkSize = 1000000)
+        self.assertEqual(len(chunks), 1)
+        self.assertEqual(chunks[0][2], mesh.ntriangles())
+        
+        # chunks may be kept after the call
+        kept = []
+        solid.createMeshStream(lambda firstFace, numFaces, chunk: kept.append(chunk))
+        self.assertEqual(sum(chunk.ntriangles() for chunk in kept), mesh.ntriangles())
+        for chunk in kept:
+            self.assertTrue(chunk.isValid())
+            self.assertEqual(len(chunk.vertices), 3*chunk.nvertices())
+            self.assertTrue(max(chunk.triangles) < chunk.nvertices())
+        
+        def stop(firstFace, numFaces, chunk):
+            raise ValueError()
+        
+        self.assertRaises(ValueError, solid.createMeshStream, stop)
+        
+        # mesher options are honoured
+        chunks = []
+        solid.clearMesh()
+        solid.createMeshStream(sink, mesher = Mesher(threads = 0))
+        self.assertEqual(sum(c[2] for c in chunks), mesh.ntriangles())
+        self.assertTrue(solid.memoryUsage()['triangulation'] > 0)
+        
+        chunks = []
+        solid.createMeshStream(sink, mesher = Mesher(releaseTriangulation = True))
+        self.assertEqual(solid.memoryUsage()['triangulation'], 0)
+        self.assertRaises(OCCError, solid.createMeshStream, sink,
+                          mesher = Mesher(weld = True))
+        
+    def test_weld(self):
+        solid = Solid().createSphere((0.,0.,0.),1.)
+        m1 = solid.createMesh()
+        m2 = solid.createMesh(weld = True)
+        
+        self.assertTrue(m2.nvertices() < m1.nvertices())
+        self.assertEqual(m2.ntriangles(), m1.ntriangles())
+        self.assertEqual(m2.nedgeIndices(), m1.nedgeIndices())
+        self.assertTrue(max(m2.triangles) < m2.nvertices())
+        self.assertTrue(m2.weldSaved() > 0)
+        self.assertEqual(m1.weldSaved(), 0)
+        
+        # sharp edges of a box are not welded
+        solid = Solid().createBox((0.,0.,0.),(1.,1.,1.))
+        m1 = solid.createMesh()
+        m2 = solid.createMesh(weld = True)
+        self.assertEqual(m2.nvertices(), m1.nvertices())
+        
+        m3 = solid.createMesh(weld = True, creaseAngle = pi)
+        self.assertEqual(m3.nvertices(), 8)
+        self.assertEqual(m3.ntriangles(), m1.ntriangles())
+    
+    def test_cache(self):
+        MeshCache.clear()
+        MeshCache.setBudget(64*1024*1024)
+        try:
+            stats = MeshCache.stats()
+            s1 = Solid().createSphere((0.,0.,0.),1.)
+            m1 = s1.createMesh()
+            
+            # identical geometry hits the cache
+            s2 = Solid().createSphere((0.,0.,0.),1.)
+            m2 = s2.createMesh()
+            
+            # different parameters miss the cache
+            m3 = s2.createMesh(.05)
+            
+            res = MeshCache.stats()
+            self.assertEqual(res['hits'] - stats['hits'], 1)
+            self.assertEqual(res['misses'] - stats['misses'], 2)
+            self.assertEqual(res['entries'], 2)
+            self.assertEqual(tuple(m1.vertices), tuple(m2.vertices))
+            self.assertEqual(tuple(m1.triangles), tuple(m2.triangles))
+            
+            # lookup leaves the triangulation of the shape in place
+            tri = s1.memoryUsage()['triangulation']
+            self.assertTrue(tri > 0)
+            s1.createMesh()
+            self.assertEqual(s1.memoryUsage()['triangulation'], tri)
+            
+            # evict down to the smallest budget
+            MeshCache.setBudget(1)
+            res = MeshCache.stats()
+            self.assertEqual(res['entries'], 0)
+            self.assertEqual(res['evictions'] - stats['evictions'], 2)
+        finally:
+            MeshCache.setBudget(0)
+            MeshCache.clear()
+        
+if __name__ == "__main__":
+    sys.dont_write_bytecode = True
+    unittest.main()
@@ -8,7 +8,7 @@ import unittest
 
 from math import pi, sin, cos, sqrt
 
-from occmodel import Vertex, Edge, Face, Solid, OCCError
+from occmodel import Vertex, Edge, Face, Solid, OCCError, EdgeIterator
 
 class test_Solid(unittest.TestCase):
     def almostEqual(self, a, b, places = 7):
@@ -126,6 +126,36 @@ class test_Solid(unittest.TestCase):
         solid.createBox((-.5,-.5,-.5),(.5,.5,.5))
         
         eq(solid.volume(), 1.)
+    
+    def test_tesselateEdges(self):
+        eq = self.assertEqual
+        
+        solid = Solid().createBox((-.5,-.5,-.5),(.5,.5,.5))
+        # shared edges are visited once per face
+        eq(len(list(EdgeIterator(solid))), 24)
+        res = solid.tesselateEdges(threads = 0)
+        eq(list(res.ids), list(range(12)))
+        eq(list(res.ranges)[1::2], [2]*12)
+        eq(res.nvertices(), 24)
+        
+        # seam edge skipped, both circles kept
+        solid = Solid().createCylinder((0.,0.,0.),(0.,0.,1.), 1.)
+        res = solid.tesselateEdges(.05, .05)
+        eq(len(list(res.ids)), 2)
+        ranges = list(res.ranges)
+        eq(ranges[0], 0)
+        eq(ranges[2], ranges[1])
+        eq(res.nvertices(), ranges[1] + ranges[3])
+        vertices = list(res.vertices)
+        for i in range(res.nvertices()):
+            x, y, z = vertices[3*i:3*i + 3]
+            self.assertAlmostEqual(x*x + y*y, 1., places = 5)
+            self.assertTrue(abs(z) < 1e-6 or abs(z - 1.) < 1e-6)
+        
+        e1 = Edge().createCircle(center=(0.,0.,0.),normal=(0.,0.,1.),radius = 1.)
+        face = Face().createFace(e1)
+        res = face.tesselateEdges()
+        eq(list(res.ids), [0])
         
 if __name__ == "__main__":
     sys.dont_write_bytecode = True
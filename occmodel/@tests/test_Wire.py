@@ -8,7 +8,7 @@ import unittest
 
 from math import pi, sin, cos, sqrt
 
-from occmodel import Vertex, Edge, Wire, OCCError
+from occmodel import Vertex, Edge, Wire, OCCError, tesselateMany
 
 class test_Wire(unittest.TestCase):
     def almostEqual(self, a, b, places = 7):
@@ -136,6 +136,35 @@ class test_Wire(unittest.TestCase):
             )
             eq(w1.isClosed(), val)
     
+    def test_tesselateMany(self):
+        eq = self.assertEqual
+        
+        e1 = Edge().createCircle(center=(0.,0.,0.),normal=(0.,0.,1.),radius = 1.)
+        e2 = Edge().createArc3P((1.,0.,0.),(-1.,0.,0.),(0.,1.,0.))
+        w1 = Wire().createRectangle(width = 1., height = 1., radius = .25)
+        objects = (e1, w1, e2)
+        
+        res = tesselateMany(objects, .05, .05, threads = 0)
+        eq(list(res.ids), [0] + [1]*len(w1) + [2])
+        eq(res.nranges(), 2*(len(w1) + 2))
+        
+        ranges = list(res.ranges)
+        vertices = list(res.vertices)
+        start = 0
+        for i, obj in enumerate(objects):
+            tess = obj.tesselate(.05, .05)
+            n = tess.nranges()
+            eq(ranges[start:start + n:2],
+               [r + ranges[start] for r in list(tess.ranges)[::2]])
+            eq(ranges[start + 1:start + n:2], list(tess.ranges)[1::2])
+            first = 3*ranges[start]
+            eq(vertices[first:first + 3*tess.nvertices()], list(tess.vertices))
+            start += n
+        eq(start, res.nranges())
+        eq(3*sum(ranges[1::2]), len(vertices))
+        
+        self.assertRaises(OCCError, tesselateMany, (e1, Vertex(0.,0.,0.)))
+        
 if __name__ == "__main__":
     sys.dont_write_bytecode = True
     unittest.main()
\ No newline at end of file
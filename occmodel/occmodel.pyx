@@ -8,6 +8,16 @@ include "Config.pxi"
 class OCCError(Exception):
     pass
 
+# mesh normal modes
+NORMALS_SMOOTH = 0
+NORMALS_SURFACE = 1
+NORMALS_PROJECTED = 2
+
+# mesh kernel levels
+SIMD_SCALAR = 0
+SIMD_SSE2 = 1
+SIMD_AVX2 = 2
+
 cdef class Tesselation:
     '''
     Tesselation - Representing Edge/Wire tesselation which result in
@@ -21,6 +31,9 @@ cdef class Tesselation:
     cdef readonly view.array ranges
     cdef readonly int rangesItemSize
     
+    cdef readonly view.array ids
+    cdef readonly int idsItemSize
+    
     def __init__(self):
         self.thisptr = new c_OCCTesselation()
         
@@ -66,6 +79,16 @@ cdef class Tesselation:
             allocate_buffer=False
         )
         self.ranges.data = <char *> &occ.ranges[0]
+        
+        if occ.ids.size() > 0:
+            self.idsItemSize = sizeof(int)
+            self.ids = view.array(
+                shape=(occ.ids.size(),),
+                itemsize=sizeof(int),
+                format="i",
+                allocate_buffer=False
+            )
+            self.ids.data = <char *> &occ.ids[0]
       
     cpdef size_t nvertices(self):
         '''
@@ -81,6 +104,39 @@ cdef class Tesselation:
         cdef c_OCCTesselation *occ = <c_OCCTesselation *>self.thisptr
         return occ.ranges.size()
         
+def tesselateMany(objects, double angular = .1, double curvature = .1,
+                  int threads = 1):
+    '''
+    Tesselate a sequence of edges and wires into one Tesselation.
+    
+    All curves are discretized in parallel into a single vertex
+    array. ranges hold a (start, count) pair for each edge, wires in
+    connected edge order, and ids the index in objects of the edge
+    or wire the polyline belongs to.
+    
+    :param objects: sequence of Edge and Wire objects
+    :param angular: max angular deflection
+    :param curvature: max curvature deflection
+    :param threads: number of threads, zero use all cores
+    '''
+    cdef vector[c_OCCBase *] cshapes
+    cdef c_OCCTesselation *tess
+    cdef Tesselation ret = Tesselation.__new__(Tesselation, None)
+    cdef Base cobj
+    
+    for obj in objects:
+        if not isinstance(obj, (Edge, Wire)):
+            raise OCCError('Expected sequence of Edge and Wire objects')
+        cobj = obj
+        cshapes.push_back(<c_OCCBase *>cobj.thisptr)
+    
+    tess = tesselateShapes(cshapes, angular, curvature, threads)
+    if tess == NULL:
+        raise OCCError(errorMessage)
+    
+    ret.thisptr = tess
+    ret.setArrays()
+    return ret
     
 cdef class Mesh:
     '''
@@ -103,6 +159,16 @@ cdef class Mesh:
     cdef readonly view.array edgeRanges
     cdef readonly int edgeRangesItemSize
     
+    cdef readonly view.array faceRanges
+    cdef readonly int faceRangesItemSize
+    
+    cdef readonly view.array interleaved
+    cdef readonly int interleavedItemSize
+    cdef readonly int interleavedStride
+    
+    cdef readonly view.array preciseVertices
+    cdef readonly int preciseVerticesItemSize
+    
     def __init__(self):
         self.thisptr = new c_OCCMesh()
         
@@ -125,12 +191,139 @@ cdef class Mesh:
         return occ.vertices.size() > 0 and occ.normals.size() > 0 and \
                occ.triangles.size() > 0
     
+    cpdef decimate(self, unsigned int target = 0, double maxError = 0.):
+        '''
+        Reduce number of triangles by collapsing edges with the
+        smallest quadric error.
+        
+        Vertices of edge polylines and face boundaries are locked,
+        remaining vertices keep their position and normal. Stops when
+        the mesh has target triangles or when the next collapse has an
+        error above maxError, measured as distance to the planes of
+        the original triangles.
+        
+        :param target: target number of triangles, zero for no limit
+        :param maxError: maximum error, zero for no limit
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        
+        if not occ.decimate(target, maxError):
+            raise OCCError(errorMessage)
+        
+        self.setArrays()
+        return self
+    
+    cpdef MeshEncoding encode(self, int normalBits = 16, int threads = 1):
+        '''
+        Return compact encoding of mesh.
+        
+        Positions are quantized to 16 bit against the bounding box,
+        normals are octahedral encoded with normalBits (8 or 16) per
+        component and indices are 16 bit for meshes with at most 65536
+        vertices.
+        
+        :param normalBits: bits per normal component
+        :param threads: number of threads, zero use all cores
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        cdef c_OCCMeshEncoding *enc = new c_OCCMeshEncoding()
+        cdef MeshEncoding ret = MeshEncoding.__new__(MeshEncoding, None)
+        
+        if not enc.encode(occ, normalBits, threads):
+            del enc
+            raise OCCError(errorMessage)
+        
+        ret.thisptr = enc
+        ret.setArrays()
+        return ret
+    
     cpdef optimize(self):
         '''
         Vertex Cache Optimisation
         '''
         cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
         occ.optimize()
+    
+    cpdef size_t memoryUsage(self):
+        '''
+        Return number of bytes used by mesh arrays
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        return occ.memoryUsage()
+    
+    cpdef size_t weldSaved(self):
+        '''
+        Return number of bytes saved by welding vertices
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        return occ.weldsaved
+    
+    cpdef float cacheEfficiency(self, unsigned int cacheSize = 16):
+        '''
+        Average transform to vertex ratio (ATVR) of the triangle
+        order for a vertex cache of the given size. 1.0 is the
+        theoretical optimum.
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        return calcCacheEfficiency(occ, cacheSize)
+    
+    cpdef dict massProperties(self, int threads = 1):
+        '''
+        Return volume, area, centre of mass and inertia of the closed
+        mesh with unit density, computed in one pass over the triangles.
+        
+        Inertia is given with respect to the centre of mass as
+        (Ixx, Iyy, Izz, Ixy, Ixz, Iyz) like Solid.inertia. The volume,
+        centre and inertia errors bound the difference to the exact
+        solid from the mesh deflection. The area error is an estimate
+        from the angular deflection, not a bound. All errors are zero
+        when the deflection is unknown.
+        
+        :param threads: number of threads, zero use all cores
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        cdef c_OCCMassProperties props
+        
+        if not occ.massProperties(props, threads):
+            raise OCCError(errorMessage)
+        
+        return {
+            'volume': props.volume,
+            'area': props.area,
+            'centreOfMass': (props.centre.x, props.centre.y, props.centre.z),
+            'inertia': (props.inertia[0], props.inertia[1], props.inertia[2],
+                        props.inertia[3], props.inertia[4], props.inertia[5]),
+            'volumeError': props.volumeError,
+            'areaError': props.areaError,
+            'centreError': props.centreError,
+            'inertiaError': props.inertiaError,
+        }
+    
+    cpdef dict samplePoints(self, int n, unsigned int seed = 0, int threads = 1):
+        '''
+        Sample n points uniformly by area over the mesh triangles.
+        Return dict with 'points' and 'normals' of shape (n, 3) and
+        'faces' of shape (n,) with the source face id of each sample
+        as given in faceRanges, -1 for triangles outside any face.
+        
+        Normals are interpolated from the vertex normals. The samples
+        depend only on the seed, not on the number of threads.
+        
+        :param n: number of samples
+        :param seed: random seed
+        :param threads: number of threads, zero use all cores
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        cdef int size = max(n, 1)
+        cdef view.array points = view.array(shape=(size, 3), itemsize=sizeof(double), format="d")
+        cdef view.array normals = view.array(shape=(size, 3), itemsize=sizeof(double), format="d")
+        cdef view.array faces = view.array(shape=(size,), itemsize=sizeof(int), format="i")
+        
+        if not occ.samplePoints(n, seed, threads, <double *>points.data,
+                                <double *>normals.data, <int *>faces.data):
+            raise OCCError(errorMessage)
+        
+        return {'points': points[:n], 'normals': normals[:n], 'faces': faces[:n]}
                
     cdef setArrays(self):
         cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
@@ -143,6 +336,10 @@ cdef class Mesh:
         self.trianglesItemSize = sizeof(unsigned int)
         self.edgeIndicesItemSize = sizeof(unsigned int)
         self.edgeRangesItemSize = sizeof(int)
+        self.faceRangesItemSize = sizeof(int)
+        self.interleavedItemSize = sizeof(float)
+        self.interleavedStride = sizeof(c_OCCVertexNormal)
+        self.preciseVerticesItemSize = sizeof(double)
         
         self.vertices = view.array(
             shape=(3*occ.vertices.size(),),
@@ -184,8 +381,54 @@ cdef class Mesh:
                 allocate_buffer=False
             )
             self.edgeRanges.data = <char *> &occ.edgeranges[0]
+        
+        if occ.faceranges.size() > 0:
+            self.faceRanges = view.array(
+                shape=(occ.faceranges.size(),),
+                itemsize=sizeof(int),
+                format="i",
+                allocate_buffer=False
+            )
+            self.faceRanges.data = <char *> &occ.faceranges[0]
+        
+        if occ.interleaved.size() > 0:
+            self.interleaved = view.array(
+                shape=(8*occ.interleaved.size(),),
+                itemsize=sizeof(float),
+                format="f",
+                allocate_buffer=False
+            )
+            self.interleaved.data = <char *> &occ.interleaved[0]
+        
+        if occ.precisevertices.size() > 0:
+            self.preciseVertices = view.array(
+                shape=(3*occ.precisevertices.size(),),
+                itemsize=sizeof(double),
+                format="d",
+                allocate_buffer=False
+            )
+            self.preciseVertices.data = <char *> &occ.precisevertices[0]
           
           
+    property origin:
+        '''
+        Origin of the vertices in double precision. Absolute
+        position of a vertex is the vertex added to origin.
+        '''
+        def __get__(self):
+            cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+            return occ.origin.x, occ.origin.y, occ.origin.z
+    
+    property deflection:
+        '''
+        Bound of the chordal deflection of the mesh, zero when unknown.
+        With relativeToEdge the deflection of the mesher is scaled by
+        the size of each edge, up to half the bounding box size.
+        '''
+        def __get__(self):
+            cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+            return occ.deflection
+    
     cpdef size_t nvertices(self):
         '''
         Return number of vertices
@@ -221,6 +464,35 @@ cdef class Mesh:
         cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
         return occ.edgeranges.size()
         
+    cpdef size_t nfaceRanges(self):
+        '''
+        Return number of face range values. Each face use five
+        values: first triangle, number of triangles, first vertex,
+        number of vertices and index of face in the shape.
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        return occ.faceranges.size()
+    
+    cpdef faceRange(self, size_t index):
+        '''
+        Return range of face at given index as tuple of first
+        triangle, number of triangles, first vertex, number of
+        vertices and face index.
+        
+        The face index is the position of the face in the unique
+        faces of the shape, as counted by numFaces. Vertex ranges
+        hold the vertices first used by the face, which is all
+        vertices of the face unless the mesh is welded.
+        '''
+        cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
+        cdef int *r
+        
+        if 5*index + 4 >= occ.faceranges.size():
+            raise IndexError('face range index out of range')
+        
+        r = &occ.faceranges[5*index]
+        return r[0], r[1], r[2], r[3], r[4]
+    
     cpdef vertex(self, size_t index):
         '''
         Return vertex at given index
@@ -244,6 +516,553 @@ cdef class Mesh:
         cdef c_OCCMesh *occ = <c_OCCMesh *>self.thisptr
         cdef c_OCCStruct3I t = occ.triangles[index]
         return t.i, t.j, t.k
+
+cdef class MeshEncoding:
+    '''
+    MeshEncoding - Compact quantized mesh created by Mesh.encode
+    
+    Vertex i is decoded as origin + positions[3*i:3*i + 3]*scale.
+    Normals are two octahedral components per vertex, triangles
+    and edgeIndices use indexSize bytes per index.
+    '''
+    cdef void *thisptr
+    
+    cdef readonly view.array positions
+    cdef readonly view.array normals
+    cdef readonly view.array triangles
+    cdef readonly view.array edgeIndices
+    cdef readonly view.array edgeRanges
+    cdef readonly view.array faceRanges
+    
+    def __init__(self):
+        self.thisptr = new c_OCCMeshEncoding()
+        
+    def __dealloc__(self):
+        cdef c_OCCMeshEncoding *tmp
+        
+        if self.thisptr != NULL:
+            tmp = <c_OCCMeshEncoding *>self.thisptr
+            del tmp
+    
+    def __str__(self):
+        return "MeshEncoding%s" % repr(self)
+    
+    def __repr__(self):
+        cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+        args = occ.numVertices(), occ.normalBits, occ.indexSize, occ.memoryUsage()
+        return "(nvertices = %d, normalBits = %d, indexSize = %d, bytes = %d)" % args
+    
+    cdef setArrays(self):
+        cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+        cdef int nsize = occ.normalBits // 8
+        
+        if occ.numVertices() == 0:
+            return
+        
+        self.positions = view.array(
+            shape=(occ.positions.size(),),
+            itemsize=sizeof(unsigned short),
+            format="H",
+            allocate_buffer=False
+        )
+        self.positions.data = <char *> &occ.positions[0]
+        
+        self.normals = view.array(
+            shape=(occ.normals.size() // nsize,),
+            itemsize=nsize,
+            format="B" if nsize == 1 else "H",
+            allocate_buffer=False
+        )
+        self.normals.data = <char *> &occ.normals[0]
+        
+        if occ.triangles.size() > 0:
+            self.triangles = view.array(
+                shape=(occ.triangles.size() // occ.indexSize,),
+                itemsize=occ.indexSize,
+                format="H" if occ.indexSize == 2 else "I",
+                allocate_buffer=False
+            )
+            self.triangles.data = <char *> &occ.triangles[0]
+        
+        if occ.edgeindices.size() > 0:
+            self.edgeIndices = view.array(
+                shape=(occ.edgeindices.size() // occ.indexSize,),
+                itemsize=occ.indexSize,
+                format="H" if occ.indexSize == 2 else "I",
+                allocate_buffer=False
+            )
+            self.edgeIndices.data = <char *> &occ.edgeindices[0]
+            
+            self.edgeRanges = view.array(
+                shape=(occ.edgeranges.size(),),
+                itemsize=sizeof(int),
+                format="i",
+                allocate_buffer=False
+            )
+            self.edgeRanges.data = <char *> &occ.edgeranges[0]
+        
+        if occ.faceranges.size() > 0:
+            self.faceRanges = view.array(
+                shape=(occ.faceranges.size(),),
+                itemsize=sizeof(int),
+                format="i",
+                allocate_buffer=False
+            )
+            self.faceRanges.data = <char *> &occ.faceranges[0]
+    
+    property origin:
+        def __get__(self):
+            cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+            return (occ.origin[0], occ.origin[1], occ.origin[2])
+    
+    property scale:
+        def __get__(self):
+            cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+            return (occ.scale[0], occ.scale[1], occ.scale[2])
+    
+    property normalBits:
+        def __get__(self):
+            cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+            return occ.normalBits
+    
+    property indexSize:
+        def __get__(self):
+            cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+            return occ.indexSize
+    
+    property errors:
+        def __get__(self):
+            '''
+            Quantization errors. Position errors are distances in model
+            units, normal errors are angles in radians.
+            '''
+            cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+            return {
+                'maxPosition': occ.maxPositionError,
+                'meanPosition': occ.meanPositionError,
+                'maxNormal': occ.maxNormalError,
+                'meanNormal': occ.meanNormalError,
+            }
+    
+    cpdef size_t nvertices(self):
+        '''
+        Return number of vertices
+        '''
+        cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+        return occ.numVertices()
+    
+    cpdef size_t memoryUsage(self):
+        '''
+        Return number of bytes used by encoded arrays
+        '''
+        cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+        return occ.memoryUsage()
+    
+    cpdef Mesh decode(self, int threads = 1):
+        '''
+        Return decoded mesh
+        '''
+        cdef c_OCCMeshEncoding *occ = <c_OCCMeshEncoding *>self.thisptr
+        cdef Mesh ret = Mesh.__new__(Mesh, None)
+        
+        ret.thisptr = occ.decode(threads)
+        ret.setArrays()
+        return ret
+        
+cdef class MeshBVH:
+    '''
+    MeshBVH - Bounding volume hierarchy over the triangles of a Mesh
+    
+    The hierarchy holds a copy of the mesh geometry. Queries take
+    and return absolute coordinates as arrays of shape (n, 3), any
+    C contiguous double buffer such as a numpy array is accepted.
+    
+    example::
+        
+        bvh = MeshBVH(solid.createMesh())
+        triangles, faces, distances = bvh.intersect(origins, directions)
+    '''
+    cdef void *thisptr
+    
+    def __init__(self, Mesh mesh, int leafSize = 4):
+        cdef c_OCCMeshBVH *occ = new c_OCCMeshBVH()
+        self.thisptr = occ
+        occ.build(<c_OCCMesh *>mesh.thisptr, leafSize)
+        
+    def __dealloc__(self):
+        cdef c_OCCMeshBVH *tmp
+        
+        if self.thisptr != NULL:
+            tmp = <c_OCCMeshBVH *>self.thisptr
+            del tmp
+    
+    def __str__(self):
+        return "MeshBVH%s" % repr(self)
+    
+    def __repr__(self):
+        cdef c_OCCMeshBVH *occ = <c_OCCMeshBVH *>self.thisptr
+        args = occ.numTriangles(), occ.depth, occ.memoryUsage()
+        return "(ntriangles = %d, depth = %d, bytes = %d)" % args
+    
+    cpdef intersect(self, double[:, ::1] origins, double[:, ::1] directions,
+                    double tmax = 1e300, int threads = 1):
+        '''
+        Find first triangle hit by each ray. Return tuple of triangle
+        index, face index and distance arrays. Distances are in units
+        of the direction length. Rays without hit get triangle and face
+        index -1 and distance tmax.
+        
+        :param origins: ray origins, shape (n, 3)
+        :param directions: ray directions, shape (n, 3)
+        :param tmax: max distance along rays
+        :param threads: number of threads, zero use all cores.
+        '''
+        cdef c_OCCMeshBVH *occ = <c_OCCMeshBVH *>self.thisptr
+        cdef int n = origins.shape[0]
+        
+        if origins.shape[1] != 3 or directions.shape[1] != 3 or directions.shape[0] != n:
+            raise OCCError('Expected origins and directions of shape (n, 3)')
+        
+        cdef view.array tris = view.array(shape=(max(n, 1),), itemsize=sizeof(int), format="i")
+        cdef view.array faces = view.array(shape=(max(n, 1),), itemsize=sizeof(int), format="i")
+        cdef view.array distances = view.array(shape=(max(n, 1),), itemsize=sizeof(double), format="d")
+        if n > 0:
+            occ.intersect(&origins[0, 0], &directions[0, 0], n, tmax, threads,
+                          <int *>tris.data, <int *>faces.data, <double *>distances.data)
+        return tris[:n], faces[:n], distances[:n]
+    
+    cpdef closestPoint(self, double[:, ::1] points, double maxDistance = 1e300,
+                       int threads = 1):
+        '''
+        Find closest point on mesh for each query point. Return tuple
+        of triangle index, face index, closest point (n, 3) and
+        distance arrays. Points without result within maxDistance get
+        triangle and face index -1.
+        
+        :param points: query points, shape (n, 3)
+        :param maxDistance: max search distance
+        :param threads: number of threads, zero use all cores.
+        '''
+        cdef c_OCCMeshBVH *occ = <c_OCCMeshBVH *>self.thisptr
+        cdef int n = points.shape[0]
+        
+        if points.shape[1] != 3:
+            raise OCCError('Expected points of shape (n, 3)')
+        
+        cdef view.array tris = view.array(shape=(max(n, 1),), itemsize=sizeof(int), format="i")
+        cdef view.array faces = view.array(shape=(max(n, 1),), itemsize=sizeof(int), format="i")
+        cdef view.array closest = view.array(shape=(max(n, 1), 3), itemsize=sizeof(double), format="d")
+        cdef view.array distances = view.array(shape=(max(n, 1),), itemsize=sizeof(double), format="d")
+        if n > 0:
+            occ.closestPoint(&points[0, 0], n, maxDistance, threads,
+                             <int *>tris.data, <int *>faces.data,
+                             <double *>closest.data, <double *>distances.data)
+        return tris[:n], faces[:n], closest[:n], distances[:n]
+    
+    cpdef list overlap(self, AABBox box):
+        '''
+        Return sorted list of triangles with bounds overlapping box
+        '''
+        cdef c_OCCMeshBVH *occ = <c_OCCMeshBVH *>self.thisptr
+        cdef vector[int] tris
+        cdef double lo[3]
+        cdef double hi[3]
+        
+        lo[0], lo[1], lo[2] = box.min.x, box.min.y, box.min.z
+        hi[0], hi[1], hi[2] = box.max.x, box.max.y, box.max.z
+        occ.overlap(lo, hi, tris)
+        return tris
+    
+    cpdef size_t ntriangles(self):
+        '''
+        Return number of triangles
+        '''
+        cdef c_OCCMeshBVH *occ = <c_OCCMeshBVH *>self.thisptr
+        return occ.numTriangles()
+    
+    cpdef size_t memoryUsage(self):
+        '''
+        Return bytes used by the hierarchy and geometry copy
+        '''
+        cdef c_OCCMeshBVH *occ = <c_OCCMeshBVH *>self.thisptr
+        return occ.memoryUsage()
+    
+cdef class Mesher:
+    '''
+    Mesher - Mesh generation settings shared by Solid and Face.
+    
+    Timings in seconds of the stages of the last mesh operation
+    is available from the timings attribute.
+    
+    example::
+        
+        mesher = Mesher(deflection = .001, threads = 0)
+        mesh = solid.createMesh(mesher = mesher)
+        print(mesher.timings)
+    '''
+    cdef c_OCCMeshParams params
+    
+    def __init__(self, double deflection = .01, bint relative = True,
+                 double angle = .25, bint relativeToEdge = True,
+                 int qualityNormals = NORMALS_SMOOTH, int threads = 1,
+                 bint weld = False, double creaseAngle = M_PI/6.,
+                 bint interleaved = False, bint originRelative = False,
+                 bint preciseVertices = False, bint releaseTriangulation = False):
+        self.params.deflection = deflection
+        self.params.relative = relative
+        self.params.angle = angle
+        self.params.relativeToEdge = relativeToEdge
+        self.params.qualityNormals = qualityNormals
+        self.params.threads = threads
+        self.params.weld = weld
+        self.params.creaseAngle = creaseAngle
+        self.params.interleaved = interleaved
+        self.params.originRelative = originRelative
+        self.params.preciseVertices = preciseVertices
+        self.params.releaseTriangulation = releaseTriangulation
+    
+    def __str__(self):
+        return "Mesher%s" % repr(self)
+    
+    def __repr__(self):
+        args = self.deflection, self.relative, self.angle, self.threads
+        return "(deflection = %g, relative = %s, angle = %g, threads = %d)" % args
+    
+    property deflection:
+        '''
+        Deflection from true position, relative to the
+            bounding box size when relative is set.
+        '''
+        def __get__(self):
+            return self.params.deflection
+        def __set__(self, double value):
+            self.params.deflection = value
+    
+    property relative:
+        '''
+        Deflection relative to bounding box size.
+        '''
+        def __get__(self):
+            return self.params.relative
+        def __set__(self, bint value):
+            self.params.relative = value
+    
+    property angle:
+        '''
+        Max angular deflection.
+        '''
+        def __get__(self):
+            return self.params.angle
+        def __set__(self, double value):
+            self.params.angle = value
+    
+    property relativeToEdge:
+        '''
+        Deflection relative to the size of each edge.
+        '''
+        def __get__(self):
+            return self.params.relativeToEdge
+        def __set__(self, bint value):
+            self.params.relativeToEdge = value
+    
+    property qualityNormals:
+        '''
+        Normal mode, NORMALS_SMOOTH, NORMALS_SURFACE or
+            NORMALS_PROJECTED.
+        '''
+        def __get__(self):
+            return self.params.qualityNormals
+        def __set__(self, int value):
+            self.params.qualityNormals = value
+    
+    property threads:
+        '''
+        Number of threads. Zero use all available cores.
+        '''
+        def __get__(self):
+            return self.params.threads
+        def __set__(self, int value):
+            self.params.threads = value
+    
+    property weld:
+        '''
+        Merge coincident vertices along shared edges.
+        '''
+        def __get__(self):
+            return self.params.weld
+        def __set__(self, bint value):
+            self.params.weld = value
+    
+    property creaseAngle:
+        '''
+        Max normal angle between welded vertices.
+        '''
+        def __get__(self):
+            return self.params.creaseAngle
+        def __set__(self, double value):
+            self.params.creaseAngle = value
+    
+    property interleaved:
+        '''
+        Also write vertices and normals to the interleaved array of
+            the mesh, 8 floats for each vertex with the position at
+            offset 0 and the normal at offset 16 bytes.
+        '''
+        def __get__(self):
+            return self.params.interleaved
+        def __set__(self, bint value):
+            self.params.interleaved = value
+    
+    property originRelative:
+        '''
+        Store vertices relative to the bounding box center in
+            single precision, the center is available as the
+            origin of the mesh. Use for shapes placed far from
+            the global origin.
+        '''
+        def __get__(self):
+            return self.params.originRelative
+        def __set__(self, bint value):
+            self.params.originRelative = value
+    
+    property preciseVertices:
+        '''
+        Also write absolute vertex positions in double precision
+            to the preciseVertices array of the mesh.
+        '''
+        def __get__(self):
+            return self.params.preciseVertices
+        def __set__(self, bint value):
+            self.params.preciseVertices = value
+    
+    property releaseTriangulation:
+        '''
+        Remove triangulations and edge polygons from the shape
+            after extraction. Later calls to updateMesh then
+            mesh all faces again.
+        '''
+        def __get__(self):
+            return self.params.releaseTriangulation
+        def __set__(self, bint value):
+            self.params.releaseTriangulation = value
+    
+    property timings:
+        '''
+        Dictionary with time in seconds of bounding box, discretization,
+        extraction, normal evaluation and edge polyline stages. Normal
+        and edge times are part of extraction and summed over threads.
+        '''
+        def __get__(self):
+            return {
+                'bbox': self.params.timeBBox,
+                'discretize': self.params.timeDiscretize,
+                'extract': self.params.timeExtract,
+                'normals': self.params.timeNormals,
+                'edges': self.params.timeEdges,
+            }
+    
+    property facesMeshed:
+        '''
+        Number of faces triangulated by the last mesh operation.
+        Faces copied by updateMesh are not counted.
+        '''
+        def __get__(self):
+            return self.params.facesMeshed
+    
+    @staticmethod
+    def simdLevel():
+        '''
+        Return active kernel level used for node transform, normals
+        and mesh encoding, SIMD_SCALAR, SIMD_SSE2 or SIMD_AVX2.
+        '''
+        return meshSIMDLevel()
+    
+    @staticmethod
+    def setSIMDLevel(int level = -1):
+        '''
+        Select kernel level, limited to what the CPU supports. A
+        negative level select the best supported. Return the
+        active level.
+        '''
+        return setMeshSIMDLevel(level)
+    
+cdef class MeshStream:
+    '''
+    Forward mesh chunks from Solid/Face.createMeshStream to a
+    Python callable. Each call gets a new Mesh holding a copy of
+    the chunk, the staging buffers of the C++ stream are reused.
+    '''
+    cdef object callback
+    cdef object error
+    
+    def __init__(self, callback):
+        self.callback = callback
+        self.error = None
+    
+    cdef int emit(self, int firstFace, int numFaces, c_OCCMesh *chunk):
+        cdef Mesh mesh = Mesh.__new__(Mesh, None)
+        mesh.thisptr = new c_OCCMesh(chunk[0])
+        mesh.setArrays()
+        try:
+            ret = self.callback(firstFace, numFaces, mesh)
+        except BaseException as err:
+            self.error = err
+            return 0
+        return ret is not False
+    
+    cdef check(self, int ret):
+        if self.error is not None:
+            raise self.error
+        if not ret:
+            raise OCCError(errorMessage)
+
+cdef int meshStreamCallback(void *data, int firstFace, int numFaces, c_OCCMesh *chunk):
+    cdef MeshStream stream = <MeshStream>data
+    return stream.emit(firstFace, numFaces, chunk)
+
+cdef class MeshCache:
+    '''
+    In-process cache for Solid/Face.createMesh keyed on the shape
+    geometry and the meshing parameters.
+    
+    The cache is disabled until a byte budget is set. Least recently
+    used meshes are evicted when the budget is exceeded.
+    
+    The key is computed from the BREP text of a copy of the shape
+    without triangulations, which costs a copy and a serialization
+    of the shape on every createMesh. The shape itself is not
+    modified.
+    '''
+    @staticmethod
+    def setBudget(size_t budget):
+        '''
+        Set cache size in bytes. Zero disables the cache.
+        '''
+        cdef c_OCCMeshCache *cache = &c_OCCMeshCache.instance()
+        cache.setBudget(budget)
+    
+    @staticmethod
+    def clear():
+        '''
+        Remove all cached meshes
+        '''
+        cdef c_OCCMeshCache *cache = &c_OCCMeshCache.instance()
+        cache.clear()
+        
+    @staticmethod
+    def stats():
+        '''
+        Return dictionary with cache counters
+        '''
+        cdef c_OCCMeshCache *cache = &c_OCCMeshCache.instance()
+        return {
+            'budget': cache.budget,
+            'used': cache.used,
+            'entries': cache.size(),
+            'hits': cache.hits,
+            'misses': cache.misses,
+            'evictions': cache.evictions,
+        }
             
 include "OCCTools.pxi"
 include "OCCBase.pxi"
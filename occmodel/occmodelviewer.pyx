@@ -262,7 +262,7 @@ class Viewer(gl.Window):
             else:
                 res = SolidObj(obj.hashCode())
                 
-            mesh = obj.createMesh()
+            mesh = obj.createMesh(mesher = occ.Mesher(interleaved = True))
             if not mesh.isValid():
                 return False
             
@@ -273,26 +273,14 @@ class Viewer(gl.Window):
             self.bbox.addPoint(bbox.min)
             self.bbox.addPoint(bbox.max)
             
-            # create vertex & normal buffer
+            # create interleaved vertex & normal buffer
             buffer = res.buffer = gl.ClientBuffer()
             
-            vertSize = 3*mesh.nvertices()
-            vertItemSize = mesh.verticesItemSize
-
-            normSize = 3*mesh.nnormals()
-            normItemSize = mesh.normalsItemSize
-            
-            buffer.loadData(None, vertSize*vertItemSize + normSize*normItemSize)
-            
-            offset = 0
-            size = vertSize*vertItemSize
-            buffer.setDataType(gl.VERTEX_ARRAY, gl.FLOAT, 3, 0, 0)
-            buffer.loadData(mesh.vertices, size, offset)
-            offset += size
-            
-            size = normSize*normItemSize
-            buffer.setDataType(gl.NORMAL_ARRAY, gl.FLOAT, 3, 0, offset)
-            buffer.loadData(mesh.normals, size, offset)
+            stride = mesh.interleavedStride
+            buffer.loadData(mesh.interleaved, mesh.nvertices()*stride)
+            buffer.setDataType(gl.VERTEX_ARRAY, gl.FLOAT, 3, stride, 0)
+            buffer.setDataType(gl.NORMAL_ARRAY, gl.FLOAT, 3, stride,
+                               4*mesh.interleavedItemSize)
             
             # create tri indices buffer
             tribuffer = res.triBuffer = gl.ClientBuffer(gl.ELEMENT_ARRAY_BUFFER)
@@ -57,6 +57,8 @@ SOURCES = ["occmodel/occmodel.pyx"]
 OBJECTS, LIBS, LINK_ARGS, COMPILE_ARGS = [],[],[],[]
 if sys.platform == 'win32':
     COMPILE_ARGS.append('/EHsc')
+    # occmodel.lib is built without /openmp, the Express editions of
+    # Visual Studio lack OpenMP and the threads arguments are ignored
     OCCINCLUDE = r"C:\vs9include\oce"
     OCCLIBS = []
     OBJECTS = [name + '.lib' for name in OCC.split()] + ['occmodel.lib',]
@@ -72,6 +74,7 @@ else:
     OCCLIBS = OCC.split()
     OBJECTS = ["occmodel/liboccmodel.a"]
     COMPILE_ARGS.append("-fpermissive")
+    LINK_ARGS.append("-fopenmp")
 
 EXTENSIONS = [
     Extension("occmodel",